@@ -39,11 +39,20 @@ EMSCRIPTEN_BINDINGS(ggwave) {
         .value("GGWAVE_PROTOCOL_CUSTOM_9", GGWAVE_PROTOCOL_CUSTOM_9)
         ;
 
-    emscripten::constant("GGWAVE_OPERATING_MODE_RX",            (int) GGWAVE_OPERATING_MODE_RX);
-    emscripten::constant("GGWAVE_OPERATING_MODE_TX",            (int) GGWAVE_OPERATING_MODE_TX);
-    emscripten::constant("GGWAVE_OPERATING_MODE_RX_AND_TX",     (int) GGWAVE_OPERATING_MODE_RX | GGWAVE_OPERATING_MODE_TX);
-    emscripten::constant("GGWAVE_OPERATING_MODE_TX_ONLY_TONES", (int) GGWAVE_OPERATING_MODE_TX_ONLY_TONES);
-    emscripten::constant("GGWAVE_OPERATING_MODE_USE_DSS",       (int) GGWAVE_OPERATING_MODE_USE_DSS);
+    emscripten::constant("GGWAVE_OPERATING_MODE_RX",                     (int) GGWAVE_OPERATING_MODE_RX);
+    emscripten::constant("GGWAVE_OPERATING_MODE_TX",                     (int) GGWAVE_OPERATING_MODE_TX);
+    emscripten::constant("GGWAVE_OPERATING_MODE_RX_AND_TX",              (int) GGWAVE_OPERATING_MODE_RX | GGWAVE_OPERATING_MODE_TX);
+    emscripten::constant("GGWAVE_OPERATING_MODE_TX_ONLY_TONES",          (int) GGWAVE_OPERATING_MODE_TX_ONLY_TONES);
+    emscripten::constant("GGWAVE_OPERATING_MODE_USE_DSS",                (int) GGWAVE_OPERATING_MODE_USE_DSS);
+    emscripten::constant("GGWAVE_OPERATING_MODE_RX_INCREMENTAL_MARKERS", (int) GGWAVE_OPERATING_MODE_RX_INCREMENTAL_MARKERS);
+    emscripten::constant("GGWAVE_OPERATING_MODE_TX_STREAM",              (int) GGWAVE_OPERATING_MODE_TX_STREAM);
+    emscripten::constant("GGWAVE_OPERATING_MODE_RESAMPLER_POLYPHASE",    (int) GGWAVE_OPERATING_MODE_RESAMPLER_POLYPHASE);
+    emscripten::constant("GGWAVE_OPERATING_MODE_RX_EARLY_STOP",          (int) GGWAVE_OPERATING_MODE_RX_EARLY_STOP);
+    emscripten::constant("GGWAVE_OPERATING_MODE_RX_ENERGY_GATE",         (int) GGWAVE_OPERATING_MODE_RX_ENERGY_GATE);
+    emscripten::constant("GGWAVE_OPERATING_MODE_RX_DECIMATE",            (int) GGWAVE_OPERATING_MODE_RX_DECIMATE);
+    emscripten::constant("GGWAVE_OPERATING_MODE_RX_NATIVE_RATE",         (int) GGWAVE_OPERATING_MODE_RX_NATIVE_RATE);
+    emscripten::constant("GGWAVE_OPERATING_MODE_RX_RECORD_I16",          (int) GGWAVE_OPERATING_MODE_RX_RECORD_I16);
+    emscripten::constant("GGWAVE_OPERATING_MODE_FFT_RADIX4",             (int) GGWAVE_OPERATING_MODE_FFT_RADIX4);
 
     emscripten::value_object<ggwave_Parameters>("Parameters")
         .field("payloadLength",        & ggwave_Parameters::payloadLength)
@@ -55,6 +64,7 @@ EMSCRIPTEN_BINDINGS(ggwave) {
         .field("sampleFormatInp",      & ggwave_Parameters::sampleFormatInp)
         .field("sampleFormatOut",      & ggwave_Parameters::sampleFormatOut)
         .field("operatingMode",        & ggwave_Parameters::operatingMode)
+        .field("analysisThreads",      & ggwave_Parameters::analysisThreads)
         ;
 
     emscripten::function("getDefaultParameters", & ggwave_getDefaultParameters);
@@ -133,4 +143,9 @@ EMSCRIPTEN_BINDINGS(ggwave) {
                     [](ggwave_Instance instance) {
                         return ggwave_rxDurationFrames(instance);
                     }));
+
+    emscripten::function("rxFramesSkipped", emscripten::optional_override(
+                    [](ggwave_Instance instance) {
+                        return ggwave_rxFramesSkipped(instance);
+                    }));
 }
@@ -38,7 +38,16 @@ cdef extern from "ggwave.h" nogil:
         GGWAVE_OPERATING_MODE_TX,
         GGWAVE_OPERATING_MODE_RX_AND_TX,
         GGWAVE_OPERATING_MODE_TX_ONLY_TONES,
-        GGWAVE_OPERATING_MODE_USE_DSS
+        GGWAVE_OPERATING_MODE_USE_DSS,
+        GGWAVE_OPERATING_MODE_RX_INCREMENTAL_MARKERS,
+        GGWAVE_OPERATING_MODE_TX_STREAM,
+        GGWAVE_OPERATING_MODE_RESAMPLER_POLYPHASE,
+        GGWAVE_OPERATING_MODE_RX_EARLY_STOP,
+        GGWAVE_OPERATING_MODE_RX_ENERGY_GATE,
+        GGWAVE_OPERATING_MODE_RX_DECIMATE,
+        GGWAVE_OPERATING_MODE_RX_NATIVE_RATE,
+        GGWAVE_OPERATING_MODE_RX_RECORD_I16,
+        GGWAVE_OPERATING_MODE_FFT_RADIX4
 
     ctypedef struct ggwave_Parameters:
         int payloadLength
@@ -50,6 +59,7 @@ cdef extern from "ggwave.h" nogil:
         ggwave_SampleFormat sampleFormatInp
         ggwave_SampleFormat sampleFormatOut
         int operatingMode
+        int analysisThreads
 
     ctypedef int ggwave_Instance
 
@@ -68,6 +78,18 @@ cdef extern from "ggwave.h" nogil:
             void * waveformBuffer,
             int query);
 
+    int ggwave_encodeBegin(
+            ggwave_Instance instance,
+            const void * payloadBuffer,
+            int payloadSize,
+            ggwave_ProtocolId protocolId,
+            int volume);
+
+    int ggwave_encodeNext(
+            ggwave_Instance instance,
+            void * waveformBuffer,
+            int maxSamples);
+
     int ggwave_decode(
             ggwave_Instance instance,
             const void * waveformBuffer,
@@ -225,6 +225,7 @@ bool GGWave_init(
             sampleFormatInp,
             sampleFormatOut,
             mode,
+            1,
         });
     }
 
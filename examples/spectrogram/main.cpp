@@ -186,9 +186,6 @@ bool GGWave_mainLoop() {
     static float data[g_nSamplesPerFrame];
     static float out [2*g_nSamplesPerFrame];
 
-    static int   workI[2*g_nSamplesPerFrame];
-    static float workF[g_nSamplesPerFrame/2];
-
     static float workF0[g_nSamplesPerFrame];
     static float workF1[g_nSamplesPerFrame];
     static float workF2[11];
@@ -197,9 +194,6 @@ bool GGWave_mainLoop() {
         memset(data, 0, sizeof(data));
         memset(out,  0, sizeof(out));
 
-        memset(workI, 0, sizeof(workI));
-        memset(workF, 0, sizeof(workF));
-
         memset(workF0, 0, sizeof(workF0));
         memset(workF1, 0, sizeof(workF1));
         memset(workF2, 0, sizeof(workF2));
@@ -225,7 +219,7 @@ bool GGWave_mainLoop() {
             GGWave::filter(GGWAVE_FILTER_HAMMING, data, g_nSamplesPerFrame, 250.0f, GGWave::kDefaultSampleRate, workF1);
         }
 
-        if (GGWave::computeFFTR(data, out, g_nSamplesPerFrame, workI, workF) == false) {
+        if (GGWave::computeFFTRShared(data, out, g_nSamplesPerFrame) == false) {
             fprintf(stderr, "Failed to compute FFT!\n");
             return false;
         }
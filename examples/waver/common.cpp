@@ -664,6 +664,7 @@ void updateCore() {
                 sampleFormatInpOld,
                 sampleFormatOutOld,
                 mode,
+                1,
             };
 
             GGWave_reset(&parameters);
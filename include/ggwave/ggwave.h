@@ -19,6 +19,15 @@
 #define GGWAVE_CONFIG_FEW_PROTOCOLS
 #endif
 
+// Alignment of the buffers in the heap of the GGWave instances, in bytes. Must be a power of 2
+#ifndef GGWAVE_CONFIG_HEAP_ALIGNMENT
+#if defined(ARDUINO)
+#define GGWAVE_CONFIG_HEAP_ALIGNMENT 4
+#else
+#define GGWAVE_CONFIG_HEAP_ALIGNMENT 64
+#endif
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -27,7 +36,8 @@ extern "C" {
     // C interface
     //
 
-#define GGWAVE_MAX_INSTANCES 4
+// Maximum number of instances that can be registered with ggwave_init() at the same time
+#define GGWAVE_MAX_INSTANCES (1 << 16)
 
     // Data format of the audio samples
     typedef enum {
@@ -93,13 +103,93 @@ extern "C" {
     //   GGWAVE_OPERATING_MODE_USE_DSS:
     //     Enable the built-in Direct Sequence Spread (DSS) algorithm
     //
+    //   GGWAVE_OPERATING_MODE_RX_INCREMENTAL_MARKERS:
+    //     While listening for variable-length transmissions, check for the start marker on every
+    //     captured frame instead of every kMaxSpectrumHistory frames, which detects it up to
+    //     kMaxSpectrumHistory - 1 frames sooner. The marker bins of the enabled Rx protocols are
+    //     computed for each new frame by a Goertzel bank, after mixing the frame down to the band of
+    //     the markers and decimating it, and averaged over the last kMaxSpectrumHistory frames. No
+    //     FFT is computed while listening, so in this mode rxSpectrum() is not updated until a
+    //     transmission is received. The cost per frame grows with the number of distinct start
+    //     frequencies of the enabled Rx protocols. Has no effect with fixed-length payloads or
+    //     together with the decimating front end (see GGWAVE_OPERATING_MODE_RX_DECIMATE).
+    //
+    //   GGWAVE_OPERATING_MODE_TX_STREAM:
+    //     Do not allocate buffers for the full Tx waveform. The waveform can only be generated
+    //     in chunks with encodeBegin() and encodeNext(), which synthesise the frames on demand.
+    //     This saves the output samples of the longest transmission of the enabled Tx protocols
+    //     per instance.
+    //
+    //   GGWAVE_OPERATING_MODE_RX_EARLY_STOP:
+    //     Decode the length header of variable-length transmissions as soon as its frames have been
+    //     recorded and stop the recording right after the expected end of the payload, instead of
+    //     waiting for the end marker or the maximum transmission duration.
+    //
+    //   GGWAVE_OPERATING_MODE_RESAMPLER_POLYPHASE:
+    //     Resample with precomputed fractional-phase filter banks in float instead of evaluating
+    //     the sinc kernel for every tap. Faster, at the cost of ~33 KB of filter bank per instance.
+    //     Only has an effect when one of the input / output sample rates differs from sampleRate.
+    //
+    //   GGWAVE_OPERATING_MODE_RX_ENERGY_GATE:
+    //     Track the energy of the captured audio in the frequency bands of the enabled Rx protocols
+    //     and skip the spectral analysis of the frames in which it stays at the level of the noise
+    //     floor. Reduces the cost of listening to silence or to stationary background noise, at the
+    //     cost of missing some of the transmissions that are barely above the noise. The number of
+    //     skipped frames is reported by rxFramesSkipped(). Limitation: a skipped frame still costs
+    //     more than its sample format conversion, because the energy of each band is measured on it.
+    //
+    //   GGWAVE_OPERATING_MODE_RX_DECIMATE:
+    //     Band-pass filter the captured audio to the frequency band of the Rx protocols that are enabled upon
+    //     preparation and decimate it, so that the spectra are computed with a proportionally smaller
+    //     FFT and the recorded data of variable-length transmissions takes less memory. Protocols
+    //     enabled later outside of that band cannot be received. Has no effect if the band is too wide
+    //     to be decimated - for example, with the default set of protocols, which includes both audible
+    //     and ultrasound ones - so only enable it together with a narrow set of protocols, such as only
+    //     the audible or only the DT ones. prepare() logs a warning when the band cannot be decimated.
+    //     The band-pass filter is a short CIC-like filter that is evaluated only at the decimated samples.
+    //     It makes the decoding of the DT protocols and the fixed-length decoding of the audible ones
+    //     faster, while the variable-length decoding of the audible protocols costs about the same.
+    //
+    //   GGWAVE_OPERATING_MODE_RX_NATIVE_RATE:
+    //     Receive at the capture sample rate instead of resampling the captured audio to sampleRate.
+    //     The band of the Rx protocols enabled upon preparation is filtered out of the captured
+    //     samples with fractional-phase filter banks, directly at the sample positions of the
+    //     decimated front end (see GGWAVE_OPERATING_MODE_RX_DECIMATE), so the spectra keep the bins
+    //     of the protocols. The same restrictions on the Rx protocols apply. Falls back to the
+    //     resampler if the band does not fit below half of the capture sample rate. Only has an
+    //     effect when sampleRateInp differs from sampleRate. In this mode rxAmplitude() holds the
+    //     samples of the last frame at the capture sample rate.
+    //
+    //   GGWAVE_OPERATING_MODE_RX_RECORD_I16:
+    //     Record the captured audio of variable-length transmissions as 16-bit integers instead of
+    //     floats, which halves the largest buffer of the Rx. The recorded samples are clamped to
+    //     [-1, 1]. Combine with GGWAVE_OPERATING_MODE_RX_DECIMATE to record only the decimated band
+    //     of the Rx protocols.
+    //
+    //   GGWAVE_OPERATING_MODE_FFT_RADIX4:
+    //     Compute the spectra with the radix-4 FFT, which is vectorised with SSE2, AVX2 or NEON, instead
+    //     of the portable Ooura FFT. The two agree up to rounding. The tables of the radix-4 FFT take
+    //     3*samplesPerFrame floats and samplesPerFrame ints instead of about samplesPerFrame/2 floats,
+    //     and it needs a work buffer of 2*samplesPerFrame floats for each analysis thread. Has no effect
+    //     on CPUs without these instruction sets, and in builds with GGWAVE_CONFIG_FFT_OOURA defined
+    //     (the default on Arduino and ESP32).
+    //
     enum {
-        GGWAVE_OPERATING_MODE_RX            = 1 << 1,
-        GGWAVE_OPERATING_MODE_TX            = 1 << 2,
-        GGWAVE_OPERATING_MODE_RX_AND_TX     = (GGWAVE_OPERATING_MODE_RX |
-                                               GGWAVE_OPERATING_MODE_TX),
-        GGWAVE_OPERATING_MODE_TX_ONLY_TONES = 1 << 3,
-        GGWAVE_OPERATING_MODE_USE_DSS       = 1 << 4,
+        GGWAVE_OPERATING_MODE_RX                     = 1 << 1,
+        GGWAVE_OPERATING_MODE_TX                     = 1 << 2,
+        GGWAVE_OPERATING_MODE_RX_AND_TX              = (GGWAVE_OPERATING_MODE_RX |
+                                                        GGWAVE_OPERATING_MODE_TX),
+        GGWAVE_OPERATING_MODE_TX_ONLY_TONES          = 1 << 3,
+        GGWAVE_OPERATING_MODE_USE_DSS                = 1 << 4,
+        GGWAVE_OPERATING_MODE_RX_INCREMENTAL_MARKERS = 1 << 5,
+        GGWAVE_OPERATING_MODE_TX_STREAM              = 1 << 6,
+        GGWAVE_OPERATING_MODE_RESAMPLER_POLYPHASE    = 1 << 7,
+        GGWAVE_OPERATING_MODE_RX_EARLY_STOP          = 1 << 8,
+        GGWAVE_OPERATING_MODE_RX_ENERGY_GATE         = 1 << 9,
+        GGWAVE_OPERATING_MODE_RX_DECIMATE            = 1 << 10,
+        GGWAVE_OPERATING_MODE_RX_NATIVE_RATE         = 1 << 11,
+        GGWAVE_OPERATING_MODE_RX_RECORD_I16          = 1 << 12,
+        GGWAVE_OPERATING_MODE_FFT_RADIX4             = 1 << 13,
     };
 
     // GGWave instance parameters
@@ -128,6 +218,17 @@ extern "C" {
     //   example, if only Rx is enabled, then the memory buffers needed for the Tx will
     //   not be allocated.
     //
+    //   The analysisThreads is the number of threads used to analyze the captured audio
+    //   of a variable-length transmission once its end marker is received. The candidate
+    //   protocols and frame offsets are distributed among the threads and the search stops
+    //   as soon as a valid candidate is found. The decoded result is the same as with a
+    //   single thread. If analysisThreads <= 1, the analysis runs on the calling thread.
+    //   Ignored on platforms without thread support.
+    //   Default value: 1
+    //
+    //   Note: analysisThreads changes the size of the struct - code that calls the C API must be
+    //   rebuilt against this header, and brace-initializers must list all of the fields
+    //
     typedef struct {
         int                 payloadLength;        // payload length
         float               sampleRateInp;        // capture sample rate
@@ -138,13 +239,29 @@ extern "C" {
         ggwave_SampleFormat sampleFormatInp;      // format of the captured audio samples
         ggwave_SampleFormat sampleFormatOut;      // format of the playback audio samples
         int                 operatingMode;        // operating mode
+        int                 analysisThreads;      // number of threads for the analysis of captured data
     } ggwave_Parameters;
 
     // GGWave instances are identified with an integer and are stored
     // in a private map container. Using void * caused some issues with
     // the python module and unfortunately had to do it this way
+    //
+    //   The id of a freed instance is not reused by the next instances, so calling a function with
+    //   a stale id fails instead of operating on an unrelated instance. The container is thread-safe
+    //   and the lookup of the id does not take a lock. Freeing an instance while another thread calls
+    //   a function with the same id is not supported - the other call can use the instance while it
+    //   is being deleted.
+    //
     typedef int ggwave_Instance;
 
+    // Opaque pointer to a GGWave instance
+    //
+    //   The ggwave_object*() functions below are the same as the functions with an ggwave_Instance
+    //   argument, but skip the lookup of the id. Objects created with ggwave_objectInit() are not
+    //   registered in the container and their number is not limited by GGWAVE_MAX_INSTANCES.
+    //
+    typedef struct ggwave_Object ggwave_Object;
+
     // Change file stream for internal ggwave logging. NULL - disable logging
     //
     //   Intentionally passing it as void * instead of FILE * to avoid including a header
@@ -171,11 +288,19 @@ extern "C" {
     //   This function returns an id that can be used to identify this instance.
     //   Make sure to deallocate the instance at the end by calling ggwave_free()
     //
+    //   returns -1 if GGWAVE_MAX_INSTANCES instances already exist
+    //
     GGWAVE_API ggwave_Instance ggwave_init(ggwave_Parameters parameters);
 
     // Free a GGWave instance
     GGWAVE_API void ggwave_free(ggwave_Instance instance);
 
+    // Get the object of a GGWave instance, or NULL if the id is invalid
+    //
+    //   The object remains valid until ggwave_free() is called for the instance
+    //
+    GGWAVE_API ggwave_Object * ggwave_object(ggwave_Instance instance);
+
     // Encode data into audio waveform
     //
     //   instance       - the GGWave instance to use
@@ -236,6 +361,47 @@ extern "C" {
             void * waveformBuffer,
             int query);
 
+    // Start a streaming encode of data into audio waveform
+    //
+    //   instance       - the GGWave instance to use
+    //   payloadBuffer  - the data to encode
+    //   payloadSize    - number of bytes in the input payloadBuffer
+    //   protocolId     - the protocol to use for encoding
+    //   volume         - the volume of the generated waveform [0, 100]
+    //
+    //   returns 0 on success and -1 if there was an error
+    //
+    //   The waveform is then generated in chunks with ggwave_encodeNext(). For example:
+    //
+    //     ggwave_encodeBegin(instance, payload, 4, GGWAVE_PROTOCOL_AUDIBLE_FAST, 25);
+    //
+    //     int n = 0;
+    //     while ((n = ggwave_encodeNext(instance, buffer, samplesPerBuffer)) > 0) {
+    //         ... play n samples from buffer ...
+    //     }
+    //
+    GGWAVE_API int ggwave_encodeBegin(
+            ggwave_Instance instance,
+            const void * payloadBuffer,
+            int payloadSize,
+            ggwave_ProtocolId protocolId,
+            int volume);
+
+    // Generate the next chunk of the waveform started with ggwave_encodeBegin()
+    //
+    //   instance       - the GGWave instance to use
+    //   waveformBuffer - receives the generated samples
+    //   maxSamples     - capacity of waveformBuffer in samples
+    //
+    //   returns the number of generated samples, 0 when the waveform is complete
+    //
+    //   returns -1 if there was an error, or if waveformBuffer is NULL or maxSamples <= 0
+    //
+    GGWAVE_API int ggwave_encodeNext(
+            ggwave_Instance instance,
+            void * waveformBuffer,
+            int maxSamples);
+
     // Decode an audio waveform into data
     //
     //   instance       - the GGWave instance to use
@@ -344,6 +510,56 @@ extern "C" {
     GGWAVE_API int ggwave_rxDurationFrames(
             ggwave_Instance instance);
 
+    // Return the number of frames skipped by the energy gate since the last init
+    //   See GGWAVE_OPERATING_MODE_RX_ENERGY_GATE
+    GGWAVE_API int ggwave_rxFramesSkipped(
+            ggwave_Instance instance);
+
+    // Opaque pointer variants of the functions above - see ggwave_Object
+    GGWAVE_API ggwave_Object * ggwave_objectInit(ggwave_Parameters parameters);
+
+    GGWAVE_API void ggwave_objectFree(ggwave_Object * object);
+
+    GGWAVE_API int ggwave_objectEncode(
+            ggwave_Object * object,
+            const void * payloadBuffer,
+            int payloadSize,
+            ggwave_ProtocolId protocolId,
+            int volume,
+            void * waveformBuffer,
+            int query);
+
+    GGWAVE_API int ggwave_objectEncodeBegin(
+            ggwave_Object * object,
+            const void * payloadBuffer,
+            int payloadSize,
+            ggwave_ProtocolId protocolId,
+            int volume);
+
+    GGWAVE_API int ggwave_objectEncodeNext(
+            ggwave_Object * object,
+            void * waveformBuffer,
+            int maxSamples);
+
+    GGWAVE_API int ggwave_objectDecode(
+            ggwave_Object * object,
+            const void * waveformBuffer,
+            int waveformSize,
+            void * payloadBuffer);
+
+    GGWAVE_API int ggwave_objectNDecode(
+            ggwave_Object * object,
+            const void * waveformBuffer,
+            int waveformSize,
+            void * payloadBuffer,
+            int payloadSize);
+
+    GGWAVE_API int ggwave_objectRxDurationFrames(
+            ggwave_Object * object);
+
+    GGWAVE_API int ggwave_objectRxFramesSkipped(
+            ggwave_Object * object);
+
 #ifdef __cplusplus
 }
 
@@ -391,15 +607,17 @@ private:
     T * m_data;
     int m_size0;
     int m_size1;
+    int m_stride; // elements between the starts of two rows
 
 public:
     using value_type = T;
 
-    ggmatrix() : m_data(nullptr), m_size0(0), m_size1(0) {}
-    ggmatrix(T * data, int size0, int size1) : m_data(data), m_size0(size0), m_size1(size1) {}
+    ggmatrix() : m_data(nullptr), m_size0(0), m_size1(0), m_stride(0) {}
+    ggmatrix(T * data, int size0, int size1) : m_data(data), m_size0(size0), m_size1(size1), m_stride(size1) {}
+    ggmatrix(T * data, int size0, int size1, int stride) : m_data(data), m_size0(size0), m_size1(size1), m_stride(stride) {}
 
     ggvector<T> operator[](int i) {
-        return ggvector<T>(m_data + i*m_size1, m_size1);
+        return ggvector<T>(m_data + i*m_stride, m_size1);
     }
 
     int size() const { return m_size0; }
@@ -434,6 +652,7 @@ public:
     static constexpr auto kMaxLengthFixed              = 64;
     static constexpr auto kMaxSpectrumHistory          = 4;
     static constexpr auto kMaxRecordedFrames           = 2048;
+    static constexpr auto kHeapAlignment               = GGWAVE_CONFIG_HEAP_ALIGNMENT;
 
     using Parameters    = ggwave_Parameters;
     using SampleFormat  = ggwave_SampleFormat;
@@ -570,6 +789,24 @@ public:
     using RecordedData = ggvector<float>;
     using TxRxData     = ggvector<uint8_t>;
 
+    // Allocator of the heap of GGWave instances
+    //
+    //   All buffers of an instance live in a single block of heapSize() bytes. By default it is
+    //   allocated with malloc(). Pass an Allocator to prepare() to place it elsewhere - for example,
+    //   in a preallocated arena, in huge pages or in shared memory.
+    //
+    //   allocate() must return a block of at least "size" bytes aligned to "alignment", or nullptr.
+    //   The block does not need to be zero-initialized. The allocator must outlive the instances
+    //   that use it.
+    //
+    class Allocator {
+    public:
+        virtual ~Allocator() = default;
+
+        virtual void * allocate(int size, int alignment) = 0;
+        virtual void deallocate(void * p, int size) = 0;
+    };
+
     // Default constructor
     //
     //   The GGWave object is not ready to use until you call prepare()
@@ -631,6 +868,20 @@ public:
     //
     bool prepare(const Parameters & parameters, bool allocate = true);
 
+    // Prepare the GGWave object with a custom heap
+    //
+    //   Same as prepare() above, but the heap is obtained from the given allocator, or placed in the
+    //   given externally owned block. The block must be aligned to kHeapAlignment bytes and must be
+    //   at least as large as the heapSize() reported by prepare(parameters, false). It is not freed
+    //   by the instance and must outlive it.
+    //
+    //   When an instance is prepared again, its heap is reused without releasing it if it was
+    //   obtained from the same allocator (or from the default one) and it is large enough for the
+    //   new parameters.
+    //
+    bool prepare(const Parameters & parameters, Allocator & allocator);
+    bool prepare(const Parameters & parameters, void * heap, int heapSize);
+
     // Set file stream for the internal ggwave logging
     //
     //   By default, ggwave prints internal log messages to stderr.
@@ -677,6 +928,59 @@ public:
     //
     uint32_t encode();
 
+    // Start a streaming encode of the Tx data
+    //
+    //   Prepares the transmission set with init() for encodeNext(). The tones are available through
+    //   the txTones() method right away. No waveform samples are generated by this call.
+    //
+    //   Returns false if Tx is disabled
+    //
+    bool encodeBegin();
+
+    // Generate the next chunk of the waveform started with encodeBegin()
+    //
+    //   dst        - receives the samples in the format given by sampleFormatOut()
+    //   maxSamples - capacity of dst in samples
+    //
+    //   The frames are synthesised on demand, so the first chunk is available after a single frame
+    //   has been generated. Concatenating all chunks gives the same waveform as encode().
+    //
+    //   Returns the number of samples written to dst. Returns 0 when the waveform is complete.
+    //   Returns -1 if no waveform was started with encodeBegin(), or if its completion was already
+    //   reported, in which case init() and encodeBegin() must be called again. Returns -1 without
+    //   generating anything if dst is null or maxSamples <= 0
+    //
+    int encodeNext(void * dst, int maxSamples);
+
+    // Payload description for encodeBatch()
+    struct EncodeItem {
+        const void * payload;    // payload data
+        int          payloadSize; // payload size in bytes
+        TxProtocolId protocolId; // Tx protocol to use
+        int          volume;     // volume in [0, 100]
+        void *       output;     // caller-provided buffer for the waveform, or nullptr to query the size
+        uint32_t     outputSize; // size of the output buffer in bytes
+        uint32_t     nBytes;     // [out] size of the generated waveform in bytes, 0 on failure
+    };
+
+    // Encode many payloads in one call
+    //
+    //   parameters - parameters of the instances used for the encoding. Rx is not needed and is disabled
+    //   items      - payloads to encode
+    //   nItems     - number of payloads
+    //   nThreads   - number of threads to distribute the payloads on
+    //
+    //   Each thread encodes its share of the items with its own GGWave instance. The instances use
+    //   GGWAVE_OPERATING_MODE_TX_STREAM and write the waveforms directly into the outputs of the items.
+    //
+    //   If the output of an item is nullptr, nBytes is set to the expected waveform size of the item
+    //   (see encodeSize_bytes()) and nothing is encoded. Items with a smaller outputSize fail without
+    //   writing to their output. Ignores nThreads on platforms without thread support.
+    //
+    //   Returns the number of successfully processed items
+    //
+    static int encodeBatch(const Parameters & parameters, EncodeItem * items, int nItems, int nThreads = 1);
+
     // Decode an audio waveform
     //
     //   data   - pointer to the waveform data
@@ -707,6 +1011,13 @@ public:
 
     int heapSize() const;
 
+    // Memory used by the tables that are shared read-only by all instances in the process, in bytes
+    //
+    //   The FFT tables and the Tx tone tables are not part of heapSize(). Returns 0 without thread
+    //   support, in which case each instance keeps its own tables in its heap.
+    //
+    static int sharedHeapSize();
+
     //
     // Tx
     //
@@ -747,6 +1058,16 @@ public:
     int rxFramesToAnalyze()     const;
     int rxFramesLeftToAnalyze() const;
     int rxDurationFrames()      const;
+    int rxFramesSkipped()       const; // frames skipped by the energy gate since the last init()
+
+    // Front end chosen by prepare()
+    //
+    //   rxNativeRate() is true if the captured audio is received at the capture sample rate - see
+    //   GGWAVE_OPERATING_MODE_RX_NATIVE_RATE. rxDecimation() is the decimation factor of the spectra,
+    //   1 if they are computed at the full rate - see GGWAVE_OPERATING_MODE_RX_DECIMATE.
+    //
+    bool rxNativeRate() const;
+    int  rxDecimation() const;
 
     bool rxStopReceiving();
 
@@ -757,6 +1078,12 @@ public:
     // Note: do not enable protocols that were not enabled upon preparation of the GGWave instance, or the decoding
     // will likely crash
     //
+    // The buffers are sized upon preparation for the protocols enabled at that time. With a variable payload length,
+    // the recording holds the longest transmission of those protocols, and rxDurationFrames() never exceeds it.
+    // A protocol that is enabled or changed later and needs a longer recording cannot be decoded, so the next
+    // decode() call disables it in rxProtocols() and logs a warning. Enable the slowest protocol you need in
+    // GGWave::Protocols::rx() before preparing the instance.
+    //
     RxProtocols & rxProtocols();
 
     // Information about last received data
@@ -767,6 +1094,15 @@ public:
     const Spectrum &     rxSpectrum()   const;
     const Amplitude &    rxAmplitude()  const;
 
+    // The power spectrum of the last analyzed frame
+    //
+    //   rxSpectrum() and rxTakeSpectrum() hold samplesPerFrame values: bin 0 holds the sum of the powers
+    //   of bins 0 and samplesPerFrame/2, and the bins from samplesPerFrame/2 on are zero.
+    //   rxSpectrumHalf() holds only the samplesPerFrame/2 + 1 bins from 0 to the Nyquist frequency, which
+    //   is what the decoder computes.
+    //
+    const Spectrum & rxSpectrumHalf() const;
+
     // Consume the received data
     //
     //   Returns the data length in bytes
@@ -775,6 +1111,7 @@ public:
 
     // Consume the received spectrum / amplitude data
     //
+    //   The spectrum has samplesPerFrame values - see rxSpectrum()
     //   Returns true if there was new data available
     //
     bool rxTakeSpectrum(Spectrum & dst);
@@ -789,7 +1126,8 @@ public:
     //   src - input real-valued data, size is N
     //   dst - output complex-valued data, size is 2*N
     //
-    //   N must be == samplesPerFrame()
+    //   N must be == samplesPerFrame(). Uses the FFT selected by the operating mode - see
+    //   GGWAVE_OPERATING_MODE_FFT_RADIX4
     //
     bool computeFFTR(const float * src, float * dst, int N);
 
@@ -798,7 +1136,7 @@ public:
     //   src - input real-valued data, size is N
     //   dst - output complex-valued data, size is 2*N
     //   wi  - work buffer, with size 2*N
-    //   wf  - work buffer, with size 3 + sqrt(N/2)
+    //   wf  - work buffer, with size N/2
     //
     //   First time calling this function, make sure that wi[0] == 0
     //   This will initialize some internal coefficients and store them in wi and wf for
@@ -810,6 +1148,17 @@ public:
     //
     static int computeFFTR(const float * src, float * dst, int N, int * wi, float * wf);
 
+    // Compute FFT of real values with the FFT tables shared by the process (static)
+    //
+    //   src - input real-valued data, size is N
+    //   dst - output complex-valued data, size is 2*N
+    //
+    //   N must be a power of 2 between 8 and kMaxSamplesPerFrame. The tables for each N are created on
+    //   the first use and are shared read-only by all callers and GGWave instances. Thread-safe.
+    //   Returns false without thread support - use the function above instead.
+    //
+    static bool computeFFTRShared(const float * src, float * dst, int N);
+
     // Filter the waveform
     //
     //   filter   - filter to use
@@ -841,56 +1190,151 @@ public:
         // processing time is linearly related to this width
         static const int kWidth = 64;
 
+        // number of fractional phases in the filter banks of the polyphase engine
+        // the taps of intermediate phases are linearly interpolated
+        static const int kPhases = 64;
+
+        enum Engine {
+            // evaluate the windowed sinc from a lookup table for every tap (reference)
+            kEngineSinc,
+            // dot products with precomputed float filter banks, rebuilt when the factor changes
+            kEnginePolyphase,
+        };
+
         Resampler();
 
-        bool alloc(void * p, int & n);
+        bool alloc(void * p, int & n, Engine engine = kEngineSinc);
 
         void reset();
 
         int nSamplesTotal() const { return m_state.nSamplesTotal; }
 
+        // If samplesOut == nullptr - returns the number of output samples without changing the state
         int resample(
                 float factor,
                 int nSamples,
                 const float * samplesInp,
                 float * samplesOut);
-        
-        
-
 
     private:
         float getData(int j) const;
         void newData(float data);
         void makeSinc();
         double sinc(double x) const;
+        void makeBanks(float factor);
 
-        static const int kDelaySize = 140;
+        // the delay line is a ring buffer of kDelaySize samples, stored twice so that
+        // the window of every output sample is contiguous
+        static const int kDelaySize = 136;
 
         // this defines how finely the sinc function is sampled for storage in the table
         static const int kSamplesPerZeroCrossing = 32;
 
+        Engine m_engine = kEngineSinc;
+        float  m_banksFactor = 0.0f;
+
         ggvector<float> m_sincTable;
         ggvector<float> m_delayBuffer;
         ggvector<float> m_edgeSamples;
         ggvector<float> m_samplesInp;
+        ggvector<float> m_banks; // (kPhases + 1) x 2*kWidth
 
         struct State {
             int nSamplesTotal = 0;
             int timeInt       = 0;
             int timeLast      = 0;
+            int delayPos      = 0;
             double timeNow    = 0.0;
         };
 
         State m_state;
     };
 
+    // Decode captured audio on a background thread - see below
+    class AsyncDecoder;
+
+    // Decode interleaved multi-channel audio with one instance per channel - see below
+    class MultiDecoder;
+
 private:
+    bool prepare(const Parameters & parameters, bool allocate, Allocator * allocator, void * heap, int heapSize);
+    void releaseHeap();
     bool alloc(void * p, int & n);
 
     void decode_fixed();
+
+    // decimating front end - choose the decimation for the enabled Rx protocols and design its filter
+    bool prepareBaseband();
+    void makeBasebandFilter();
+    // band-pass filter and decimate the current frame into dst (complex)
+    void updateBaseband(float * dst);
+    // size of the next frame at the capture sample rate
+    void nextNativeFrame();
+    // spectrum of the band from the FFT of a baseband frame
+    void basebandSpectrum(const float * fftOut, float * spectrum) const;
+    // half spectrum, bins [0, samplesPerFrame/2], from the real FFT of a frame
+    void realSpectrum(const float * fftOut, float * spectrum) const;
+    // copy the half spectrum of the current frame to the layout of rxSpectrum()
+    void updateSpectrumFull();
+
+    // spectrum of a frame of real samples - src may be fftOut, which the FFT overwrites
+    void frameSpectrum(const float * src, float * fftOut, float * spectrum, const int * wi, const float * wf, float * work) const;
+
+    // update the energy gate with the current frame - m_rx.isGateOpen tells if it needs to be analyzed
+    void updateEnergyBands();
+    void updateEnergyGate();
+
+    // true if the bins and the Tx groups of the protocol fit in the spectrum history sized upon preparation
+    bool isFixedProtocolSupported(const Protocol & protocol);
+    // add the frame in the given spectrum history row to the tone votes of the protocol
+    void updateFixedVotes(int protocolId, int historyId);
+    void resetFixedVotes();
+    // tone of the given nibble in the group of Txs that ends at the given frame, or 0xFF if no tone was detected
+    uint8_t fixedTone(const Protocol & protocol, int protocolId, int historyId, int byteId, int nibbleId);
+
     void decode_variable();
 
+    // resolve the bins of the Rx protocols that changed since the last call
+    void updateProtocolBins();
+    // number of marker bits of a protocol that match the start marker, or the end marker, in the current spectrum
+    int countMarkerBits(int protocolId, bool isEnd) const;
+
+    // incremental markers - returns true if the bands of the marker bins changed since the last call
+    bool updateMarkerBands();
+    // complex marker bin values of a frame, stored in the given row of the history
+    void addMarkerFrame(const float * src, int historyId);
+    // marker bins of the spectrum from the last kMaxSpectrumHistory frames, after adding the current frame
+    void updateMarkerSpectrum();
+
+    // buffers needed to analyze a single (protocol, offset) candidate of the captured data
+    struct AnalysisWork {
+        ggvector<float> fftOut; // complex
+        ggvector<int>   fftWorkI;
+        ggvector<float> fftWorkF;
+        ggvector<float> fftWork;
+        Spectrum        spectrum;
+        TxRxData        dataEncoded;
+        TxRxData        data;
+        TxRxData        workRSLength;
+        TxRxData        workRSData;
+    };
+
+    // decode the bytes of the Tx that starts at the given analysis step of the recorded data into dst
+    void analyzeTx(int protocolId, int offsetTx, const AnalysisWork & work, uint8_t * dst);
+    // decode the length header of a candidate - returns the payload length or 0 if the header is not valid
+    int analyzeLength(int protocolId, int offsetStart, const AnalysisWork & work);
+    int analyzeCandidate(int protocolId, int offsetStart, const AnalysisWork & work);
+    void analyzeLengthEarly();
+    // estimate where the payload starts in the recorded data and order m_rx.analysisOffsets by distance from it
+    int estimateDataStart();
+    void analyzeCandidates(int workerId);
+    // copy (or add) n recorded samples, starting at the given sample offset, to dst
+    void readRecorded(int offset, int n, float * dst, bool add) const;
+
     int maxFramesPerTx(const Protocols & protocols, bool excludeMT) const;
+    // number of frames of the longest transmission of the protocol / of the enabled protocols, including the sound markers
+    int durationFrames(const Protocol & protocol, int maxLength) const;
+    int maxDurationFrames(const Protocols & protocols, int maxLength, bool excludeMT) const;
     int minBytesPerTx(const Protocols & protocols) const;
     int maxBytesPerTx(const Protocols & protocols) const;
     int maxTonesPerTx(const Protocols & protocols) const;
@@ -898,6 +1342,13 @@ private:
 
     double bitFreq(const Protocol & p, int bit) const;
 
+    void computeToneTables(AmplitudeArr bit1, AmplitudeArr bit0, int nRows) const;
+    // drop the reference to the shared tone tables - frees them with the last instance that uses them
+    void releaseToneTables();
+
+    // synthesise the next Tx frame into m_tx.outputResampled and return its size in samples
+    int encodeFrame();
+
     // Initialized via prepare()
     float        m_sampleRateInp        = -1.0f;
     float        m_sampleRateOut        = -1.0f;
@@ -928,7 +1379,35 @@ private:
     bool         m_isTxEnabled          = false;
     bool         m_needResampling       = false;
     bool         m_txOnlyTones          = false;
+    bool         m_txStream             = false;
     bool         m_isDSSEnabled         = false;
+    bool         m_resamplerPolyphase   = false;
+    bool         m_rxEarlyStop          = false;
+    bool         m_rxEnergyGate         = false;
+    bool         m_rxDecimate           = false;
+    bool         m_rxNativeRate         = false;
+    bool         m_rxRecordI16          = false;
+    bool         m_fftRadix4            = false;
+    bool         m_rxIncrementalMarkers = false;
+
+    int          m_analysisThreads      = 1;
+
+    // decimating front end - the analyzed signal is the complex, band-pass filtered signal around bin m_basebandCenter,
+    // decimated by m_decimation. With m_decimation == 1 the real samples are analyzed at the full rate. At the native
+    // rate, the filter is evaluated at m_basebandPhases fractional positions between the captured samples
+    int          m_decimation           = 1;
+    int          m_basebandCenter       = 0;
+    int          m_basebandBinStart     = 0;
+    int          m_basebandBinEnd       = 0;
+    int          m_basebandTaps         = 0;
+    int          m_basebandPhases       = 1;
+    double       m_basebandRatio        = 1.0;  // captured samples per sample at sampleRate
+    int          m_analyzedFrameSize    = 0; // floats per frame of the analyzed signal
+
+    // incremental markers - the frames are mixed down to the band of the markers and decimated by m_markerDecimation
+    // with a filter of m_markerTaps taps
+    int          m_markerDecimation     = 1;
+    int          m_markerTaps           = 0;
 
     // Common
     TxRxData m_dataEncoded;
@@ -950,20 +1429,23 @@ private:
         int framesLeftToRecord  = 0;
         int framesToAnalyze     = 0;
         int framesToRecord      = 0;
+        int framesRecordedMax   = 0; // capacity of the recording - the longest transmission of the Rx protocols
         int samplesNeeded       = 0;
+        int frameSize           = 0; // captured samples per frame - m_samplesPerFrame, unless at the native rate
 
         ggvector<float> fftOut; // complex
         ggvector<int>   fftWorkI;
         ggvector<float> fftWorkF;
+        ggvector<float> fftWork; // scratch space of the FFT backend
 
         bool hasNewRxData    = false;
         bool hasNewSpectrum  = false;
         bool hasNewAmplitude = false;
 
-        Spectrum  spectrum;
+        Spectrum  spectrum;     // bins [0, samplesPerFrame/2]
+        Spectrum  spectrumFull; // samplesPerFrame values - see rxSpectrum()
         Amplitude amplitude;
         Amplitude amplitudeResampled;
-        TxRxData  amplitudeTmp;
 
         int dataLength = 0;
 
@@ -975,16 +1457,142 @@ private:
         // variable-length decoding
         int historyId = 0;
 
+        // bins of each Rx protocol, resolved from the fields below when they change
+        struct ProtocolBins {
+            static constexpr auto kMaxBitsInMarker = 16;
+
+            bool enabled     = false;
+            int  freqStart   = -1;
+            int  bytesPerTx  = 0;
+            int  framesPerTx = 0;
+
+            bool     hasMarkers   = false; // the marker bins and their neighbours are within the spectrum
+            uint16_t markerHigh   = 0;     // marker bits that are high in the start marker and low in the end marker
+            int16_t  dataBinStart = 0;     // first bin of the groups of 16 bins of the data nibbles
+
+            int16_t markerBins[kMaxBitsInMarker] = {}; // bin of each marker bit - compared with the next bin
+        };
+
+        ProtocolBins protocolBins[GGWAVE_PROTOCOL_COUNT];
+
+        // the analyzed signal - m_analyzedFrameSize floats per frame
         Amplitude    amplitudeAverage;
         AmplitudeArr amplitudeHistory;
+
+        // incremental markers - while listening, the complex values of the marker bins in each of the frames of the
+        // history. Their average is the DFT of the averaged frame at these bins. One band for each unique start
+        // frequency of the enabled protocols with markers, 2*m_nBitsInMarker*m_freqDelta_bin bins each
+        struct MarkerBand {
+            static constexpr auto kMaxTaps = 16;
+
+            int binStart = 0;
+
+            // reversed taps of the triangular low-pass filter, shifted to the center of the band
+            float mixRe[kMaxTaps];
+            float mixIm[kMaxTaps];
+        };
+
+        int        nMarkerBands = 0;
+        MarkerBand markerBands[GGWAVE_PROTOCOL_COUNT];
+        bool       markersValid = false; // the values of all the frames of the history are up to date
+
+        ggmatrix<float> markerTables; // cos and sin of the Goertzel bank and power correction of each bin of a band
+        ggmatrix<float> markerDFT;    // [historyId] - complex bin values of each band
+        ggvector<float> markerInput;  // the last m_markerTaps - m_markerDecimation samples of the previous frame + the frame
+        ggvector<float> markerWork;   // decimated band, its real and imaginary parts and their Goertzel outputs
         RecordedData amplitudeRecorded;
+        AmplitudeI16 amplitudeRecordedI16; // used instead of amplitudeRecorded with GGWAVE_OPERATING_MODE_RX_RECORD_I16
+
+        // decimating front end
+        ggvector<float> basebandFilter; // reversed taps of the complex band-pass filter - real parts, then imaginary,
+                                        // for each fractional phase
+        ggvector<float> basebandInput;  // the last samples of the previous frame + the current frame
+        ggvector<float> basebandGain;   // inverse power response of the filter at each bin of the band
+        ggvector<float> baseband;       // complex, decimated samples of the current frame (variable payload length)
+
+        // native rate - position of the last decimated sample of the current frame, relative to its first
+        // captured sample
+        double basebandLast = 0.0;
+
+        // early stop - the length header is decoded after framesToProbe recorded frames. The recording then
+        // ends at the expected end of each protocol with a valid header, analyzing only that protocol
+        bool earlyStop     = false;
+        int  framesToProbe = 0;
+        int  framesEarly[GGWAVE_PROTOCOL_COUNT]; // 0 - the header is not valid for the protocol
+
+        // timing recovery - the candidate offsets are analyzed starting from the one closest to the end of
+        // the start marker, estimated from the marker tones in the recorded data
+        ggvector<float>   syncTwiddles;    // DFT coefficients of the marker bins over one analysis step
+        ggvector<float>   syncSteps;       // complex marker bin values of each analysis step of the recorded data
+        ggvector<float>   syncWindow;      // complex marker bin values of the current frame-long window
+        ggvector<float>   syncScore;       // marker score of each frame-long window of the recorded data
+        ggvector<int16_t> analysisOffsets; // candidate offsets in the order in which they are analyzed
+
+        // energy gate - the frames are not analyzed while the energy in the frequency bands of the enabled
+        // protocols stays close to its noise floor
+        struct EnergyBand {
+            static constexpr auto kMaxBlockSize = 32;
+
+            int binStart = 0;
+            int binEnd   = 0;
+
+            // the samples are mixed down from the center of the band and summed in blocks, which low-pass
+            // filters them to about the width of the band
+            int   blockSize = 0;
+            float mixRe[kMaxBlockSize];
+            float mixIm[kMaxBlockSize];
+
+            float noiseFloor = 0.0f; // mean energy of the blocks, 0 - not measured yet
+        };
+
+        int        nEnergyBands = 0;
+        EnergyBand energyBands[GGWAVE_PROTOCOL_COUNT];
+
+        bool      isGateOpen    = true;
+        int       gateHangover  = 0; // frames left before the gate closes
+        int       framesSkipped = 0;
+        Amplitude gatePrevious;      // last skipped frame - analyzed before the frame that opens the gate
+        int       gatePreviousSize = 0;   // frameSize and basebandLast of the last skipped frame
+        double    gatePreviousLast = 0.0;
+
+        // parallel analysis - one row for each additional analysis thread
+        ggmatrix<float>   analysisFftOut;
+        ggmatrix<float>   analysisFftWork;
+        ggmatrix<float>   analysisSpectrum;
+        ggmatrix<uint8_t> analysisDataEncoded;
+        ggmatrix<uint8_t> analysisData;
+        ggmatrix<uint8_t> analysisWorkRSLength;
+        ggmatrix<uint8_t> analysisWorkRSData;
 
         // fixed-length decoding
         int historyIdFixed = 0;
 
         ggmatrix<uint8_t> spectrumHistoryFixed;
         ggvector<uint8_t> detectedBins;
-        ggvector<uint8_t> detectedTones;
+
+        // incremental tone voting - for each protocol, a new frame adds its votes and retires the votes of the
+        // frame that leaves the Tx, so the cost per frame does not depend on the length of the payload. The rows
+        // of the per-frame buffers are [historyId*GGWAVE_PROTOCOL_COUNT + protocolId]
+        struct FixedVotes {
+            bool enabled    = false;
+            int freqStart   = 0;
+            int framesPerTx = 0;
+            int bytesPerTx  = 0;
+            int extra       = 0;
+
+            int phase     = 0; // position of the newest frame in its group of Txs
+            int nFrames   = 0; // frames added since the votes were reset, up to the history size
+            int nDetected = 0; // tones detected in the window that ends at the newest frame
+        };
+
+        bool       fixedVotesValid = false;
+        FixedVotes fixedVotes[GGWAVE_PROTOCOL_COUNT];
+
+        ggmatrix<uint8_t> fixedBins;     // strongest bin of each group of 16 bins in a frame
+        ggmatrix<uint8_t> fixedTones;    // tone with more than framesPerTx/2 votes in the Tx that ends at a frame, or 0xFF
+        ggmatrix<uint8_t> fixedDetected; // number of tones detected in the group of Txs that ends at a frame
+        ggmatrix<uint8_t> fixedCounts;   // votes for each tone in the last framesPerTx frames - [protocolId*nSlots + slot]
+        ggmatrix<int>     fixedPhaseSum; // tones detected in the previous groups of Txs of the window - [protocolId][phase]
     } m_rx;
 
     struct Tx {
@@ -995,8 +1603,21 @@ private:
         int dataLength = 0;
         int lastAmplitudeSize = 0;
 
+        // state of the frame synthesis
+        int totalDataFrames = 0;
+        int frameId         = 0;
+        int frameSize       = 0;
+        int framePos        = 0;
+
+        bool isEncoding = false; // started with encodeBegin(), until encodeNext() reports the end of the waveform
+
         ggvector<bool> dataBits;
-        ggvector<double> phaseOffsets;
+
+        // the tone tables depend only on the start frequency and the number of data bits of the protocol
+        // when threads are supported, they point to tables shared by all instances with the same parameters,
+        // which hold a reference to them while tablesFreqStart >= 0
+        int tablesFreqStart      = -1;
+        int tablesDataBitsPerTx  = -1;
 
         AmplitudeArr bit1Amplitude;
         AmplitudeArr bit0Amplitude;
@@ -1016,8 +1637,171 @@ private:
 
     mutable Resampler m_resampler;
 
+    // thread pool for the analysis of the captured data
+    struct Workers;
+    Workers * m_workers = nullptr;
+
     void * m_heap  = nullptr;
     int m_heapSize = 0;
+
+    // the heap can be larger than heapSize() when it is reused or provided by the user
+    Allocator * m_allocator    = nullptr; // nullptr - malloc() / free()
+    void *      m_heapBlock    = nullptr; // the allocated block - m_heap is aligned within it
+    bool        m_heapOwned    = false;
+    int         m_heapCapacity = 0;
+};
+
+// Asynchronous decoder
+//
+//   Decouples the capture of the audio from its decoding. The captured samples are pushed into a
+//   lock-free single-producer / single-consumer ring buffer and are decoded on a background thread
+//   by a GGWave instance owned by the decoder. The capture thread only copies the samples, so it
+//   never waits for the FFT and Reed-Solomon work needed to decode a transmission.
+//
+//   The decoded payloads are delivered through the optional callback, which is invoked on the
+//   background thread, and through a queue that can be polled with takeData().
+//
+//   The owned instance is prepared with the given parameters and the Rx protocols enabled in
+//   GGWave::Protocols::rx() at the time of construction. All memory is allocated by the constructor.
+//   Not available on platforms without thread support - isValid() returns false.
+//
+//     GGWave::AsyncDecoder decoder(GGWave::getDefaultParameters());
+//
+//     // capture thread
+//     decoder.push(samples, nBytes);
+//
+//     // any other thread
+//     uint8_t payload[GGWave::kMaxDataSize];
+//     GGWave::RxProtocolId protocolId;
+//     while (int n = decoder.takeData(payload, sizeof(payload), protocolId)) {
+//         ...
+//     }
+//
+class GGWave::AsyncDecoder {
+public:
+    static constexpr auto kDefaultRingSize_frames = 64;
+    static constexpr auto kMaxResults             = 8;
+
+    // Invoked on the background thread for each successfully decoded payload
+    using Callback = void (*)(const uint8_t * data, int dataSize, RxProtocolId protocolId, void * userData);
+
+    // ringSize_frames - capacity of the capture ring buffer in number of audio frames
+    AsyncDecoder(
+            const Parameters & parameters,
+            int ringSize_frames = kDefaultRingSize_frames,
+            Callback callback = nullptr,
+            void * userData = nullptr);
+
+    ~AsyncDecoder();
+
+    AsyncDecoder(const AsyncDecoder &) = delete;
+    AsyncDecoder & operator=(const AsyncDecoder &) = delete;
+
+    // Returns false if the decoder failed to initialize
+    bool isValid() const;
+
+    // Push captured audio samples in the format given by the sampleFormatInp parameter
+    //
+    //   Never blocks. Call this from a single thread only.
+    //   If the ring buffer is full, the samples that do not fit are dropped.
+    //
+    //   Returns the number of accepted bytes
+    //
+    uint32_t push(const void * data, uint32_t nBytes);
+
+    // Take the oldest decoded payload from the result queue
+    //
+    //   dst         - destination buffer for the payload
+    //   dstSize     - size of the destination buffer in bytes
+    //   protocolId  - the Rx protocol of the decoded payload
+    //
+    //   Call this from a single thread only.
+    //   If the result queue is full, new results are dropped until some are taken.
+    //
+    //   Returns the size of the payload, 0 if there is nothing to take, or -1 if dst is too small
+    //
+    int takeData(void * dst, int dstSize, RxProtocolId & protocolId);
+
+    // Block until all samples pushed so far have been decoded
+    void flush();
+
+    // Number of bytes dropped because the ring buffer was full
+    uint64_t nDroppedBytes() const;
+
+private:
+    struct Impl;
+    Impl * m_impl = nullptr;
+};
+
+// Multi-channel decoder
+//
+//   Convenience helper for interleaved audio captured from several channels - for example, the
+//   microphones of an array or the inputs of a multi-line capture card. It owns one independent
+//   GGWave instance per channel, splits each decode() call into one contiguous buffer per channel,
+//   decodes the channels one after the other and collects the payloads of all channels in a single
+//   queue. The cost and the memory are those of nChannels separate instances - only the tables that
+//   all instances share anyway, such as the FFT tables, are not duplicated.
+//
+//   The instances are prepared for Rx only, with the given parameters and the Rx protocols enabled
+//   in GGWave::Protocols::rx() at the time of construction. All memory is allocated by the constructor.
+//   The decoder must not be used from several threads at once.
+//
+//     GGWave::MultiDecoder decoder(GGWave::getDefaultParameters(), 4);
+//
+//     decoder.decode(samples, nBytes); // 4 interleaved channels
+//
+//     uint8_t payload[GGWave::kMaxDataSize];
+//     int channel;
+//     GGWave::RxProtocolId protocolId;
+//     while (int n = decoder.takeData(payload, sizeof(payload), channel, protocolId)) {
+//         ...
+//     }
+//
+class GGWave::MultiDecoder {
+public:
+    static constexpr auto kMaxChannels = 64;
+    static constexpr auto kMaxResults  = 16;
+
+    MultiDecoder(const Parameters & parameters, int nChannels);
+    ~MultiDecoder();
+
+    MultiDecoder(const MultiDecoder &) = delete;
+    MultiDecoder & operator=(const MultiDecoder &) = delete;
+
+    // Returns false if the decoder failed to initialize
+    bool isValid() const;
+
+    int nChannels() const;
+
+    // Total memory used by the instances of the channels, in bytes
+    int heapSize() const;
+
+    // The instance that decodes the given channel
+    const GGWave & instance(int channel) const;
+
+    // Decode interleaved samples of all channels in the format given by the sampleFormatInp parameter
+    //
+    //   nBytes must be a multiple of the size of one sample of all channels.
+    //   If the result queue is full, new results are dropped until some are taken.
+    //
+    //   Returns false if the data cannot be decoded
+    //
+    bool decode(const void * data, uint32_t nBytes);
+
+    // Take the oldest decoded payload from the result queue
+    //
+    //   dst         - destination buffer for the payload
+    //   dstSize     - size of the destination buffer in bytes
+    //   channel     - the channel in which the payload was decoded
+    //   protocolId  - the Rx protocol of the decoded payload
+    //
+    //   Returns the size of the payload, 0 if there is nothing to take, or -1 if dst is too small
+    //
+    int takeData(void * dst, int dstSize, int & channel, RxProtocolId & protocolId);
+
+private:
+    struct Impl;
+    Impl * m_impl = nullptr;
 };
 
 #endif
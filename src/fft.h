@@ -21,11 +21,56 @@ Fast Fourier/Cosine/Sine Transform
     data        :inplace
     table       :use
 functions
+    cdft: Complex Discrete Fourier Transform
     rdft: Real Discrete Fourier Transform
 function prototypes
+    void cdft(int, int, float *, int *, float *);
     void rdft(int, int, float *, int *, float *);
 
 
+-------- Complex DFT (Discrete Fourier Transform) --------
+    [definition]
+        <case1>
+            X[k] = sum_j=0^n-1 x[j]*exp(2*pi*i*j*k/n), 0<=k<n
+        <case2>
+            X[k] = sum_j=0^n-1 x[j]*exp(-2*pi*i*j*k/n), 0<=k<n
+        (notes: sum_j=0^n-1 is a summation from j=0 to n-1)
+    [usage]
+        <case1>
+            ip[0] = 0; // first time only
+            cdft(2*n, 1, a, ip, w);
+        <case2>
+            ip[0] = 0; // first time only
+            cdft(2*n, -1, a, ip, w);
+    [parameters]
+        2*n            :data length (int)
+                        n >= 1, n = power of 2
+        a[0...2*n-1]   :input/output data (float *)
+                        input data
+                            a[2*j] = Re(x[j]),
+                            a[2*j+1] = Im(x[j]), 0<=j<n
+                        output data
+                            a[2*k] = Re(X[k]),
+                            a[2*k+1] = Im(X[k]), 0<=k<n
+        ip[0...*]      :work area for bit reversal (int *)
+                        length of ip >= 2+sqrt(n)
+                        strictly,
+                        length of ip >=
+                            2+(1<<(int)(log(n+0.5)/log(2))/2).
+                        ip[0],ip[1] are pointers of the cos/sin table.
+        w[0...n/2-1]   :cos/sin table (float *)
+                        w[],ip[] are initialized if ip[0] == 0.
+    [remark]
+        Inverse of
+            cdft(2*n, -1, a, ip, w);
+        is
+            cdft(2*n, 1, a, ip, w);
+            for (j = 0; j <= 2 * n - 1; j++) {
+                a[j] *= 1.0 / n;
+            }
+        .
+
+
 -------- Real DFT / Inverse of Real DFT --------
     [definition]
         <case1> RDFT
@@ -80,17 +125,26 @@ Appendix :
     w[] and ip[] are compatible with all routines.
 */
 
+void cdft(int n, int isgn, float *a, const int *ip, const float *w, int *ipw);
+
+void cdft(int n, int isgn, float *a, int *ip, float *w)
+{
+    void makewt(int nw, int *ip, float *w);
+
+    if (n > (ip[0] << 2)) {
+        makewt(n >> 2, ip, w);
+    }
+    cdft(n, isgn, a, ip, w, ip + 2);
+}
+
+
+void rdft(int n, int isgn, float *a, const int *ip, const float *w, int *ipw);
+
 void rdft(int n, int isgn, float *a, int *ip, float *w)
 {
     void makewt(int nw, int *ip, float *w);
     void makect(int nc, int *ip, float *c);
-    void bitrv2(int n, int *ip, float *a);
-    void cftfsub(int n, float *a, float *w);
-    void cftbsub(int n, float *a, float *w);
-    void rftfsub(int n, float *a, int nc, float *c);
-    void rftbsub(int n, float *a, int nc, float *c);
     int nw, nc;
-    float xi;
 
     nw = ip[0];
     if (n > (nw << 2)) {
@@ -102,9 +156,56 @@ void rdft(int n, int isgn, float *a, int *ip, float *w)
         nc = n >> 2;
         makect(nc, ip, w + nw);
     }
+    rdft(n, isgn, a, ip, w, ip + 2);
+}
+
+/*
+    Same as cdft() and rdft() above, but ip[] and w[] are only read, so the tables can be shared between
+    threads. They must be initialized for a data length >= n - for example, by a previous call of the
+    functions above. The bit reversal uses the separate work area ipw[0...*], with length >= sqrt(n).
+*/
+
+void cdft(int n, int isgn, float *a, const int *ip, const float *w_, int *ipw)
+{
+    void bitrv2(int n, int *ip, float *a);
+    void bitrv2conj(int n, int *ip, float *a);
+    void cftfsub(int n, float *a, float *w);
+    void cftbsub(int n, float *a, float *w);
+
+    float *w = const_cast<float *>(w_);
+
+    (void) ip;
+    if (n > 4) {
+        if (isgn >= 0) {
+            bitrv2(n, ipw, a);
+            cftfsub(n, a, w);
+        } else {
+            bitrv2conj(n, ipw, a);
+            cftbsub(n, a, w);
+        }
+    } else if (n == 4) {
+        cftfsub(n, a, w);
+    }
+}
+
+
+void rdft(int n, int isgn, float *a, const int *ip, const float *w_, int *ipw)
+{
+    void bitrv2(int n, int *ip, float *a);
+    void cftfsub(int n, float *a, float *w);
+    void cftbsub(int n, float *a, float *w);
+    void rftfsub(int n, float *a, int nc, float *c);
+    void rftbsub(int n, float *a, int nc, float *c);
+    int nw, nc;
+    float xi;
+
+    float *w = const_cast<float *>(w_);
+
+    nw = ip[0];
+    nc = ip[1];
     if (isgn >= 0) {
         if (n > 4) {
-            bitrv2(n, ip + 2, a);
+            bitrv2(n, ipw, a);
             cftfsub(n, a, w);
             rftfsub(n, a, nc, w + nw);
         } else if (n == 4) {
@@ -118,7 +219,7 @@ void rdft(int n, int isgn, float *a, int *ip, float *w)
         a[0] -= a[1];
         if (n > 4) {
             rftbsub(n, a, nc, w + nw);
-            bitrv2(n, ip + 2, a);
+            bitrv2(n, ipw, a);
             cftbsub(n, a, w);
         } else if (n == 4) {
             cftfsub(n, a, w);
@@ -5,12 +5,30 @@
 #endif
 
 #include "fft.h"
+#include "simd.h"
 #include "reed-solomon/rs.hpp"
 
 #include <math.h>
 #include <stdio.h>
 //#include <random>
 
+#if !defined(ARDUINO) && !defined(ESP_PLATFORM) && !defined(__EMSCRIPTEN__) && !defined(GGWAVE_CONFIG_NO_THREADS)
+#define GGWAVE_CONFIG_THREADS
+#endif
+
+// build only the Ooura FFT - the radix-4 FFT needs larger tables and a work buffer of 2*samplesPerFrame floats
+#if (defined(ARDUINO) || defined(ESP_PLATFORM)) && !defined(GGWAVE_CONFIG_FFT_OOURA)
+#define GGWAVE_CONFIG_FFT_OOURA
+#endif
+
+#ifdef GGWAVE_CONFIG_THREADS
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#endif
+
 #define GGWAVE_DISABLE_LOG 1
 
 #ifndef M_PI
@@ -38,12 +56,201 @@
 namespace {
 
 FILE * g_fptr = stderr;
-GGWave * g_instances[GGWAVE_MAX_INSTANCES];
 
 double linear_interp(double first_number, double second_number, double fraction) {
     return (first_number + ((second_number - first_number)*fraction));
 }
 
+// dst[i] = sin(phase + i*step), computed by rotating a unit phasor instead of calling sin() for each sample
+void generateSine(float * dst, int n, double step, double phase) {
+    const double c = cos(step);
+    const double s = sin(step);
+
+    double re = cos(phase);
+    double im = sin(phase);
+
+    for (int i = 0; i < n; ++i) {
+        dst[i] = im;
+
+        const double tmp = re*c - im*s;
+        im = re*s + im*c;
+        re = tmp;
+    }
+}
+
+#ifdef GGWAVE_CONFIG_THREADS
+
+// Tx tone tables shared read-only by all instances in the process
+//
+//   The tables are created the first time an instance encodes with a given combination of sample rate,
+//   frame size and protocol tone layout. They are reference-counted and freed when the last instance that
+//   uses them is destroyed, prepared again or switches to another protocol tone layout.
+//
+struct ToneTables {
+    float sampleRate     = 0.0f;
+    int samplesPerFrame = 0;
+    int freqStart       = 0;
+    int nDataBitsPerTx  = 0;
+    int nRefs           = 0;
+
+    std::vector<float> bit1;
+    std::vector<float> bit0;
+};
+
+std::mutex g_toneTablesMutex;
+std::vector<ToneTables *> g_toneTables;
+
+// FFT tables shared read-only by all instances in the process, keyed by the FFT size and backend
+//
+//   The tables are created the first time an instance with a given frame size is prepared, or the first time
+//   computeFFTRShared() is called with a given size, and live until the process exits.
+//
+struct FFTBackend;
+
+struct FFTPlan {
+    int N = 0;
+    const FFTBackend * backend = nullptr;
+
+    std::vector<int>   wi;
+    std::vector<float> wf;
+};
+
+std::mutex g_fftPlansMutex;
+std::vector<FFTPlan *> g_fftPlans;
+
+#endif
+
+#ifdef GGWAVE_CONFIG_THREADS
+template <typename T>
+using ggatomic = std::atomic<T>;
+#else
+template <typename T>
+struct ggatomic {
+    ggatomic() : value() {}
+    ggatomic(T v) : value(v) {}
+    T load() const { return value; }
+    void store(T v) { value = v; }
+    T value;
+};
+#endif
+
+// Registry of the instances created through the C interface
+//
+//   A handle stores the slot index in the low kInstanceSlotBits bits and the generation of the slot
+//   in the remaining bits. The generation is bumped when the instance is freed, so a stale handle does
+//   not alias an instance that is later created in the same slot. A slot whose generation would wrap
+//   around is retired instead of being reused. The slots live in chunks that are allocated on demand
+//   and never released, so looking up a handle does not need the registry lock.
+//
+constexpr int kInstanceSlotBits      = 16;
+constexpr int kInstanceSlotsPerChunk = 256;
+constexpr int kInstanceChunks        = (1 << kInstanceSlotBits)/kInstanceSlotsPerChunk;
+constexpr int kInstanceGenerations   = 1 << (31 - kInstanceSlotBits);
+
+static_assert(GGWAVE_MAX_INSTANCES == (1 << kInstanceSlotBits), "GGWAVE_MAX_INSTANCES does not match the handle layout");
+
+struct InstanceSlot {
+    ggatomic<GGWave *> instance   { nullptr };
+    ggatomic<int>      generation { 0 };
+
+    int nextFree = -1; // protected by the registry lock
+};
+
+struct InstanceRegistry {
+    ggatomic<InstanceSlot *> chunks[kInstanceChunks];
+
+    int nSlots   = 0;
+    int freeHead = -1;
+
+#ifdef GGWAVE_CONFIG_THREADS
+    std::mutex mutex;
+#endif
+
+    InstanceSlot & slot(int idx) const {
+        return chunks[idx/kInstanceSlotsPerChunk].load()[idx%kInstanceSlotsPerChunk];
+    }
+
+    ggwave_Instance add(GGWave * instance) {
+#ifdef GGWAVE_CONFIG_THREADS
+        std::lock_guard<std::mutex> lock(mutex);
+#endif
+
+        int idx = freeHead;
+        if (idx >= 0) {
+            freeHead = slot(idx).nextFree;
+        } else {
+            if (nSlots == GGWAVE_MAX_INSTANCES) {
+                return -1;
+            }
+            if (nSlots%kInstanceSlotsPerChunk == 0) {
+                chunks[nSlots/kInstanceSlotsPerChunk].store(new InstanceSlot[kInstanceSlotsPerChunk]);
+            }
+            idx = nSlots++;
+        }
+
+        auto & s = slot(idx);
+        s.instance.store(instance);
+
+        return (s.generation.load() << kInstanceSlotBits) | idx;
+    }
+
+    GGWave * get(ggwave_Instance id) const {
+        if (id < 0) {
+            return nullptr;
+        }
+
+        const int idx = id & (GGWAVE_MAX_INSTANCES - 1);
+        const auto chunk = chunks[idx/kInstanceSlotsPerChunk].load();
+        if (chunk == nullptr) {
+            return nullptr;
+        }
+
+        // the generation is checked after loading the instance - remove() bumps it before the slot can be
+        // reused, so an instance created in the slot after the handle was freed is never returned
+        const auto & s = chunk[idx%kInstanceSlotsPerChunk];
+        GGWave * instance = s.instance.load();
+        if (s.generation.load() != (id >> kInstanceSlotBits)) {
+            return nullptr;
+        }
+
+        return instance;
+    }
+
+    GGWave * remove(ggwave_Instance id) {
+#ifdef GGWAVE_CONFIG_THREADS
+        std::lock_guard<std::mutex> lock(mutex);
+#endif
+
+        GGWave * instance = get(id);
+        if (instance == nullptr) {
+            return nullptr;
+        }
+
+        const int idx = id & (GGWAVE_MAX_INSTANCES - 1);
+
+        auto & s = slot(idx);
+        const int generation = s.generation.load() + 1;
+        if (generation == kInstanceGenerations) {
+            // retired - the handles of all generations of the slot stay invalid
+            s.instance.store(nullptr);
+            return instance;
+        }
+
+        s.generation.store(generation);
+        s.instance.store(nullptr);
+        s.nextFree = freeHead;
+        freeHead = idx;
+
+        return instance;
+    }
+};
+
+InstanceRegistry g_instances;
+
+GGWave * toInstance(ggwave_Object * object) {
+    return reinterpret_cast<GGWave *>(object);
+}
+
 }
 
 extern "C"
@@ -57,10 +264,8 @@ ggwave_Parameters ggwave_getDefaultParameters(void) {
 }
 
 extern "C"
-ggwave_Instance ggwave_init(ggwave_Parameters parameters) {
-    for (ggwave_Instance id = 0; id < GGWAVE_MAX_INSTANCES; ++id) {
-        if (g_instances[id] == nullptr) {
-            g_instances[id] = new GGWave({
+ggwave_Object * ggwave_objectInit(ggwave_Parameters parameters) {
+    return reinterpret_cast<ggwave_Object *>(new GGWave({
                 parameters.payloadLength,
                 parameters.sampleRateInp,
                 parameters.sampleRateOut,
@@ -69,47 +274,33 @@ ggwave_Instance ggwave_init(ggwave_Parameters parameters) {
                 parameters.soundMarkerThreshold,
                 parameters.sampleFormatInp,
                 parameters.sampleFormatOut,
-                parameters.operatingMode});
-
-            return id;
-        }
-    }
-
-    ggprintf("Failed to create GGWave instance - reached maximum number of instances (%d)\n", GGWAVE_MAX_INSTANCES);
-
-    return -1;
+                parameters.operatingMode,
+                parameters.analysisThreads}));
 }
 
 extern "C"
-void ggwave_free(ggwave_Instance id) {
-    if (id >= 0 && id < GGWAVE_MAX_INSTANCES && g_instances[id]) {
-        delete (GGWave *) g_instances[id];
-        g_instances[id] = nullptr;
-
-        return;
-    }
-
-    ggprintf("Failed to free GGWave instance - invalid GGWave instance id %d\n", id);
+void ggwave_objectFree(ggwave_Object * object) {
+    delete toInstance(object);
 }
 
 extern "C"
-int ggwave_encode(
-        ggwave_Instance id,
+int ggwave_objectEncode(
+        ggwave_Object * object,
         const void * payloadBuffer,
         int payloadSize,
         ggwave_ProtocolId protocolId,
         int volume,
         void * waveformBuffer,
         int query) {
-    GGWave * ggWave = (GGWave *) g_instances[id];
+    GGWave * ggWave = toInstance(object);
 
     if (ggWave == nullptr) {
-        ggprintf("Invalid GGWave instance %d\n", id);
+        ggprintf("Invalid GGWave instance\n");
         return -1;
     }
 
     if (ggWave->init(payloadSize, (const char *) payloadBuffer, protocolId, volume) == false) {
-        ggprintf("Failed to initialize Tx transmission for GGWave instance %d\n", id);
+        ggprintf("Failed to initialize Tx transmission for GGWave instance %p\n", (void *) ggWave);
         return -1;
     }
 
@@ -123,7 +314,7 @@ int ggwave_encode(
 
     const int nBytes = ggWave->encode();
     if (nBytes == 0) {
-        ggprintf("Failed to encode data - GGWave instance %d\n", id);
+        ggprintf("Failed to encode data - GGWave instance %p\n", (void *) ggWave);
         return -1;
     }
 
@@ -137,42 +328,63 @@ int ggwave_encode(
 }
 
 extern "C"
-int ggwave_decode(
-        ggwave_Instance id,
-        const void * waveformBuffer,
-        int waveformSize,
-        void * payloadBuffer) {
-    GGWave * ggWave = (GGWave *) g_instances[id];
+int ggwave_objectEncodeBegin(
+        ggwave_Object * object,
+        const void * payloadBuffer,
+        int payloadSize,
+        ggwave_ProtocolId protocolId,
+        int volume) {
+    GGWave * ggWave = toInstance(object);
 
-    if (ggWave->decode(waveformBuffer, waveformSize) == false) {
-        ggprintf("Failed to decode data - GGWave instance %d\n", id);
+    if (ggWave == nullptr) {
+        ggprintf("Invalid GGWave instance\n");
         return -1;
     }
 
-    static thread_local GGWave::TxRxData data;
+    if (ggWave->init(payloadSize, (const char *) payloadBuffer, protocolId, volume) == false) {
+        ggprintf("Failed to initialize Tx transmission for GGWave instance %p\n", (void *) ggWave);
+        return -1;
+    }
 
-    const auto dataLength = ggWave->rxTakeData(data);
-    if (dataLength == -1) {
-        // failed to decode message
+    if (ggWave->encodeBegin() == false) {
+        ggprintf("Failed to start encoding - GGWave instance %p\n", (void *) ggWave);
         return -1;
-    } else if (dataLength > 0) {
-        memcpy(payloadBuffer, data.data(), dataLength);
     }
 
-    return dataLength;
+    return 0;
 }
 
 extern "C"
-int ggwave_ndecode(
-        ggwave_Instance id,
+int ggwave_objectEncodeNext(
+        ggwave_Object * object,
+        void * waveformBuffer,
+        int maxSamples) {
+    GGWave * ggWave = toInstance(object);
+
+    if (ggWave == nullptr) {
+        ggprintf("Invalid GGWave instance\n");
+        return -1;
+    }
+
+    return ggWave->encodeNext(waveformBuffer, maxSamples);
+}
+
+extern "C"
+int ggwave_objectNDecode(
+        ggwave_Object * object,
         const void * waveformBuffer,
         int waveformSize,
         void * payloadBuffer,
         int payloadSize) {
-    GGWave * ggWave = (GGWave *) g_instances[id];
+    GGWave * ggWave = toInstance(object);
+
+    if (ggWave == nullptr) {
+        ggprintf("Invalid GGWave instance\n");
+        return -1;
+    }
 
     if (ggWave->decode(waveformBuffer, waveformSize) == false) {
-        ggprintf("Failed to decode data - GGWave instance %d\n", id);
+        ggprintf("Failed to decode data - GGWave instance %p\n", (void *) ggWave);
         return -1;
     }
 
@@ -192,6 +404,117 @@ int ggwave_ndecode(
     return dataLength;
 }
 
+extern "C"
+int ggwave_objectDecode(
+        ggwave_Object * object,
+        const void * waveformBuffer,
+        int waveformSize,
+        void * payloadBuffer) {
+    return ggwave_objectNDecode(object, waveformBuffer, waveformSize, payloadBuffer, GGWave::kMaxDataSize);
+}
+
+extern "C"
+int ggwave_objectRxDurationFrames(ggwave_Object * object) {
+    GGWave * ggWave = toInstance(object);
+
+    if (ggWave == nullptr) {
+        ggprintf("Invalid GGWave instance\n");
+        return -1;
+    }
+
+    return ggWave->rxDurationFrames();
+}
+
+extern "C"
+int ggwave_objectRxFramesSkipped(ggwave_Object * object) {
+    GGWave * ggWave = toInstance(object);
+
+    if (ggWave == nullptr) {
+        ggprintf("Invalid GGWave instance\n");
+        return -1;
+    }
+
+    return ggWave->rxFramesSkipped();
+}
+
+extern "C"
+ggwave_Instance ggwave_init(ggwave_Parameters parameters) {
+    auto object = ggwave_objectInit(parameters);
+
+    const ggwave_Instance id = g_instances.add(toInstance(object));
+    if (id < 0) {
+        ggprintf("Failed to create GGWave instance - reached maximum number of instances (%d)\n", GGWAVE_MAX_INSTANCES);
+        ggwave_objectFree(object);
+    }
+
+    return id;
+}
+
+extern "C"
+void ggwave_free(ggwave_Instance id) {
+    if (GGWave * ggWave = g_instances.remove(id)) {
+        delete ggWave;
+
+        return;
+    }
+
+    ggprintf("Failed to free GGWave instance - invalid GGWave instance id %d\n", id);
+}
+
+extern "C"
+ggwave_Object * ggwave_object(ggwave_Instance id) {
+    return reinterpret_cast<ggwave_Object *>(g_instances.get(id));
+}
+
+extern "C"
+int ggwave_encode(
+        ggwave_Instance id,
+        const void * payloadBuffer,
+        int payloadSize,
+        ggwave_ProtocolId protocolId,
+        int volume,
+        void * waveformBuffer,
+        int query) {
+    return ggwave_objectEncode(ggwave_object(id), payloadBuffer, payloadSize, protocolId, volume, waveformBuffer, query);
+}
+
+extern "C"
+int ggwave_encodeBegin(
+        ggwave_Instance id,
+        const void * payloadBuffer,
+        int payloadSize,
+        ggwave_ProtocolId protocolId,
+        int volume) {
+    return ggwave_objectEncodeBegin(ggwave_object(id), payloadBuffer, payloadSize, protocolId, volume);
+}
+
+extern "C"
+int ggwave_encodeNext(
+        ggwave_Instance id,
+        void * waveformBuffer,
+        int maxSamples) {
+    return ggwave_objectEncodeNext(ggwave_object(id), waveformBuffer, maxSamples);
+}
+
+extern "C"
+int ggwave_decode(
+        ggwave_Instance id,
+        const void * waveformBuffer,
+        int waveformSize,
+        void * payloadBuffer) {
+    return ggwave_objectDecode(ggwave_object(id), waveformBuffer, waveformSize, payloadBuffer);
+}
+
+extern "C"
+int ggwave_ndecode(
+        ggwave_Instance id,
+        const void * waveformBuffer,
+        int waveformSize,
+        void * payloadBuffer,
+        int payloadSize) {
+    return ggwave_objectNDecode(ggwave_object(id), waveformBuffer, waveformSize, payloadBuffer, payloadSize);
+}
+
 extern "C"
 void ggwave_rxToggleProtocol(
         ggwave_ProtocolId protocolId,
@@ -222,8 +545,12 @@ void ggwave_txProtocolSetFreqStart(
 
 extern "C"
 int ggwave_rxDurationFrames(ggwave_Instance id) {
-    GGWave * ggWave = (GGWave *) g_instances[id];
-    return ggWave->rxDurationFrames();
+    return ggwave_objectRxDurationFrames(ggwave_object(id));
+}
+
+extern "C"
+int ggwave_rxFramesSkipped(ggwave_Instance id) {
+    return ggwave_objectRxFramesSkipped(ggwave_object(id));
 }
 
 //
@@ -250,15 +577,121 @@ uint8_t getDSSMagic(int i) {
 #endif
 }
 
-void FFT(float * f, int N, int * wi, float * wf) {
-    rdft(N, 1, f, wi, wf);
+// the transforms only read the FFT tables - the bit reversal works in a small buffer on the stack
+constexpr int kFFTBitReversalSize = 32;
+
+static_assert(kFFTBitReversalSize*kFFTBitReversalSize >= GGWave::kMaxSamplesPerFrame, "kFFTBitReversalSize is too small");
+
+// FFT backends
+//
+//   The transforms are in-place and produce the layout of rdft() and cdft() in fft.h, which the decoding expects.
+//   The tables (wi, wf) are initialized for transforms of up to N real values, or N/2 complex values, and are only
+//   read by the transforms. The work buffer is scratch space of the caller - it cannot be shared between threads.
+//
+struct FFTBackend {
+    const char * name;
+
+    // size of the tables for transforms of up to N real values
+    int (*sizeI)(int N);
+    int (*sizeF)(int N);
+
+    // size of the work buffer for transforms of up to N real values
+    int (*sizeW)(int N);
+
+    void (*init)(int N, int * wi, float * wf);
+
+    // FFT of N real values: f[2k] = R[k], f[2k + 1] = I[k] for 0 < k < N/2, f[0] = R[0], f[1] = R[N/2]
+    void (*real)(float * f, int N, const int * wi, const float * wf, float * work);
+
+    // FFT of N interleaved complex values: X[k] = sum_j x[j]*exp(-2*pi*i*j*k/N)
+    void (*complex)(float * f, int N, const int * wi, const float * wf, float * work);
+};
+
+// the reference: scalar, with the smallest tables
+const FFTBackend kFFTOoura = {
+    "ooura",
+    [](int N) { return int(3 + sqrt(N/2)); },
+    [](int N) { return N/2; },
+    [](int) { return 0; },
+    [](int N, int * wi, float * wf) {
+        makewt(N >> 2, wi, wf);
+        makect(N >> 2, wi, wf + (N >> 2));
+    },
+    [](float * f, int N, const int * wi, const float * wf, float *) {
+        int ipw[kFFTBitReversalSize];
+        rdft(N, 1, f, wi, wf, ipw);
+    },
+    [](float * f, int N, const int * wi, const float * wf, float *) {
+        int ipw[kFFTBitReversalSize];
+        cdft(2*N, -1, f, wi, wf, ipw);
+    },
+};
+
+#ifndef GGWAVE_CONFIG_FFT_OOURA
+// vectorised with the SIMD kernels - see fftReal() in simd.h
+const FFTBackend kFFTRadix4 = {
+    "radix4",
+    fftTableSizeI,
+    fftTableSizeF,
+    [](int N) { return 2*N; },
+    fftInit,
+    [](float * f, int N, const int * wi, const float * wf, float * work) {
+        fftReal(::simdKernels(), f, N, wi, wf, work);
+    },
+    [](float * f, int N, const int * wi, const float * wf, float * work) {
+        fftComplex(::simdKernels(), f, N, wi, wf, work);
+    },
+};
+#endif
+
+// without vector instructions the radix-4 FFT is slower than the Ooura FFT
+const FFTBackend & fftBackend(bool radix4) {
+#ifdef GGWAVE_CONFIG_FFT_OOURA
+    (void) radix4;
+    return kFFTOoura;
+#else
+    return (radix4 && &::simdKernels() != &kSimdKernelsScalar) ? kFFTRadix4 : kFFTOoura;
+#endif
+}
+
+void FFT(const FFTBackend & fft, float * f, int N, const int * wi, const float * wf, float * work) {
+    fft.real(f, N, wi, wf, work);
 }
 
-void FFT(const float * src, float * dst, int N, int * wi, float * wf) {
+void FFT(const FFTBackend & fft, const float * src, float * dst, int N, const int * wi, const float * wf, float * work) {
     memcpy(dst, src, N * sizeof(float));
 
-    FFT(dst, N, wi, wf);
+    fft.real(dst, N, wi, wf, work);
+}
+
+// in-place FFT of N interleaved complex values: X[k] = sum_j x[j]*exp(-2*pi*i*j*k/N)
+void FFTComplex(const FFTBackend & fft, float * f, int N, const int * wi, const float * wf, float * work) {
+    fft.complex(f, N, wi, wf, work);
+}
+
+#ifdef GGWAVE_CONFIG_THREADS
+FFTPlan & getFFTPlan(int N, const FFTBackend & fft) {
+    std::lock_guard<std::mutex> lock(g_fftPlansMutex);
+
+    for (auto & cur : g_fftPlans) {
+        if (cur->N == N && cur->backend == &fft) {
+            return *cur;
+        }
+    }
+
+    FFTPlan * plan = new FFTPlan();
+    plan->N = N;
+    plan->backend = &fft;
+    plan->wi.resize(fft.sizeI(N));
+    plan->wf.resize(fft.sizeF(N));
+
+    fft.init(N, plan->wi.data(), plan->wf.data());
+
+    g_fftPlans.push_back(plan);
+
+    return *plan;
 }
+#endif
 
 inline void addAmplitudeSmooth(
         const GGWave::Amplitude & src,
@@ -342,7 +775,7 @@ template struct ggvector<int16_t>;
 template <typename T>
 void ggmatrix<T>::zero() {
     if (m_size0 > 0 && m_size1 > 0) {
-        memset(m_data, 0, m_size0*m_size1*sizeof(T));
+        memset(m_data, 0, m_size0*m_stride*sizeof(T));
     }
 }
 
@@ -393,20 +826,70 @@ GGWave::RxProtocols & GGWave::Protocols::rx() {
     return protocols;
 }
 
-// this probably does not matter, but adding it anyway
-#ifdef ARDUINO
-const int kAlignment = 4;
-#else
-const int kAlignment = 8;
-#endif
+// each buffer in the heap starts at a multiple of kAlignment bytes, and so do the rows of the matrices with rows
+// of at least kAlignment bytes. Smaller rows are packed
+const int kAlignment = GGWave::kHeapAlignment;
 
-//template <typename T>
-//void ggalloc(std::vector<T> & v, int n, void * buf, int & bufSize) {
-//    if (buf == nullptr) {
-//        bufSize += n*sizeof(T);
-//        bufSize = ((bufSize + kAlignment - 1)/kAlignment)*kAlignment;
-//        return;
-//    }
+static_assert(kAlignment >= 4 && (kAlignment & (kAlignment - 1)) == 0, "GGWAVE_CONFIG_HEAP_ALIGNMENT must be a power of 2");
+
+int alignedSize(int n) {
+    return ((n + kAlignment - 1)/kAlignment)*kAlignment;
+}
+
+// sub-frame offsets per frame when searching for the start of the captured data
+const int kAnalysisStepsPerFrame = 16;
+
+// minimum number of analysis offsets that must agree on the length header in early stop mode
+const int kMinLengthVotes = kAnalysisStepsPerFrame;
+
+// energy gate - the gate opens when the energy of a band exceeds kEnergyGateThreshold times its noise floor and
+// closes kEnergyGateHangover frames after that is no longer the case. The noise floor is a running average of the
+// energy, which is updated much more slowly while the gate is open. The energy is measured over the last
+// 1/kEnergyGateFraction of each frame
+const float kEnergyGateThreshold = 1.5f;
+const int   kEnergyGateHangover  = 8;
+const float kEnergyGateRate      = 1.0f/16;
+const float kEnergyGateRateOpen  = 1.0f/1024;
+const float kEnergyGateMinFloor  = 1e-9f;
+const int   kEnergyGateFraction  = 2;
+
+// decimating front end - the band of the Rx protocols must fit in half of the decimated bandwidth. The low-pass
+// filter is a B-spline of order kBasebandOrder spanning kBasebandOrder decimated samples - like a CIC filter, its
+// response is a power of a sinc with zeros at the multiples of the decimated sample rate, where the frequencies
+// that alias into the band are. This keeps the aliases below -30 dB with far fewer taps than a windowed sinc
+const int kMaxDecimation = 16;
+const int kBasebandOrder = 4;
+
+// cardinal B-spline of the given order, nonzero for 0 < x < order
+double bspline(int order, double x) {
+    double res = 0.0;
+    double binom = 1.0;
+    for (int j = 0; j <= order && j < x; ++j) {
+        res += (j % 2 ? -binom : binom)*pow(x - j, order - 1);
+        binom = binom*(order - j)/(j + 1);
+    }
+    for (int j = 2; j < order; ++j) {
+        res /= j;
+    }
+
+    return x < order ? res : 0.0;
+}
+
+// incremental markers - the frames are decimated by up to kMarkerDecimation, as long as the bands of the marker bins
+// fit in half of the decimated bandwidth
+const int kMarkerDecimation = 8;
+
+// native rate - the decimated samples are rounded to 1/kNativePhases of a captured sample. The phase error of the
+// tones is at most pi/kNativePhases, which keeps the distortion below -30 dB
+const int   kNativePhases       = 64;
+
+//template <typename T>
+//void ggalloc(std::vector<T> & v, int n, void * buf, int & bufSize) {
+//    if (buf == nullptr) {
+//        bufSize += n*sizeof(T);
+//        bufSize = ((bufSize + kAlignment - 1)/kAlignment)*kAlignment;
+//        return;
+//    }
 //
 //    v.resize(n);
 //    bufSize += n*sizeof(T);
@@ -431,30 +914,139 @@ const int kAlignment = 8;
 
 template <typename T>
 void ggalloc(ggvector<T> & v, int n, void * buf, int & bufSize) {
-    if (buf == nullptr) {
-        bufSize += n*sizeof(T);
-        bufSize = ((bufSize + kAlignment - 1)/kAlignment)*kAlignment;
-        return;
+    bufSize = alignedSize(bufSize);
+
+    if (buf != nullptr) {
+        v.assign(ggvector<T>((T *)((char *) buf + bufSize), n));
     }
 
-    v.assign(ggvector<T>((T *)((char *) buf + bufSize), n));
     bufSize += n*sizeof(T);
-    bufSize = ((bufSize + kAlignment - 1)/kAlignment)*kAlignment;
 }
 
 template <typename T>
 void ggalloc(ggmatrix<T> & v, int n, int m, void * buf, int & bufSize) {
-    if (buf == nullptr) {
-        bufSize += n*m*sizeof(T);
-        bufSize = ((bufSize + kAlignment - 1) / kAlignment)*kAlignment;
-        return;
+    const int rowSize = m*sizeof(T) < kAlignment ? m*sizeof(T) : alignedSize(m*sizeof(T));
+
+    bufSize = alignedSize(bufSize);
+
+    if (buf != nullptr) {
+        v = ggmatrix<T>((T *)((char *) buf + bufSize), n, m, rowSize/sizeof(T));
     }
 
-    v = ggmatrix<T>((T *)((char *) buf + bufSize), n, m);
-    bufSize += n*m*sizeof(T);
-    bufSize = ((bufSize + kAlignment - 1)/kAlignment)*kAlignment;
+    bufSize += n*rowSize;
 }
 
+//
+// Workers
+//
+
+#ifdef GGWAVE_CONFIG_THREADS
+
+// Persistent threads that help the calling thread analyze the captured data.
+//
+//   The (protocol, offset) candidates are ranked in the order in which the single-threaded search visits
+//   them. The threads grab candidates in increasing rank and skip everything ranked after the best valid
+//   candidate found so far, so the winner is always the candidate that the single-threaded search would
+//   have found first.
+//
+struct GGWave::Workers {
+    Workers(GGWave & owner, int nThreads) : owner(owner), resultRank(nThreads), resultLength(nThreads) {
+        for (int i = 1; i < nThreads; ++i) {
+            threads.emplace_back([this, i]() { loop(i); });
+        }
+    }
+
+    ~Workers() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        cvStart.notify_all();
+
+        for (auto & thread : threads) {
+            thread.join();
+        }
+    }
+
+    void loop(int workerId) {
+        int generationLast = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cvStart.wait(lock, [&]() { return stop || generation != generationLast; });
+                if (stop) {
+                    return;
+                }
+                generationLast = generation;
+            }
+
+            owner.analyzeCandidates(workerId);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--nRunning == 0) {
+                    cvDone.notify_one();
+                }
+            }
+        }
+    }
+
+    // analyze all candidates using the calling thread and the worker threads
+    void run() {
+        nextRank = 0;
+        bestRank = nProtocols*nOffsets;
+        for (int i = 0; i < (int) resultRank.size(); ++i) {
+            resultRank[i] = -1;
+            resultLength[i] = 0;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            nRunning = (int) threads.size();
+            ++generation;
+        }
+        cvStart.notify_all();
+
+        owner.analyzeCandidates(0);
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cvDone.wait(lock, [&]() { return nRunning == 0; });
+        }
+    }
+
+    GGWave & owner;
+
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable cvStart;
+    std::condition_variable cvDone;
+
+    bool stop = false;
+    int generation = 0;
+    int nRunning = 0;
+
+    // candidate with rank r is protocol protocolIds[r%nProtocols] at offset analysisOffsets[r/nProtocols]
+    int nProtocols = 0;
+    int nOffsets = 0;
+    int protocolIds[GGWAVE_PROTOCOL_COUNT];
+
+    std::atomic<int> nextRank { 0 };
+    std::atomic<int> bestRank { 0 };
+
+    // valid candidate found by each worker
+    std::vector<int> resultRank;
+    std::vector<int> resultLength;
+};
+
+#else
+
+struct GGWave::Workers {
+};
+
+#endif
+
 //
 // GGWave
 //
@@ -464,18 +1056,55 @@ GGWave::GGWave(const Parameters & parameters) {
 }
 
 GGWave::~GGWave() {
-    if (m_heap) {
-        free(m_heap);
-    }
+    delete m_workers;
+
+    releaseToneTables();
+
+    releaseHeap();
 }
 
 bool GGWave::prepare(const Parameters & parameters, bool allocate) {
-    if (m_heap) {
-        free(m_heap);
-        m_heap = nullptr;
-        m_heapSize = 0;
+    return prepare(parameters, allocate, nullptr, nullptr, 0);
+}
+
+bool GGWave::prepare(const Parameters & parameters, Allocator & allocator) {
+    return prepare(parameters, true, &allocator, nullptr, 0);
+}
+
+bool GGWave::prepare(const Parameters & parameters, void * heap, int heapSize) {
+    if (heap == nullptr) {
+        ggprintf("Invalid heap\n");
+        return false;
+    }
+
+    return prepare(parameters, true, nullptr, heap, heapSize);
+}
+
+void GGWave::releaseHeap() {
+    if (m_heapBlock && m_heapOwned) {
+        if (m_allocator) {
+            m_allocator->deallocate(m_heapBlock, m_heapCapacity);
+        } else {
+            free(m_heapBlock);
+        }
     }
 
+    m_heap         = nullptr;
+    m_heapBlock    = nullptr;
+    m_heapSize     = 0;
+    m_heapOwned    = false;
+    m_heapCapacity = 0;
+}
+
+bool GGWave::prepare(const Parameters & parameters, bool allocate, Allocator * allocator, void * heap, int heapSize) {
+    delete m_workers;
+    m_workers = nullptr;
+
+    releaseToneTables();
+
+    // the heap is kept until the new size is known, so that it can be reused
+    m_heapSize = 0;
+
     // parameter initialization:
 
     m_sampleRateInp        = parameters.sampleRateInp;
@@ -501,7 +1130,21 @@ bool GGWave::prepare(const Parameters & parameters, bool allocate) {
     m_isTxEnabled          = parameters.operatingMode & GGWAVE_OPERATING_MODE_TX;
     m_needResampling       = m_sampleRateInp != m_sampleRate || m_sampleRateOut != m_sampleRate;
     m_txOnlyTones          = parameters.operatingMode & GGWAVE_OPERATING_MODE_TX_ONLY_TONES;
+    m_txStream             = parameters.operatingMode & GGWAVE_OPERATING_MODE_TX_STREAM;
     m_isDSSEnabled         = parameters.operatingMode & GGWAVE_OPERATING_MODE_USE_DSS;
+    m_resamplerPolyphase   = parameters.operatingMode & GGWAVE_OPERATING_MODE_RESAMPLER_POLYPHASE;
+    m_rxEarlyStop          = parameters.operatingMode & GGWAVE_OPERATING_MODE_RX_EARLY_STOP;
+    m_rxEnergyGate         = parameters.operatingMode & GGWAVE_OPERATING_MODE_RX_ENERGY_GATE;
+    m_rxDecimate           = parameters.operatingMode & GGWAVE_OPERATING_MODE_RX_DECIMATE;
+    m_rxNativeRate         = parameters.operatingMode & GGWAVE_OPERATING_MODE_RX_NATIVE_RATE;
+    m_rxRecordI16          = parameters.operatingMode & GGWAVE_OPERATING_MODE_RX_RECORD_I16;
+    m_fftRadix4            = parameters.operatingMode & GGWAVE_OPERATING_MODE_FFT_RADIX4;
+    m_rxIncrementalMarkers = parameters.operatingMode & GGWAVE_OPERATING_MODE_RX_INCREMENTAL_MARKERS;
+#ifdef GGWAVE_CONFIG_THREADS
+    m_analysisThreads      = GG_MAX(1, parameters.analysisThreads);
+#else
+    m_analysisThreads      = 1;
+#endif
 
     if (m_sampleSizeInp == 0) {
         ggprintf("Invalid or unsupported capture sample format: %d\n", (int) parameters.sampleFormatInp);
@@ -528,23 +1171,112 @@ bool GGWave::prepare(const Parameters & parameters, bool allocate) {
         return false;
     }
 
-    // memory allocation:
+    m_decimation        = 1;
+    m_analyzedFrameSize = m_samplesPerFrame;
+    m_basebandPhases    = 1;
+    m_basebandRatio     = 1.0;
 
-    m_heap = nullptr;
-    m_heapSize = 0;
+    m_rxNativeRate = m_rxNativeRate && m_isRxEnabled && m_sampleRateInp != m_sampleRate;
+    if (m_rxNativeRate) {
+        m_basebandPhases = kNativePhases;
+        m_basebandRatio  = double(m_sampleRateInp)/m_sampleRate;
+    }
 
-    if (this->alloc(m_heap, m_heapSize) == false) {
+    if (m_isRxEnabled && (m_rxDecimate || m_rxNativeRate)) {
+        if (prepareBaseband() == false && m_rxNativeRate) {
+            ggprintf("Warning: resampling the captured audio - the Rx protocols cannot be received at the native rate\n");
+
+            m_rxNativeRate   = false;
+            m_basebandPhases = 1;
+            m_basebandRatio  = 1.0;
+
+            if (m_rxDecimate) {
+                prepareBaseband();
+            }
+        }
+
+        if (m_rxDecimate && m_decimation == 1) {
+            ggprintf("Warning: GGWAVE_OPERATING_MODE_RX_DECIMATE has no effect - enable a narrower set of Rx protocols\n");
+        }
+    }
+
+    m_rxIncrementalMarkers = m_rxIncrementalMarkers && m_isRxEnabled && m_isFixedPayloadLength == false;
+    if (m_rxIncrementalMarkers && m_decimation > 1) {
+        ggprintf("Warning: GGWAVE_OPERATING_MODE_RX_INCREMENTAL_MARKERS has no effect with the decimating front end\n");
+        m_rxIncrementalMarkers = false;
+    }
+
+    m_markerDecimation = 1;
+    if (m_rxIncrementalMarkers) {
+        const int nBins = 2*m_nBitsInMarker*m_freqDelta_bin;
+        while (2*m_markerDecimation <= kMarkerDecimation && m_samplesPerFrame % (2*m_markerDecimation) == 0 &&
+               2*nBins <= m_samplesPerFrame/(2*m_markerDecimation)) {
+            m_markerDecimation *= 2;
+        }
+    }
+
+    // the triangular filter spans two decimated samples and is padded with zeros to a multiple of 8 for the FIR kernel
+    m_markerTaps = (2*m_markerDecimation + 7) & ~7;
+
+    // memory allocation:
+
+    int heapSize0 = 0;
+    if (this->alloc(nullptr, heapSize0) == false) {
         ggprintf("Error: failed to compute the size of the required memory\n");
+        releaseHeap();
         return false;
     }
 
     if (allocate == false) {
+        releaseHeap();
+        m_heapSize = heapSize0;
         return true;
     }
 
-    const auto heapSize0 = m_heapSize;
+    if (heap) {
+        if (heapSize < heapSize0) {
+            ggprintf("Error: the provided heap is too small - size: %d, required: %d\n", heapSize, heapSize0);
+            releaseHeap();
+            return false;
+        }
+
+        if ((uintptr_t) heap % kAlignment != 0) {
+            ggprintf("Error: the provided heap must be aligned to %d bytes\n", kAlignment);
+            releaseHeap();
+            return false;
+        }
+
+        releaseHeap();
+        m_heap         = heap;
+        m_heapBlock    = heap;
+        m_heapCapacity = heapSize;
+    } else if (m_heap == nullptr || m_heapOwned == false || m_allocator != allocator ||
+               ((char *) m_heap - (char *) m_heapBlock) + heapSize0 > m_heapCapacity) {
+        releaseHeap();
+
+        // malloc() does not guarantee the alignment, so the heap is aligned within a slightly larger block
+        const int blockSize = allocator ? heapSize0 : heapSize0 + kAlignment - 1;
+
+        m_allocator = allocator;
+        m_heapBlock = allocator ? allocator->allocate(blockSize, kAlignment) : malloc(blockSize);
+        if (m_heapBlock == nullptr) {
+            ggprintf("Error: failed to allocate the required memory: %d\n", blockSize);
+            return false;
+        }
+
+        m_heap         = (void *) (((uintptr_t) m_heapBlock + kAlignment - 1) & ~((uintptr_t) kAlignment - 1));
+        m_heapOwned    = true;
+        m_heapCapacity = blockSize;
 
-    m_heap = calloc(m_heapSize, 1);
+        if (m_heap != m_heapBlock && allocator) {
+            ggprintf("Error: the allocator returned memory that is not aligned to %d bytes\n", kAlignment);
+            releaseHeap();
+            return false;
+        }
+    }
+
+    // the heap is reused when the instance is prepared again, but the buffers must start from zero
+    memset(m_heap, 0, heapSize0);
 
     m_heapSize = 0;
     if (this->alloc(m_heap, m_heapSize) == false) {
@@ -558,19 +1290,53 @@ bool GGWave::prepare(const Parameters & parameters, bool allocate) {
     }
 
     if (m_isRxEnabled) {
-        m_rx.samplesNeeded = m_samplesPerFrame;
+        m_rx.frameSize     = m_samplesPerFrame;
+        m_rx.basebandLast  = 0.0;
+        if (m_rxNativeRate) {
+            m_rx.frameSize    = 0;
+            m_rx.basebandLast = -m_decimation*m_basebandRatio;
+            nextNativeFrame();
+        }
+        m_rx.samplesNeeded = m_rx.frameSize;
+
+#ifdef GGWAVE_CONFIG_THREADS
+        {
+            auto & plan = getFFTPlan(m_samplesPerFrame, ::fftBackend(m_fftRadix4));
 
-        m_rx.fftWorkI[0] = 0;
+            m_rx.fftWorkI.assign(ggvector<int>  (plan.wi.data(), plan.wi.size()));
+            m_rx.fftWorkF.assign(ggvector<float>(plan.wf.data(), plan.wf.size()));
+        }
+#else
+        ::fftBackend(m_fftRadix4).init(m_samplesPerFrame, m_rx.fftWorkI.data(), m_rx.fftWorkF.data());
+#endif
 
         m_rx.protocol   = {};
         m_rx.protocolId = GGWAVE_PROTOCOL_COUNT;
         m_rx.protocols  = Protocols::rx();
 
         m_rx.minFreqStart = minFreqStart(m_rx.protocols);
+
+        for (auto & bins : m_rx.protocolBins) {
+            bins = {};
+        }
+        updateProtocolBins();
+
+        if (m_decimation > 1) {
+            makeBasebandFilter();
+        }
+
+#ifdef GGWAVE_CONFIG_THREADS
+        if (m_isFixedPayloadLength == false && m_analysisThreads > 1) {
+            m_workers = new Workers(*this, m_analysisThreads);
+        }
+#endif
     }
 
     if (m_isTxEnabled) {
         m_tx.protocols = Protocols::tx();
+
+        m_tx.tablesFreqStart     = -1;
+        m_tx.tablesDataBitsPerTx = -1;
     }
 
     return init("", {}, 0);
@@ -581,6 +1347,9 @@ bool GGWave::alloc(void * p, int & n) {
     const int totalLength = maxLength + getECCBytesForLength(maxLength);
     const int totalTxs    = (totalLength + minBytesPerTx(Protocols::rx()) - 1)/minBytesPerTx(Protocols::tx());
 
+    // captured samples per frame - at the native rate, the frames alternate between two sizes
+    const int maxFrameSize = m_rxNativeRate ? int(ceil(m_samplesPerFrame*m_basebandRatio)) + 2 : m_samplesPerFrame;
+
     if (totalLength > kMaxDataSize) {
         ggprintf("Error: total length %d (payload %d + ECC %d bytes) is too large ( > %d)\n",
                  totalLength, maxLength, getECCBytesForLength(maxLength), kMaxDataSize);
@@ -591,33 +1360,97 @@ bool GGWave::alloc(void * p, int & n) {
     ::ggalloc(m_dataEncoded, totalLength + m_encodedDataOffset, p, n);
 
     if (m_isRxEnabled) {
-        ::ggalloc(m_rx.fftOut,   2*m_samplesPerFrame, p, n);
-        ::ggalloc(m_rx.fftWorkI, 3 + sqrt(m_samplesPerFrame/2), p, n);
-        ::ggalloc(m_rx.fftWorkF, m_samplesPerFrame/2, p, n);
+        // the FFTs are in place - the real FFT packs its samplesPerFrame/2 complex bins in samplesPerFrame floats
+        ::ggalloc(m_rx.fftOut,   m_analyzedFrameSize, p, n);
+        const auto & fft = ::fftBackend(m_fftRadix4);
+#ifndef GGWAVE_CONFIG_THREADS
+        // without thread support the FFT tables cannot be shared between instances
+        ::ggalloc(m_rx.fftWorkI, fft.sizeI(m_samplesPerFrame), p, n);
+        ::ggalloc(m_rx.fftWorkF, fft.sizeF(m_samplesPerFrame), p, n);
+#endif
+        ::ggalloc(m_rx.fftWork,  fft.sizeW(m_samplesPerFrame), p, n);
 
-        ::ggalloc(m_rx.spectrum,           m_samplesPerFrame, p, n);
+        ::ggalloc(m_rx.spectrum,           m_samplesPerFrame/2 + 1, p, n);
+        ::ggalloc(m_rx.spectrumFull,       m_samplesPerFrame, p, n);
         // small extra space because sometimes resampling needs a few more samples:
-        ::ggalloc(m_rx.amplitude,          m_needResampling ? m_samplesPerFrame + 128 : m_samplesPerFrame, p, n);
+        ::ggalloc(m_rx.amplitude,          m_needResampling ? maxFrameSize + 128 : m_samplesPerFrame, p, n);
         // min input sampling rate is 0.125*m_sampleRate:
         ::ggalloc(m_rx.amplitudeResampled, m_needResampling ? 8*m_samplesPerFrame : m_samplesPerFrame, p, n);
-        ::ggalloc(m_rx.amplitudeTmp,       m_needResampling ? 8*m_samplesPerFrame*m_sampleSizeInp : m_samplesPerFrame*m_sampleSizeInp, p, n);
 
         ::ggalloc(m_rx.data, maxLength + 1, p, n); // extra byte for null-termination
 
+        if (m_decimation > 1) {
+            ::ggalloc(m_rx.basebandFilter, 2*m_basebandTaps*m_basebandPhases, p, n);
+            ::ggalloc(m_rx.basebandInput,  m_basebandTaps + maxFrameSize, p, n);
+            ::ggalloc(m_rx.basebandGain,   m_basebandBinEnd - m_basebandBinStart, p, n);
+        }
+
         if (m_isFixedPayloadLength) {
             if (m_payloadLength > kMaxLengthFixed) {
                 ggprintf("Invalid payload length: %d, max: %d\n", m_payloadLength, kMaxLengthFixed);
                 return false;
             }
 
-            ::ggalloc(m_rx.spectrumHistoryFixed, totalTxs*maxFramesPerTx(Protocols::rx(), false), m_samplesPerFrame, p, n);
+            const int nHistory = totalTxs*maxFramesPerTx(Protocols::rx(), false);
+            const int nSlots   = 2*maxBytesPerTx(Protocols::rx());
+
+            // the bins up to the Nyquist frequency - or up to the end of the band of the decimating front end
+            ::ggalloc(m_rx.spectrumHistoryFixed, nHistory, m_decimation > 1 ? m_basebandBinEnd : m_samplesPerFrame/2, p, n);
             ::ggalloc(m_rx.detectedBins,         2*totalLength, p, n);
-            ::ggalloc(m_rx.detectedTones,        2*16*maxBytesPerTx(Protocols::rx()), p, n);
+            ::ggalloc(m_rx.fixedBins,            nHistory*GGWAVE_PROTOCOL_COUNT, nSlots, p, n);
+            ::ggalloc(m_rx.fixedTones,           nHistory*GGWAVE_PROTOCOL_COUNT, nSlots, p, n);
+            ::ggalloc(m_rx.fixedDetected,        nHistory, GGWAVE_PROTOCOL_COUNT, p, n);
+            ::ggalloc(m_rx.fixedCounts,          GGWAVE_PROTOCOL_COUNT*nSlots, 16, p, n);
+            ::ggalloc(m_rx.fixedPhaseSum,        GGWAVE_PROTOCOL_COUNT, maxFramesPerTx(Protocols::rx(), false), p, n);
+
+            if (m_rxEnergyGate) {
+                ::ggalloc(m_rx.gatePrevious,     maxFrameSize, p, n);
+            }
         } else {
             // variable payload length
-            ::ggalloc(m_rx.amplitudeRecorded, kMaxRecordedFrames*m_samplesPerFrame, p, n);
-            ::ggalloc(m_rx.amplitudeAverage,  m_samplesPerFrame, p, n);
-            ::ggalloc(m_rx.amplitudeHistory,  kMaxSpectrumHistory, m_samplesPerFrame, p, n);
+            m_rx.framesRecordedMax = GG_MIN(kMaxRecordedFrames, maxDurationFrames(Protocols::rx(), maxLength, true));
+            if (m_rxRecordI16) {
+                ::ggalloc(m_rx.amplitudeRecordedI16, m_rx.framesRecordedMax*m_analyzedFrameSize, p, n);
+            } else {
+                ::ggalloc(m_rx.amplitudeRecorded,    m_rx.framesRecordedMax*m_analyzedFrameSize, p, n);
+            }
+            if (m_decimation > 1) {
+                ::ggalloc(m_rx.baseband,      m_analyzedFrameSize, p, n);
+            }
+            ::ggalloc(m_rx.amplitudeAverage,  m_analyzedFrameSize, p, n);
+            ::ggalloc(m_rx.amplitudeHistory,  kMaxSpectrumHistory, m_analyzedFrameSize, p, n);
+
+            if (m_rxIncrementalMarkers) {
+                const int nBins = 2*m_nBitsInMarker*m_freqDelta_bin;
+                const int nOut  = m_samplesPerFrame/m_markerDecimation;
+
+                ::ggalloc(m_rx.markerTables, GGWAVE_PROTOCOL_COUNT, 3*nBins, p, n);
+                ::ggalloc(m_rx.markerDFT,    kMaxSpectrumHistory, GGWAVE_PROTOCOL_COUNT*2*nBins, p, n);
+                ::ggalloc(m_rx.markerInput,  m_markerTaps + m_samplesPerFrame, p, n);
+                ::ggalloc(m_rx.markerWork,   4*nOut + 4*nBins, p, n);
+            }
+
+            {
+                const int nOffsets = m_nMarkerFrames*kAnalysisStepsPerFrame;
+
+                ::ggalloc(m_rx.syncTwiddles,    2*2*m_nBitsInMarker*(m_analyzedFrameSize/kAnalysisStepsPerFrame), p, n);
+                ::ggalloc(m_rx.syncSteps,       2*2*m_nBitsInMarker*(nOffsets + kAnalysisStepsPerFrame), p, n);
+                ::ggalloc(m_rx.syncWindow,      2*2*m_nBitsInMarker, p, n);
+                ::ggalloc(m_rx.syncScore,       nOffsets + 1, p, n);
+                ::ggalloc(m_rx.analysisOffsets, nOffsets, p, n);
+            }
+
+            if (m_analysisThreads > 1) {
+                const int nWorkers = m_analysisThreads - 1;
+
+                ::ggalloc(m_rx.analysisFftOut,       nWorkers, m_analyzedFrameSize, p, n);
+                ::ggalloc(m_rx.analysisFftWork,      nWorkers, fft.sizeW(m_samplesPerFrame), p, n);
+                ::ggalloc(m_rx.analysisSpectrum,     nWorkers, m_samplesPerFrame/2 + 1, p, n);
+                ::ggalloc(m_rx.analysisDataEncoded,  nWorkers, totalLength + m_encodedDataOffset, p, n);
+                ::ggalloc(m_rx.analysisData,         nWorkers, maxLength + 1, p, n);
+                ::ggalloc(m_rx.analysisWorkRSLength, nWorkers, RS::ReedSolomon::getWorkSize_bytes(1, m_encodedDataOffset - 1), p, n);
+                ::ggalloc(m_rx.analysisWorkRSData,   nWorkers, RS::ReedSolomon::getWorkSize_bytes(maxLength, getECCBytesForLength(maxLength)), p, n);
+            }
         }
     }
 
@@ -625,13 +1458,24 @@ bool GGWave::alloc(void * p, int & n) {
         const int maxDataBits = 2*16*maxBytesPerTx(Protocols::tx());
 
         if (m_txOnlyTones == false) {
-            ::ggalloc(m_tx.phaseOffsets,    maxDataBits, p, n);
-            ::ggalloc(m_tx.bit0Amplitude,   maxDataBits, m_samplesPerFrame, p, n);
-            ::ggalloc(m_tx.bit1Amplitude,   maxDataBits, m_samplesPerFrame, p, n);
+#ifndef GGWAVE_CONFIG_THREADS
+            // without thread support the tone tables cannot be shared between instances
+            const int maxToneRows = GG_MAX(m_nBitsInMarker, 16*maxBytesPerTx(Protocols::tx()));
+
+            ::ggalloc(m_tx.bit0Amplitude,   maxToneRows, m_samplesPerFrame, p, n);
+            ::ggalloc(m_tx.bit1Amplitude,   maxToneRows, m_samplesPerFrame, p, n);
+#endif
             ::ggalloc(m_tx.output,          m_samplesPerFrame, p, n);
             ::ggalloc(m_tx.outputResampled, 2*m_samplesPerFrame, p, n);
-            ::ggalloc(m_tx.outputTmp,       kMaxRecordedFrames*m_samplesPerFrame*m_sampleSizeOut, p, n);
-            ::ggalloc(m_tx.outputI16,       kMaxRecordedFrames*m_samplesPerFrame, p, n);
+            if (m_txStream == false) {
+                // +1 sample per frame, because the resampled frames vary in length. The mono-tone protocols can
+                // transmit only with fixed payload length
+                const int maxSamplesPerFrameOut = m_needResampling ? ceil(m_samplesPerFrame*m_sampleRateOut/m_sampleRate) + 1 : m_samplesPerFrame;
+                const int maxSamplesOut         = maxDurationFrames(Protocols::tx(), maxLength, m_isFixedPayloadLength == false)*maxSamplesPerFrameOut;
+
+                ::ggalloc(m_tx.outputTmp,   maxSamplesOut*m_sampleSizeOut, p, n);
+                ::ggalloc(m_tx.outputI16,   maxSamplesOut, p, n);
+            }
         }
 
         const int maxTones    = m_isFixedPayloadLength ? maxTonesPerTx(Protocols::tx()) : m_nBitsInMarker;
@@ -652,7 +1496,7 @@ bool GGWave::alloc(void * p, int & n) {
     }
 
     if (m_needResampling) {
-        m_resampler.alloc(p, n);
+        m_resampler.alloc(p, n, m_resamplerPolyphase ? Resampler::kEnginePolyphase : Resampler::kEngineSinc);
     }
 
     return true;
@@ -673,6 +1517,7 @@ const GGWave::Parameters & GGWave::getDefaultParameters() {
         GGWAVE_SAMPLE_FORMAT_F32,
         GGWAVE_SAMPLE_FORMAT_F32,
         GGWAVE_OPERATING_MODE_RX | GGWAVE_OPERATING_MODE_TX,
+        1, // analyze captured data on the calling thread
     };
 
     return result;
@@ -703,6 +1548,7 @@ bool GGWave::init(int dataSize, const char * dataBuffer, TxProtocolId protocolId
         }
 
         m_tx.hasData = false;
+        m_tx.isEncoding = false;
         m_tx.data.zero();
         m_dataEncoded.zero();
 
@@ -761,6 +1607,19 @@ bool GGWave::init(int dataSize, const char * dataBuffer, TxProtocolId protocolId
         m_rx.data.zero();
 
         m_rx.spectrumHistoryFixed.zero();
+        m_rx.fixedVotesValid = false;
+
+        m_rx.basebandInput.zero();
+
+        m_rx.nMarkerBands = 0;
+        m_rx.markersValid = false;
+        m_rx.markerInput.zero();
+
+        // start with an open gate, while the noise floor is measured
+        m_rx.nEnergyBands = 0;
+        m_rx.isGateOpen = true;
+        m_rx.gateHangover = kEnergyGateHangover;
+        m_rx.framesSkipped = 0;
     }
 
     return true;
@@ -792,10 +1651,10 @@ uint32_t GGWave::encodeSize_samples() const {
            )*samplesPerFrameOut;
 }
 
-uint32_t GGWave::encode() {
+bool GGWave::encodeBegin() {
     if (m_isTxEnabled == false) {
         ggprintf("Tx is disabled - cannot transmit data with this GGWave instance\n");
-        return 0;
+        return false;
     }
 
     if (m_needResampling) {
@@ -807,6 +1666,11 @@ uint32_t GGWave::encode() {
     const int totalBytes = sendDataLength + nECCBytesPerTx;
     const int totalDataFrames = m_tx.protocol.extra*((totalBytes + m_tx.protocol.bytesPerTx - 1)/m_tx.protocol.bytesPerTx)*m_tx.protocol.framesPerTx;
 
+    m_tx.totalDataFrames = totalDataFrames;
+    m_tx.frameId         = 0;
+    m_tx.frameSize       = 0;
+    m_tx.framePos        = 0;
+
     if (m_isFixedPayloadLength == false) {
         RS::ReedSolomon rsLength(1, m_encodedDataOffset - 1, m_workRSLength.data());
         rsLength.Encode(m_tx.data.data(), m_dataEncoded.data());
@@ -883,186 +1747,392 @@ uint32_t GGWave::encode() {
     }
 
     // compute Tx data
-    {
-        for (int k = 0; k < (int) m_tx.phaseOffsets.size(); ++k) {
-            m_tx.phaseOffsets[k] = (M_PI*k)/(m_tx.protocol.nDataBitsPerTx());
+    if (m_tx.protocol.freqStart != m_tx.tablesFreqStart || m_tx.protocol.nDataBitsPerTx() != m_tx.tablesDataBitsPerTx) {
+        releaseToneTables();
+
+        m_tx.tablesFreqStart     = m_tx.protocol.freqStart;
+        m_tx.tablesDataBitsPerTx = m_tx.protocol.nDataBitsPerTx();
+
+        // the markers use the first m_nBitsInMarker rows, the data uses 16 rows per byte
+        const int nRows = GG_MAX(m_nBitsInMarker, 16*m_tx.protocol.bytesPerTx);
+
+#ifdef GGWAVE_CONFIG_THREADS
+        std::lock_guard<std::mutex> lock(g_toneTablesMutex);
+
+        ToneTables * tables = nullptr;
+        for (auto & cur : g_toneTables) {
+            if (cur->sampleRate      == m_sampleRate &&
+                cur->samplesPerFrame == m_samplesPerFrame &&
+                cur->freqStart       == m_tx.tablesFreqStart &&
+                cur->nDataBitsPerTx  == m_tx.tablesDataBitsPerTx) {
+                tables = cur;
+                break;
+            }
         }
 
-        // note : what is the purpose of this shuffle ? I forgot .. :(
-        //std::random_device rd;
-        //std::mt19937 g(rd());
+        if (tables == nullptr) {
+            tables = new ToneTables();
+            tables->sampleRate      = m_sampleRate;
+            tables->samplesPerFrame = m_samplesPerFrame;
+            tables->freqStart       = m_tx.tablesFreqStart;
+            tables->nDataBitsPerTx  = m_tx.tablesDataBitsPerTx;
+            tables->bit1.resize(nRows*m_samplesPerFrame);
+            tables->bit0.resize(nRows*m_samplesPerFrame);
 
-        //std::shuffle(phaseOffsets.begin(), phaseOffsets.end(), g);
+            computeToneTables(AmplitudeArr(tables->bit1.data(), nRows, m_samplesPerFrame),
+                              AmplitudeArr(tables->bit0.data(), nRows, m_samplesPerFrame), nRows);
 
-        for (int k = 0; k < (int) m_tx.dataBits.size(); ++k) {
-            const double freq = bitFreq(m_tx.protocol, k);
+            g_toneTables.push_back(tables);
+        }
 
-            const double phaseOffset = m_tx.phaseOffsets[k];
-            const double curHzPerSample = m_hzPerSample;
-            const double curIHzPerSample = 1.0/curHzPerSample;
+        ++tables->nRefs;
 
-            for (int i = 0; i < m_samplesPerFrame; i++) {
-                const double curi = i;
-                m_tx.bit1Amplitude[k][i] = sin((2.0*M_PI)*(curi*m_isamplesPerFrame)*(freq*curIHzPerSample) + phaseOffset);
-            }
+        m_tx.bit1Amplitude = AmplitudeArr(tables->bit1.data(), nRows, m_samplesPerFrame);
+        m_tx.bit0Amplitude = AmplitudeArr(tables->bit0.data(), nRows, m_samplesPerFrame);
+#else
+        computeToneTables(m_tx.bit1Amplitude, m_tx.bit0Amplitude, nRows);
+#endif
+    }
+
+    m_tx.isEncoding = true;
+
+    return true;
+}
+
+void GGWave::releaseToneTables() {
+#ifdef GGWAVE_CONFIG_THREADS
+    if (m_tx.tablesFreqStart < 0) {
+        return;
+    }
 
-            for (int i = 0; i < m_samplesPerFrame; i++) {
-                const double curi = i;
-                m_tx.bit0Amplitude[k][i] = sin((2.0*M_PI)*(curi*m_isamplesPerFrame)*((freq + m_hzPerSample*m_freqDelta_bin)*curIHzPerSample) + phaseOffset);
+    std::lock_guard<std::mutex> lock(g_toneTablesMutex);
+
+    for (int i = 0; i < (int) g_toneTables.size(); ++i) {
+        auto & cur = g_toneTables[i];
+        if (cur->sampleRate      == m_sampleRate &&
+            cur->samplesPerFrame == m_samplesPerFrame &&
+            cur->freqStart       == m_tx.tablesFreqStart &&
+            cur->nDataBitsPerTx  == m_tx.tablesDataBitsPerTx) {
+            if (--cur->nRefs == 0) {
+                delete cur;
+                g_toneTables.erase(g_toneTables.begin() + i);
             }
+            break;
         }
     }
 
-    int frameId = 0;
-    uint32_t offset = 0;
-    const float factor = m_sampleRate/m_sampleRateOut;
+    m_tx.tablesFreqStart     = -1;
+    m_tx.tablesDataBitsPerTx = -1;
 
-    while (m_tx.hasData) {
-        m_tx.output.zero();
+    m_tx.bit1Amplitude = AmplitudeArr();
+    m_tx.bit0Amplitude = AmplitudeArr();
+#endif
+}
 
-        uint16_t nFreq = 0;
-        if (frameId < m_nMarkerFrames) {
-            nFreq = m_nBitsInMarker;
+int GGWave::encodeFrame() {
+    const float factor = m_sampleRate/m_sampleRateOut;
 
-            for (int i = 0; i < m_nBitsInMarker; ++i) {
-                if (i%2 == 0) {
-                    ::addAmplitudeSmooth(m_tx.bit1Amplitude[i], m_tx.output, m_tx.sendVolume, 0, m_samplesPerFrame, frameId, m_nMarkerFrames);
-                } else {
-                    ::addAmplitudeSmooth(m_tx.bit0Amplitude[i], m_tx.output, m_tx.sendVolume, 0, m_samplesPerFrame, frameId, m_nMarkerFrames);
-                }
-            }
-        } else if (frameId < m_nMarkerFrames + totalDataFrames) {
-            int dataOffset = frameId - m_nMarkerFrames;
-            int cycleModMain = dataOffset%m_tx.protocol.framesPerTx;
-            dataOffset /= m_tx.protocol.framesPerTx;
-            dataOffset *= m_tx.protocol.bytesPerTx;
+    m_tx.output.zero();
 
-            m_tx.dataBits.zero();
+    uint16_t nFreq = 0;
+    if (m_tx.frameId < m_nMarkerFrames) {
+        nFreq = m_nBitsInMarker;
 
-            for (int j = 0; j < m_tx.protocol.bytesPerTx; ++j) {
-                if (m_tx.protocol.extra == 1) {
-                    {
-                        uint8_t d = m_dataEncoded[dataOffset + j] & 15;
-                        m_tx.dataBits[(2*j + 0)*16 + d] = 1;
-                    }
-                    {
-                        uint8_t d = m_dataEncoded[dataOffset + j] & 240;
-                        m_tx.dataBits[(2*j + 1)*16 + (d >> 4)] = 1;
-                    }
-                } else {
-                    if (dataOffset % m_tx.protocol.extra == 0) {
-                        uint8_t d = m_dataEncoded[dataOffset/m_tx.protocol.extra + j] & 15;
-                        m_tx.dataBits[(2*j + 0)*16 + d] = 1;
-                    } else {
-                        uint8_t d = m_dataEncoded[dataOffset/m_tx.protocol.extra + j] & 240;
-                        m_tx.dataBits[(2*j + 0)*16 + (d >> 4)] = 1;
-                    }
-                }
+        for (int i = 0; i < m_nBitsInMarker; ++i) {
+            if (i%2 == 0) {
+                ::addAmplitudeSmooth(m_tx.bit1Amplitude[i], m_tx.output, m_tx.sendVolume, 0, m_samplesPerFrame, m_tx.frameId, m_nMarkerFrames);
+            } else {
+                ::addAmplitudeSmooth(m_tx.bit0Amplitude[i], m_tx.output, m_tx.sendVolume, 0, m_samplesPerFrame, m_tx.frameId, m_nMarkerFrames);
             }
+        }
+    } else if (m_tx.frameId < m_nMarkerFrames + m_tx.totalDataFrames) {
+        int dataOffset = m_tx.frameId - m_nMarkerFrames;
+        int cycleModMain = dataOffset%m_tx.protocol.framesPerTx;
+        dataOffset /= m_tx.protocol.framesPerTx;
+        dataOffset *= m_tx.protocol.bytesPerTx;
 
-            for (int k = 0; k < 2*m_tx.protocol.bytesPerTx*16; ++k) {
-                if (m_tx.dataBits[k] == 0) continue;
+        m_tx.dataBits.zero();
 
-                ++nFreq;
-                if (k%2) {
-                    ::addAmplitudeSmooth(m_tx.bit0Amplitude[k/2], m_tx.output, m_tx.sendVolume, 0, m_samplesPerFrame, cycleModMain, m_tx.protocol.framesPerTx);
-                } else {
-                    ::addAmplitudeSmooth(m_tx.bit1Amplitude[k/2], m_tx.output, m_tx.sendVolume, 0, m_samplesPerFrame, cycleModMain, m_tx.protocol.framesPerTx);
+        for (int j = 0; j < m_tx.protocol.bytesPerTx; ++j) {
+            if (m_tx.protocol.extra == 1) {
+                {
+                    uint8_t d = m_dataEncoded[dataOffset + j] & 15;
+                    m_tx.dataBits[(2*j + 0)*16 + d] = 1;
                 }
-            }
-        } else if (frameId < m_nMarkerFrames + totalDataFrames + m_nMarkerFrames) {
-            nFreq = m_nBitsInMarker;
-
-            const int fId = frameId - (m_nMarkerFrames + totalDataFrames);
-            for (int i = 0; i < m_nBitsInMarker; ++i) {
-                if (i%2 == 0) {
-                    addAmplitudeSmooth(m_tx.bit0Amplitude[i], m_tx.output, m_tx.sendVolume, 0, m_samplesPerFrame, fId, m_nMarkerFrames);
+                {
+                    uint8_t d = m_dataEncoded[dataOffset + j] & 240;
+                    m_tx.dataBits[(2*j + 1)*16 + (d >> 4)] = 1;
+                }
+            } else {
+                if (dataOffset % m_tx.protocol.extra == 0) {
+                    uint8_t d = m_dataEncoded[dataOffset/m_tx.protocol.extra + j] & 15;
+                    m_tx.dataBits[(2*j + 0)*16 + d] = 1;
                 } else {
-                    addAmplitudeSmooth(m_tx.bit1Amplitude[i], m_tx.output, m_tx.sendVolume, 0, m_samplesPerFrame, fId, m_nMarkerFrames);
+                    uint8_t d = m_dataEncoded[dataOffset/m_tx.protocol.extra + j] & 240;
+                    m_tx.dataBits[(2*j + 0)*16 + (d >> 4)] = 1;
                 }
             }
-        } else {
-            m_tx.hasData = false;
-            break;
         }
 
-        if (nFreq == 0) nFreq = 1;
-        const float scale = 1.0f/nFreq;
-        for (int i = 0; i < m_samplesPerFrame; ++i) {
-            m_tx.output[i] *= scale;
-        }
+        for (int k = 0; k < 2*m_tx.protocol.bytesPerTx*16; ++k) {
+            if (m_tx.dataBits[k] == 0) continue;
 
-        int samplesPerFrameOut = m_samplesPerFrame;
-        if (m_needResampling) {
-            samplesPerFrameOut = m_resampler.resample(factor, m_samplesPerFrame, m_tx.output.data(), m_tx.outputResampled.data());
-        } else {
-            m_tx.outputResampled.copy(m_tx.output);
+            ++nFreq;
+            if (k%2) {
+                ::addAmplitudeSmooth(m_tx.bit0Amplitude[k/2], m_tx.output, m_tx.sendVolume, 0, m_samplesPerFrame, cycleModMain, m_tx.protocol.framesPerTx);
+            } else {
+                ::addAmplitudeSmooth(m_tx.bit1Amplitude[k/2], m_tx.output, m_tx.sendVolume, 0, m_samplesPerFrame, cycleModMain, m_tx.protocol.framesPerTx);
+            }
         }
+    } else if (m_tx.frameId < m_nMarkerFrames + m_tx.totalDataFrames + m_nMarkerFrames) {
+        nFreq = m_nBitsInMarker;
 
-        // default output is in 16-bit signed int so we always compute it
-        for (int i = 0; i < samplesPerFrameOut; ++i) {
-            m_tx.outputI16[offset + i] = 32768*m_tx.outputResampled[i];
+        const int fId = m_tx.frameId - (m_nMarkerFrames + m_tx.totalDataFrames);
+        for (int i = 0; i < m_nBitsInMarker; ++i) {
+            if (i%2 == 0) {
+                addAmplitudeSmooth(m_tx.bit0Amplitude[i], m_tx.output, m_tx.sendVolume, 0, m_samplesPerFrame, fId, m_nMarkerFrames);
+            } else {
+                addAmplitudeSmooth(m_tx.bit1Amplitude[i], m_tx.output, m_tx.sendVolume, 0, m_samplesPerFrame, fId, m_nMarkerFrames);
+            }
         }
+    } else {
+        m_tx.hasData = false;
+        return 0;
+    }
 
-        // convert from 32-bit float
-        switch (m_sampleFormatOut) {
-            case GGWAVE_SAMPLE_FORMAT_UNDEFINED: break;
-            case GGWAVE_SAMPLE_FORMAT_U8:
-                {
-                    auto p = reinterpret_cast<uint8_t *>(m_tx.outputTmp.data());
-                    for (int i = 0; i < samplesPerFrameOut; ++i) {
-                        p[offset + i] = 128*(m_tx.outputResampled[i] + 1.0f);
-                    }
-                } break;
-            case GGWAVE_SAMPLE_FORMAT_I8:
-                {
-                    auto p = reinterpret_cast<uint8_t *>(m_tx.outputTmp.data());
-                    for (int i = 0; i < samplesPerFrameOut; ++i) {
-                        p[offset + i] = 128*m_tx.outputResampled[i];
-                    }
-                } break;
-            case GGWAVE_SAMPLE_FORMAT_U16:
-                {
-                    auto p = reinterpret_cast<uint16_t *>(m_tx.outputTmp.data());
-                    for (int i = 0; i < samplesPerFrameOut; ++i) {
-                        p[offset + i] = 32768*(m_tx.outputResampled[i] + 1.0f);
-                    }
-                } break;
-            case GGWAVE_SAMPLE_FORMAT_I16:
-                {
-                    // skip because we already have the data in m_tx.outputI16
-                    //auto p = reinterpret_cast<uint16_t *>(m_tx.outputTmp.data());
-                    //for (int i = 0; i < samplesPerFrameOut; ++i) {
-                    //    p[offset + i] = 32768*m_tx.outputResampled[i];
-                    //}
-                } break;
-            case GGWAVE_SAMPLE_FORMAT_F32:
-                {
-                    auto p = reinterpret_cast<float *>(m_tx.outputTmp.data());
-                    for (int i = 0; i < samplesPerFrameOut; ++i) {
-                        p[offset + i] = m_tx.outputResampled[i];
-                    }
-                } break;
-        }
+    if (nFreq == 0) nFreq = 1;
+    const float scale = 1.0f/nFreq;
+    for (int i = 0; i < m_samplesPerFrame; ++i) {
+        m_tx.output[i] *= scale;
+    }
 
-        ++frameId;
-        offset += samplesPerFrameOut;
+    int samplesPerFrameOut = m_samplesPerFrame;
+    if (m_needResampling) {
+        samplesPerFrameOut = m_resampler.resample(factor, m_samplesPerFrame, m_tx.output.data(), m_tx.outputResampled.data());
+    } else {
+        m_tx.outputResampled.copy(m_tx.output);
     }
 
-    m_tx.lastAmplitudeSize = offset;
+    ++m_tx.frameId;
 
-    // the encoded waveform can be accessed via the txWaveform() method
-    // we return the size of the waveform in bytes:
-    return offset*m_sampleSizeOut;
+    return samplesPerFrameOut;
 }
 
-bool GGWave::decode(const void * data, uint32_t nBytes) {
-    if (m_isRxEnabled == false) {
-        ggprintf("Rx is disabled - cannot receive data with this GGWave instance\n");
-        return false;
+uint32_t GGWave::encode() {
+    if (m_txStream) {
+        ggprintf("Tx streaming is enabled - use encodeBegin() / encodeNext() to generate the waveform\n");
+        return 0;
     }
 
-    if (m_tx.hasData) {
+    if (encodeBegin() == false) {
+        return 0;
+    }
+
+    if (m_txOnlyTones) {
+        return true;
+    }
+
+    uint32_t offset = 0;
+
+    while (m_tx.hasData) {
+        const int samplesPerFrameOut = encodeFrame();
+        if (samplesPerFrameOut == 0) {
+            break;
+        }
+
+        const auto & simd = ::simdKernels();
+
+        // default output is in 16-bit signed int so we always compute it
+        simd.fromF32[GGWAVE_SAMPLE_FORMAT_I16](m_tx.outputResampled.data(), m_tx.outputI16.data() + offset, samplesPerFrameOut);
+
+        // skip I16 because we already have the data in m_tx.outputI16
+        if (m_sampleFormatOut != GGWAVE_SAMPLE_FORMAT_I16) {
+            simd.fromF32[m_sampleFormatOut](m_tx.outputResampled.data(), m_tx.outputTmp.data() + offset*m_sampleSizeOut, samplesPerFrameOut);
+        }
+
+        offset += samplesPerFrameOut;
+    }
+
+    m_tx.isEncoding = false;
+    m_tx.lastAmplitudeSize = offset;
+
+    // the encoded waveform can be accessed via the txWaveform() method
+    // we return the size of the waveform in bytes:
+    return offset*m_sampleSizeOut;
+}
+
+int GGWave::encodeNext(void * dst, int maxSamples) {
+    if (m_isTxEnabled == false || m_txOnlyTones) {
+        ggprintf("Tx waveform generation is disabled for this GGWave instance\n");
+        return -1;
+    }
+
+    if (m_tx.isEncoding == false) {
+        ggprintf("No waveform is being generated - call encodeBegin() first\n");
+        return -1;
+    }
+
+    // 0 is reserved for the end of the waveform
+    if (dst == nullptr || maxSamples <= 0) {
+        ggprintf("Invalid output buffer: %p, max samples: %d\n", dst, maxSamples);
+        return -1;
+    }
+
+    auto p = reinterpret_cast<uint8_t *>(dst);
+    const auto convert = ::simdKernels().fromF32[m_sampleFormatOut];
+
+    bool isComplete = false;
+
+    int nWritten = 0;
+    while (nWritten < maxSamples) {
+        if (m_tx.framePos == m_tx.frameSize) {
+            if (m_tx.hasData == false) {
+                isComplete = true;
+                break;
+            }
+
+            m_tx.frameSize = encodeFrame();
+            m_tx.framePos  = 0;
+
+            if (m_tx.frameSize == 0) {
+                isComplete = true;
+                break;
+            }
+        }
+
+        const int n = GG_MIN(maxSamples - nWritten, m_tx.frameSize - m_tx.framePos);
+        convert(m_tx.outputResampled.data() + m_tx.framePos, p + nWritten*m_sampleSizeOut, n);
+
+        m_tx.framePos += n;
+        nWritten      += n;
+    }
+
+    // the end of the waveform is reported once - the next call needs a new encodeBegin()
+    if (isComplete && nWritten == 0) {
+        m_tx.isEncoding = false;
+    }
+
+    return nWritten;
+}
+
+void GGWave::computeToneTables(AmplitudeArr bit1, AmplitudeArr bit0, int nRows) const {
+    // note : what is the purpose of this shuffle ? I forgot .. :(
+    //std::random_device rd;
+    //std::mt19937 g(rd());
+
+    //std::shuffle(phaseOffsets.begin(), phaseOffsets.end(), g);
+
+    const double iHzPerSample = 1.0/m_hzPerSample;
+
+    for (int k = 0; k < nRows; ++k) {
+        const double freq = bitFreq(m_tx.protocol, k);
+        const double phaseOffset = (M_PI*k)/(m_tx.protocol.nDataBitsPerTx());
+
+        ::generateSine(bit1[k].data(), m_samplesPerFrame, (2.0*M_PI)*m_isamplesPerFrame*(freq*iHzPerSample), phaseOffset);
+        ::generateSine(bit0[k].data(), m_samplesPerFrame, (2.0*M_PI)*m_isamplesPerFrame*((freq + m_hzPerSample*m_freqDelta_bin)*iHzPerSample), phaseOffset);
+    }
+}
+
+int GGWave::encodeBatch(const Parameters & parameters, EncodeItem * items, int nItems, int nThreads) {
+    if ((parameters.operatingMode & GGWAVE_OPERATING_MODE_TX) == 0 || (parameters.operatingMode & GGWAVE_OPERATING_MODE_TX_ONLY_TONES)) {
+        ggprintf("Batch encoding requires Tx with waveform output\n");
+        return 0;
+    }
+
+    // the waveforms are streamed directly into the output of the items
+    Parameters parametersTx = parameters;
+    parametersTx.operatingMode &= ~GGWAVE_OPERATING_MODE_RX;
+    parametersTx.operatingMode |= GGWAVE_OPERATING_MODE_TX_STREAM;
+
+    auto encodeItem = [&](GGWave & instance, int i) {
+        auto & item = items[i];
+        item.nBytes = 0;
+
+        if (instance.init(item.payloadSize, (const char *) item.payload, item.protocolId, item.volume) == false) {
+            return false;
+        }
+
+        if (item.output == nullptr) {
+            item.nBytes = instance.encodeSize_bytes();
+            return true;
+        }
+
+        // encodeSize_bytes() never underestimates the waveform, so the output cannot be overrun
+        if (item.outputSize < instance.encodeSize_bytes()) {
+            ggprintf("Batch item %d: output buffer of %d bytes is too small, need %d\n", i, (int) item.outputSize, (int) instance.encodeSize_bytes());
+            return false;
+        }
+
+        if (instance.encodeBegin() == false) {
+            return false;
+        }
+
+        const int maxSamples = item.outputSize/instance.sampleSizeOut();
+        const int nSamples = instance.encodeNext(item.output, maxSamples);
+        if (nSamples <= 0) {
+            return false;
+        }
+
+        item.nBytes = nSamples*instance.sampleSizeOut();
+
+        return true;
+    };
+
+#ifdef GGWAVE_CONFIG_THREADS
+    std::atomic<int> nextItem { 0 };
+    std::atomic<int> nSuccess { 0 };
+
+    auto worker = [&]() {
+        GGWave instance;
+        if (instance.prepare(parametersTx) == false) {
+            return;
+        }
+
+        for (int i = nextItem++; i < nItems; i = nextItem++) {
+            if (encodeItem(instance, i)) {
+                ++nSuccess;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < GG_MIN(nThreads, nItems); ++i) {
+        threads.emplace_back(worker);
+    }
+
+    worker();
+
+    for (auto & thread : threads) {
+        thread.join();
+    }
+
+    return nSuccess;
+#else
+    (void) nThreads;
+
+    GGWave instance;
+    if (instance.prepare(parametersTx) == false) {
+        return 0;
+    }
+
+    int nSuccess = 0;
+    for (int i = 0; i < nItems; ++i) {
+        if (encodeItem(instance, i)) {
+            ++nSuccess;
+        }
+    }
+
+    return nSuccess;
+#endif
+}
+
+bool GGWave::decode(const void * data, uint32_t nBytes) {
+    if (m_isRxEnabled == false) {
+        ggprintf("Rx is disabled - cannot receive data with this GGWave instance\n");
+        return false;
+    }
+
+    if (m_tx.hasData) {
         ggprintf("Cannot decode while transmitting\n");
         return false;
     }
@@ -1070,11 +2140,14 @@ bool GGWave::decode(const void * data, uint32_t nBytes) {
     auto dataBuffer = (uint8_t *) data;
     const float factor = m_sampleRateInp/m_sampleRate;
 
+    // at the native rate, the front end takes the captured samples as they are
+    const bool isResampling = m_needResampling && m_rxNativeRate == false;
+
     while (true) {
         // read capture data
         uint32_t nBytesNeeded = m_rx.samplesNeeded*m_sampleSizeInp;
 
-        if (m_needResampling) {
+        if (isResampling) {
             // note : predict 4 extra samples just to make sure we have enough data
             nBytesNeeded = (m_resampler.resample(1.0f/factor, m_rx.samplesNeeded, m_rx.amplitudeResampled.data(), nullptr) + 4)*m_sampleSizeInp;
         }
@@ -1085,20 +2158,7 @@ bool GGWave::decode(const void * data, uint32_t nBytes) {
             break;
         }
 
-        switch (m_sampleFormatInp) {
-            case GGWAVE_SAMPLE_FORMAT_UNDEFINED: break;
-            case GGWAVE_SAMPLE_FORMAT_U8:
-            case GGWAVE_SAMPLE_FORMAT_I8:
-            case GGWAVE_SAMPLE_FORMAT_U16:
-            case GGWAVE_SAMPLE_FORMAT_I16:
-                {
-                    memcpy(m_rx.amplitudeTmp.data(), dataBuffer, nBytesRecorded);
-                } break;
-            case GGWAVE_SAMPLE_FORMAT_F32:
-                {
-                    memcpy(m_rx.amplitudeResampled.data(), dataBuffer, nBytesRecorded);
-                } break;
-        }
+        const uint8_t * samples = dataBuffer;
 
         dataBuffer += nBytesRecorded;
         nBytes -= nBytesRecorded;
@@ -1106,52 +2166,18 @@ bool GGWave::decode(const void * data, uint32_t nBytes) {
         if (nBytesRecorded % m_sampleSizeInp != 0) {
             ggprintf("Failure during capture - provided bytes (%d) are not multiple of sample size (%d)\n",
                     nBytesRecorded, m_sampleSizeInp);
-            m_rx.samplesNeeded = m_samplesPerFrame;
+            m_rx.samplesNeeded = m_rx.frameSize;
             break;
         }
 
-        // convert to 32-bit float
         int nSamplesRecorded = nBytesRecorded/m_sampleSizeInp;
-        switch (m_sampleFormatInp) {
-            case GGWAVE_SAMPLE_FORMAT_UNDEFINED: break;
-            case GGWAVE_SAMPLE_FORMAT_U8:
-                {
-                    constexpr float scale = 1.0f/128;
-                    auto p = reinterpret_cast<uint8_t *>(m_rx.amplitudeTmp.data());
-                    for (int i = 0; i < nSamplesRecorded; ++i) {
-                        m_rx.amplitudeResampled[i] = float(int16_t(*(p + i)) - 128)*scale;
-                    }
-                } break;
-            case GGWAVE_SAMPLE_FORMAT_I8:
-                {
-                    constexpr float scale = 1.0f/128;
-                    auto p = reinterpret_cast<int8_t *>(m_rx.amplitudeTmp.data());
-                    for (int i = 0; i < nSamplesRecorded; ++i) {
-                        m_rx.amplitudeResampled[i] = float(*(p + i))*scale;
-                    }
-                } break;
-            case GGWAVE_SAMPLE_FORMAT_U16:
-                {
-                    constexpr float scale = 1.0f/32768;
-                    auto p = reinterpret_cast<uint16_t *>(m_rx.amplitudeTmp.data());
-                    for (int i = 0; i < nSamplesRecorded; ++i) {
-                        m_rx.amplitudeResampled[i] = float(int32_t(*(p + i)) - 32768)*scale;
-                    }
-                } break;
-            case GGWAVE_SAMPLE_FORMAT_I16:
-                {
-                    constexpr float scale = 1.0f/32768;
-                    auto p = reinterpret_cast<int16_t *>(m_rx.amplitudeTmp.data());
-                    for (int i = 0; i < nSamplesRecorded; ++i) {
-                        m_rx.amplitudeResampled[i] = float(*(p + i))*scale;
-                    }
-                } break;
-            case GGWAVE_SAMPLE_FORMAT_F32: break;
-        }
 
-        uint32_t offset = m_samplesPerFrame - m_rx.samplesNeeded;
+        uint32_t offset = m_rx.frameSize - m_rx.samplesNeeded;
+
+        // convert to 32-bit float - without resampling, directly into the current frame
+        ::simdKernels().toF32[m_sampleFormatInp](samples, isResampling ? m_rx.amplitudeResampled.data() : m_rx.amplitude.data() + offset, nSamplesRecorded);
 
-        if (m_needResampling) {
+        if (isResampling) {
             if (nSamplesRecorded <= 2*Resampler::kWidth) {
                 m_rx.samplesNeeded = m_samplesPerFrame;
                 break;
@@ -1165,29 +2191,67 @@ bool GGWave::decode(const void * data, uint32_t nBytes) {
             int nSamplesResampled = offset + m_resampler.resample(factor, nSamplesRecorded, m_rx.amplitudeResampled.data(), m_rx.amplitude.data() + offset);
             nSamplesRecorded = nSamplesResampled;
         } else {
-            for (int i = 0; i < nSamplesRecorded; ++i) {
-                m_rx.amplitude[offset + i] = m_rx.amplitudeResampled[i];
-            }
+            nSamplesRecorded += offset;
         }
 
         // we have enough bytes to do analysis
-        if (nSamplesRecorded >= m_samplesPerFrame) {
+        if (nSamplesRecorded >= m_rx.frameSize) {
             m_rx.hasNewAmplitude = true;
 
+            const bool wasGateOpen = m_rx.isGateOpen;
+            if (m_rxEnergyGate) {
+                updateEnergyGate();
+            }
+
             if (m_isFixedPayloadLength) {
-                decode_fixed();
+                if (m_rx.isGateOpen) {
+                    // the transmission might have started in the last skipped frame
+                    if (wasGateOpen == false) {
+                        const int    frameSize = m_rx.frameSize;
+                        const double frameLast = m_rx.basebandLast;
+
+                        for (int i = 0; i < GG_MAX(frameSize, m_rx.gatePreviousSize); ++i) {
+                            const float tmp = m_rx.amplitude[i];
+                            m_rx.amplitude[i] = m_rx.gatePrevious[i];
+                            m_rx.gatePrevious[i] = tmp;
+                        }
+
+                        m_rx.frameSize    = m_rx.gatePreviousSize;
+                        m_rx.basebandLast = m_rx.gatePreviousLast;
+
+                        decode_fixed();
+
+                        m_rx.frameSize    = frameSize;
+                        m_rx.basebandLast = frameLast;
+
+                        for (int i = 0; i < frameSize; ++i) {
+                            m_rx.amplitude[i] = m_rx.gatePrevious[i];
+                        }
+                    }
+
+                    decode_fixed();
+                } else {
+                    m_rx.gatePrevious.copy(m_rx.amplitude);
+                    m_rx.gatePreviousSize = m_rx.frameSize;
+                    m_rx.gatePreviousLast = m_rx.basebandLast;
+                    ++m_rx.framesSkipped;
+                }
             } else {
                 decode_variable();
             }
 
-            int nExtraSamples = nSamplesRecorded - m_samplesPerFrame;
+            int nExtraSamples = nSamplesRecorded - m_rx.frameSize;
             for (int i = 0; i < nExtraSamples; ++i) {
-                m_rx.amplitude[i] = m_rx.amplitude[m_samplesPerFrame + i];
+                m_rx.amplitude[i] = m_rx.amplitude[m_rx.frameSize + i];
+            }
+
+            if (m_rxNativeRate) {
+                nextNativeFrame();
             }
 
-            m_rx.samplesNeeded = m_samplesPerFrame - nExtraSamples;
+            m_rx.samplesNeeded = m_rx.frameSize - nExtraSamples;
         } else {
-            m_rx.samplesNeeded = m_samplesPerFrame - nSamplesRecorded;
+            m_rx.samplesNeeded = m_rx.frameSize - nSamplesRecorded;
             break;
         }
     }
@@ -1264,6 +2328,10 @@ int GGWave::rxFramesLeftToRecord()  const { return m_rx.framesLeftToRecord; }
 int GGWave::rxFramesToAnalyze()     const { return m_rx.framesToAnalyze; }
 int GGWave::rxFramesLeftToAnalyze() const { return m_rx.framesLeftToAnalyze; }
 int GGWave::rxDurationFrames()      const { return m_rx.recvDuration_frames; }
+int GGWave::rxFramesSkipped()       const { return m_rx.framesSkipped; }
+
+bool GGWave::rxNativeRate() const { return m_rxNativeRate; }
+int  GGWave::rxDecimation() const { return m_decimation; }
 
 bool GGWave::rxStopReceiving() {
     if (m_rx.receiving == false) {
@@ -1282,9 +2350,11 @@ int GGWave::rxDataLength() const { return m_rx.dataLength; }
 const GGWave::TxRxData &      GGWave::rxData()       const { return m_rx.data; }
 const GGWave::RxProtocol &    GGWave::rxProtocol()   const { return m_rx.protocol; }
 const GGWave::RxProtocolId &  GGWave::rxProtocolId() const { return m_rx.protocolId; }
-const GGWave::Spectrum &      GGWave::rxSpectrum()   const { return m_rx.spectrum; }
+const GGWave::Spectrum &      GGWave::rxSpectrum()   const { return m_rx.spectrumFull; }
 const GGWave::Amplitude &     GGWave::rxAmplitude()  const { return m_rx.amplitude; }
 
+const GGWave::Spectrum & GGWave::rxSpectrumHalf() const { return m_rx.spectrum; }
+
 int GGWave::rxTakeData(TxRxData & dst) {
     if (m_rx.dataLength == 0) return 0;
 
@@ -1302,7 +2372,7 @@ bool GGWave::rxTakeSpectrum(Spectrum & dst) {
     if (m_rx.hasNewSpectrum == false) return false;
 
     m_rx.hasNewSpectrum = false;
-    dst.assign(m_rx.spectrum);
+    dst.assign(m_rx.spectrumFull);
 
     return true;
 }
@@ -1322,20 +2392,84 @@ bool GGWave::computeFFTR(const float * src, float * dst, int N) {
         return false;
     }
 
-    FFT(src, dst, N, m_rx.fftWorkI.data(), m_rx.fftWorkF.data());
+    const auto & fft = ::fftBackend(m_fftRadix4);
+
+#ifdef GGWAVE_CONFIG_THREADS
+    // the tables are available even if Rx is disabled, the work buffer is not
+    const auto & plan = getFFTPlan(N, fft);
+
+    if (m_rx.fftWork.size() >= fft.sizeW(N)) {
+        FFT(fft, src, dst, N, plan.wi.data(), plan.wf.data(), m_rx.fftWork.data());
+    } else {
+        std::vector<float> work(fft.sizeW(N));
+        FFT(fft, src, dst, N, plan.wi.data(), plan.wf.data(), work.data());
+    }
+#else
+    FFT(fft, src, dst, N, m_rx.fftWorkI.data(), m_rx.fftWorkF.data(), m_rx.fftWork.data());
+#endif
 
     return true;
 }
 
 int GGWave::computeFFTR(const float * src, float * dst, int N, int * wi, float * wf) {
     if (wi == nullptr) return 2*N;
-    if (wf == nullptr) return 3 + sqrt(N/2);
+    if (wf == nullptr) return N/2;
 
-    FFT(src, dst, N, wi, wf);
+    // the tables are initialized on the first call
+    memcpy(dst, src, N*sizeof(float));
+    rdft(N, 1, dst, wi, wf);
 
     return 1;
 }
 
+bool GGWave::computeFFTRShared(const float * src, float * dst, int N) {
+#ifdef GGWAVE_CONFIG_THREADS
+    if (N < 8 || N > kMaxSamplesPerFrame || (N & (N - 1)) != 0) {
+        ggprintf("computeFFTRShared: N (%d) must be a power of 2 between 8 and %d\n", N, kMaxSamplesPerFrame);
+        return false;
+    }
+
+    const auto & fft  = ::fftBackend(false);
+    const auto & plan = getFFTPlan(N, fft);
+
+    // may be called from any thread
+    std::vector<float> work(fft.sizeW(N));
+
+    FFT(fft, src, dst, N, plan.wi.data(), plan.wf.data(), work.data());
+
+    return true;
+#else
+    (void) src;
+    (void) dst;
+    (void) N;
+
+    ggprintf("computeFFTRShared: not available without thread support\n");
+
+    return false;
+#endif
+}
+
+int GGWave::sharedHeapSize() {
+    int res = 0;
+
+#ifdef GGWAVE_CONFIG_THREADS
+    {
+        std::lock_guard<std::mutex> lock(g_fftPlansMutex);
+        for (const auto & plan : g_fftPlans) {
+            res += plan->wi.size()*sizeof(int) + plan->wf.size()*sizeof(float);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(g_toneTablesMutex);
+        for (const auto & tables : g_toneTables) {
+            res += (tables->bit1.size() + tables->bit0.size())*sizeof(float);
+        }
+    }
+#endif
+
+    return res;
+}
+
 int GGWave::filter(ggwave_Filter filter, float * waveform, int N, float p0, float p1, float * w) {
     if (w == nullptr) {
         switch (filter) {
@@ -1411,13 +2545,20 @@ int GGWave::filter(ggwave_Filter filter, float * waveform, int N, float p0, floa
 
 GGWave::Resampler::Resampler() {}
 
-bool GGWave::Resampler::alloc(void * p, int & n) {
+bool GGWave::Resampler::alloc(void * p, int & n, Engine engine) {
     ggalloc(m_sincTable,   kWidth*kSamplesPerZeroCrossing, p, n);
-    ggalloc(m_delayBuffer, 3*kWidth, p, n);
+    ggalloc(m_delayBuffer, 2*kDelaySize, p, n);
     ggalloc(m_edgeSamples, kWidth, p, n);
     ggalloc(m_samplesInp,  4096, p, n);
 
+    if (engine == kEnginePolyphase) {
+        ggalloc(m_banks, (kPhases + 1)*2*kWidth, p, n);
+    }
+
     if (p) {
+        m_engine = engine;
+        m_banksFactor = 0.0f;
+
         makeSinc();
         reset();
     }
@@ -1462,8 +2603,14 @@ int GGWave::Resampler::resample(
             m_samplesInp[i + kWidth] = samplesInp[i];
         }
         samplesInp = m_samplesInp.data();
+
+        if (m_engine == kEnginePolyphase && m_banksFactor != factor) {
+            makeBanks(factor);
+        }
     }
 
+    const auto dot = simdKernels().dot;
+
     while (notDone) {
         while (m_state.timeLast < m_state.timeInt) {
             if (++idxInp >= nSamples) {
@@ -1479,27 +2626,42 @@ int GGWave::Resampler::resample(
 
         if (notDone == false) break;
 
-        double temp1 = 0.0;
-        int left_limit = m_state.timeNow - kWidth + 1; /* leftmost neighboring sample used for interp.*/
-        int right_limit = m_state.timeNow + kWidth;    /* rightmost leftmost neighboring sample used for interp.*/
-        if (left_limit < 0) left_limit = 0;
-        if (right_limit > m_state.nSamplesTotal + kWidth) right_limit = m_state.nSamplesTotal + kWidth;
-        if (factor < 1.0) {
-            for (int j = left_limit; j < right_limit; j++) {
-                temp1 += getData(j - m_state.timeInt)*sinc(m_state.timeNow - (double) j);
+        // when only counting the output samples, there is no need to interpolate them
+        if (samplesOut && m_engine == kEnginePolyphase) {
+            // the taps of the window [timeInt - kWidth, timeInt + kWidth) for the fractional part of timeNow
+            const double phase = (m_state.timeNow - m_state.timeInt)*kPhases;
+            const int    p     = phase;
+            const float  delta = phase - p;
+
+            const float * window = m_delayBuffer.data() + m_state.delayPos;
+            const float * taps   = m_banks.data() + p*2*kWidth;
+
+            const float y0 = dot(window, taps, 2*kWidth);
+            const float y1 = dot(window, taps + 2*kWidth, 2*kWidth);
+
+            data_out = y0 + delta*(y1 - y0);
+        } else if (samplesOut) {
+            double temp1 = 0.0;
+            int left_limit = m_state.timeNow - kWidth + 1; /* leftmost neighboring sample used for interp.*/
+            int right_limit = m_state.timeNow + kWidth;    /* rightmost leftmost neighboring sample used for interp.*/
+            if (left_limit < 0) left_limit = 0;
+            if (right_limit > m_state.nSamplesTotal + kWidth) right_limit = m_state.nSamplesTotal + kWidth;
+            if (factor < 1.0) {
+                for (int j = left_limit; j < right_limit; j++) {
+                    temp1 += getData(j - m_state.timeInt)*sinc(m_state.timeNow - (double) j);
+                }
+                data_out = temp1;
             }
-            data_out = temp1;
-        }
-        else {
-            one_over_factor = 1.0 / factor;
-            for (int j = left_limit; j < right_limit; j++) {
-                temp1 += getData(j - m_state.timeInt)*one_over_factor*sinc(one_over_factor*(m_state.timeNow - (double) j));
+            else {
+                one_over_factor = 1.0 / factor;
+                for (int j = left_limit; j < right_limit; j++) {
+                    temp1 += getData(j - m_state.timeInt)*one_over_factor*sinc(one_over_factor*(m_state.timeNow - (double) j));
+                }
+                data_out = temp1;
             }
-            data_out = temp1;
         }
 
         if (samplesOut) {
-            //printf("inp = %d, l = %d, r = %d, n = %d, a = %d, b = %d\n", idxInp, left_limit, right_limit, m_state.nSamplesTotal, left_limit - m_state.timeInt, right_limit - m_state.timeInt - 1);
             samplesOut[idxOut] = data_out;
         }
         ++idxOut;
@@ -1528,14 +2690,17 @@ int GGWave::Resampler::resample(
 }
 
 float GGWave::Resampler::getData(int j) const {
-    return m_delayBuffer[(int) j + kWidth];
+    return m_delayBuffer[m_state.delayPos + j + kWidth];
 }
 
 void GGWave::Resampler::newData(float data) {
-    for (int i = 0; i < kDelaySize - 5; i++) {
-        m_delayBuffer[i] = m_delayBuffer[i + 1];
+    // the oldest sample is overwritten in both copies
+    m_delayBuffer[m_state.delayPos] = data;
+    m_delayBuffer[m_state.delayPos + kDelaySize] = data;
+
+    if (++m_state.delayPos == kDelaySize) {
+        m_state.delayPos = 0;
     }
-    m_delayBuffer[kDelaySize - 5] = data;
 }
 
 void GGWave::Resampler::makeSinc() {
@@ -1563,526 +2728,1653 @@ double GGWave::Resampler::sinc(double x) const {
     }
 }
 
-//
-// Variable payload length
-//
+void GGWave::Resampler::makeBanks(float factor) {
+    // same kernel as the sinc engine, but evaluated exactly instead of from the table
+    const double scale = factor < 1.0 ? 1.0 : 1.0/factor;
 
-void GGWave::decode_variable() {
-    m_rx.amplitudeHistory[m_rx.historyId].copy(m_rx.amplitude);
+    for (int p = 0; p <= kPhases; ++p) {
+        for (int i = 0; i < 2*kWidth; ++i) {
+            const double x = scale*((double) p/kPhases - (i - kWidth));
 
-    if (++m_rx.historyId >= kMaxSpectrumHistory) {
-        m_rx.historyId = 0;
+            double h = 0.0;
+            if (fabs(x) < kWidth - 1) {
+                h  = x == 0.0 ? 1.0 : sin(M_PI*x)/(M_PI*x);
+                h *= 0.5 + 0.5*cos(M_PI*x/kWidth);
+            }
+
+            m_banks[p*2*kWidth + i] = scale*h;
+        }
     }
 
-    if (m_rx.historyId == 0 || m_rx.receiving) {
-        m_rx.hasNewSpectrum = true;
+    m_banksFactor = factor;
+}
 
-        m_rx.amplitudeAverage.zero();
-        for (int j = 0; j < (int) m_rx.amplitudeHistory.size(); ++j) {
-            auto s = m_rx.amplitudeHistory[j];
-            for (int i = 0; i < m_samplesPerFrame; ++i) {
-                m_rx.amplitudeAverage[i] += s[i];
-            }
-        }
+//
+// Decimating front end
+//
 
-        float norm = 1.0f/kMaxSpectrumHistory;
-        for (int i = 0; i < m_samplesPerFrame; ++i) {
-            m_rx.amplitudeAverage[i] *= norm;
+bool GGWave::prepareBaseband() {
+    // the band of the Rx protocols enabled upon preparation
+    int binStart = -1;
+    int binEnd   = -1;
+    for (int i = 0; i < Protocols::rx().size(); ++i) {
+        const auto & protocol = Protocols::rx()[i];
+        if (protocol.enabled == false) {
+            continue;
         }
 
-        // calculate spectrum
-        FFT(m_rx.amplitudeAverage.data(), m_rx.fftOut.data(), m_samplesPerFrame, m_rx.fftWorkI.data(), m_rx.fftWorkF.data());
+        binStart = binStart < 0 ? protocol.freqStart : GG_MIN(binStart, protocol.freqStart);
+        binEnd   = GG_MAX(binEnd, protocol.freqStart + 32*protocol.bytesPerTx);
+    }
 
-        for (int i = 0; i < m_samplesPerFrame; ++i) {
-            m_rx.spectrum[i] = (m_rx.fftOut[2*i + 0]*m_rx.fftOut[2*i + 0] + m_rx.fftOut[2*i + 1]*m_rx.fftOut[2*i + 1]);
-        }
-        for (int i = 1; i < m_samplesPerFrame/2; ++i) {
-            m_rx.spectrum[i] += m_rx.spectrum[m_samplesPerFrame - i];
-        }
+    // the width of the spectrum of the captured audio, in bins of the protocols
+    const double nBinsInp = m_samplesPerFrame*m_basebandRatio;
+
+    if (binStart < 0 || binEnd > m_samplesPerFrame/2 || binEnd > nBinsInp/2) {
+        ggprintf("The band of the Rx protocols (bins %d - %d) does not fit in the captured audio\n", binStart, binEnd);
+        return false;
     }
 
-    if (m_rx.framesLeftToRecord > 0) {
-        memcpy(m_rx.amplitudeRecorded.data() + (m_rx.framesToRecord - m_rx.framesLeftToRecord)*m_samplesPerFrame,
-               m_rx.amplitude.data(),
-               m_samplesPerFrame*sizeof(float));
+    // the analysis steps must stay aligned to the decimated samples
+    const int width = binEnd - binStart;
+    const int step  = m_samplesPerFrame/kAnalysisStepsPerFrame;
 
-        if (--m_rx.framesLeftToRecord <= 0) {
-            m_rx.analyzing = true;
-        }
+    int decimation = 1;
+    while (2*decimation <= kMaxDecimation && step % (2*decimation) == 0 && 2*width <= m_samplesPerFrame/(2*decimation)) {
+        decimation *= 2;
     }
 
-    if (m_rx.analyzing) {
-        ggprintf("Analyzing captured data ..\n");
+    if (decimation == 1) {
+        ggprintf("The band of the Rx protocols (bins %d - %d) is too wide to be decimated\n", binStart, binEnd);
+        return false;
+    }
 
-        const int stepsPerFrame = 16;
-        const int step = m_samplesPerFrame/stepsPerFrame;
+    m_decimation        = decimation;
+    m_analyzedFrameSize = 2*m_samplesPerFrame/decimation;
+    m_basebandCenter    = (binStart + binEnd)/2;
+    m_basebandBinStart  = binStart;
+    m_basebandBinEnd    = binEnd;
 
-        bool isValid = false;
-        for (int protocolId = 0; protocolId < (int) m_rx.protocols.size(); ++protocolId) {
-            const auto & protocol = m_rx.protocols[protocolId];
-            if (protocol.enabled == false) {
-                continue;
-            }
+    // the filter spans kBasebandOrder decimated samples and is padded with zeros to a multiple of 8 for the FIR kernel
+    m_basebandTaps = (int(ceil(kBasebandOrder*decimation*m_basebandRatio)) + 7) & ~7;
 
-            // skip Rx protocol if it is mono-tone
-            if (protocol.extra == 2) {
-                continue;
-            }
+    return true;
+}
 
-            // skip Rx protocol if start frequency is different from detected one
-            if (protocol.freqStart != m_rx.markerFreqStart) {
-                continue;
-            }
+void GGWave::makeBasebandFilter() {
+    const int nTaps = m_basebandTaps;
 
-            m_rx.spectrum.zero();
+    // the center of the band in radians per captured sample and the decimated sample period in captured samples
+    const double w0   = 2.0*M_PI*m_basebandCenter/(m_samplesPerFrame*m_basebandRatio);
+    const double step = m_decimation*m_basebandRatio;
 
-            m_rx.framesToAnalyze = m_nMarkerFrames*stepsPerFrame;
-            m_rx.framesLeftToAnalyze = m_rx.framesToAnalyze;
+    // low-pass h shifted to the center of the band: g(u) = h(u)*exp(i*w0*u), u - captured samples since the input
+    // sample. Each phase holds g(k + phase/m_basebandPhases) for the k-th previous sample, stored in reverse order
+    for (int phase = 0; phase < m_basebandPhases; ++phase) {
+        float * tr = m_rx.basebandFilter.data() + 2*phase*nTaps;
+        float * ti = m_rx.basebandFilter.data() + 2*phase*nTaps + nTaps;
 
-            // note : not sure if looping backwards here is more meaningful than looping forwards
-            for (int ii = m_nMarkerFrames*stepsPerFrame - 1; ii >= 0; --ii) {
-                bool knownLength = false;
+        double sum = 0.0;
+        for (int k = 0; k < nTaps; ++k) {
+            const double u = k + double(phase)/m_basebandPhases;
+            const double h = ::bspline(kBasebandOrder, u/step);
 
-                int decodedLength = 0;
-                const int offsetStart = ii;
-                for (int itx = 0; itx < 1024; ++itx) {
-                    int offsetTx = offsetStart + itx*protocol.framesPerTx*stepsPerFrame;
-                    if (offsetTx >= m_rx.recvDuration_frames*stepsPerFrame || (itx + 1)*protocol.bytesPerTx >= (int) m_dataEncoded.size()) {
-                        break;
-                    }
+            tr[nTaps - 1 - k] = h*cos(w0*u);
+            ti[nTaps - 1 - k] = h*sin(w0*u);
 
-                    memcpy(m_rx.fftOut.data(),
-                           m_rx.amplitudeRecorded.data() + offsetTx*step,
-                           m_samplesPerFrame*sizeof(float));
+            sum += h;
+        }
 
-                    // note : should we skip the first and last frame here as they are amplitude-smoothed?
-                    for (int k = 1; k < protocol.framesPerTx; ++k) {
-                        for (int i = 0; i < m_samplesPerFrame; ++i) {
-                            m_rx.fftOut[i] += m_rx.amplitudeRecorded[(offsetTx + k*stepsPerFrame)*step + i];
-                        }
-                    }
+        for (int k = 0; k < nTaps; ++k) {
+            tr[k] /= sum;
+            ti[k] /= sum;
+        }
+    }
 
-                    FFT(m_rx.fftOut.data(), m_samplesPerFrame, m_rx.fftWorkI.data(), m_rx.fftWorkF.data());
+    // the response of the filter drops towards the edges of the band - compensate the power of each bin
+    const float * tr = m_rx.basebandFilter.data();
+    const float * ti = m_rx.basebandFilter.data() + nTaps;
+    for (int bin = m_basebandBinStart; bin < m_basebandBinEnd; ++bin) {
+        const double w = 2.0*M_PI*bin/(m_samplesPerFrame*m_basebandRatio);
+
+        double re = 0.0;
+        double im = 0.0;
+        for (int k = 0; k < nTaps; ++k) {
+            const double u = nTaps - 1 - k;
+            re += tr[k]*cos(w*u) + ti[k]*sin(w*u);
+            im += ti[k]*cos(w*u) - tr[k]*sin(w*u);
+        }
 
-                    for (int i = 0; i < m_samplesPerFrame; ++i) {
-                        m_rx.spectrum[i] = (m_rx.fftOut[2*i + 0]*m_rx.fftOut[2*i + 0] + m_rx.fftOut[2*i + 1]*m_rx.fftOut[2*i + 1]);
-                    }
-                    for (int i = 1; i < m_samplesPerFrame/2; ++i) {
-                        m_rx.spectrum[i] += m_rx.spectrum[m_samplesPerFrame - i];
-                    }
+        m_rx.basebandGain[bin - m_basebandBinStart] = 1.0/(re*re + im*im);
+    }
+}
 
-                    uint8_t curByte = 0;
-                    for (int i = 0; i < 2*protocol.bytesPerTx; ++i) {
-                        double freq = m_hzPerSample*protocol.freqStart;
-                        int bin = round(freq*m_ihzPerSample) + 16*i;
-
-                        int kmax = 0;
-                        double amax = 0.0;
-                        for (int k = 0; k < 16; ++k) {
-                            if (m_rx.spectrum[bin + k] > amax) {
-                                kmax = k;
-                                amax = m_rx.spectrum[bin + k];
-                            }
-                        }
+void GGWave::updateBaseband(float * dst) {
+    const int nTaps = m_basebandTaps;
+    const int nBins = m_samplesPerFrame/m_decimation;
 
-                        if (i%2) {
-                            curByte += (kmax << 4);
-                            m_dataEncoded[itx*protocol.bytesPerTx + i/2] = curByte;
-                            curByte = 0;
-                        } else {
-                            curByte = kmax;
-                        }
-                    }
+    auto & input = m_rx.basebandInput;
 
-                    if (itx*protocol.bytesPerTx > m_encodedDataOffset && knownLength == false) {
-                        RS::ReedSolomon rsLength(1, m_encodedDataOffset - 1, m_workRSLength.data());
-                        if ((rsLength.Decode(m_dataEncoded.data(), m_rx.data.data()) == 0) && (m_rx.data[0] > 0 && m_rx.data[0] <= 140)) {
-                            knownLength = true;
-                            decodedLength = m_rx.data[0];
-                            //printf("decoded length = %d, recvDuration_frames = %d\n", decodedLength, m_rx.recvDuration_frames);
-
-                            const int nTotalBytesExpected = m_encodedDataOffset + decodedLength + ::getECCBytesForLength(decodedLength);
-                            const int nTotalFramesExpected = 2*m_nMarkerFrames + ((nTotalBytesExpected + protocol.bytesPerTx - 1)/protocol.bytesPerTx)*protocol.framesPerTx;
-                            if (m_rx.recvDuration_frames > nTotalFramesExpected ||
-                                m_rx.recvDuration_frames < nTotalFramesExpected - 2*m_nMarkerFrames) {
-                                //printf("  - invalid number of frames: %d (expected %d)\n", m_rx.recvDuration_frames, nTotalFramesExpected);
-                                knownLength = false;
-                                break;
-                            }
-                        } else {
-                            break;
-                        }
-                    }
+    const auto & simd = ::simdKernels();
 
-                    {
-                        const int nTotalBytesExpected = m_encodedDataOffset + decodedLength + ::getECCBytesForLength(decodedLength);
-                        if (knownLength && itx*protocol.bytesPerTx > nTotalBytesExpected + 1) {
-                            break;
-                        }
-                    }
-                }
+    // z[n] = sum_k g[k]*x[n - k], evaluated at every m_decimation-th sample. The band-pass filter keeps the tones at
+    // their frequency, which the decimation folds to bin (bin % nBins), so there is no need to mix the band down.
+    // The output lags the frame by about kBasebandOrder*m_decimation/2 samples
+    if (m_rxNativeRate == false) {
+        memmove(input.data(), input.data() + m_samplesPerFrame, (nTaps - 1)*sizeof(float));
+        memcpy(input.data() + nTaps - 1, m_rx.amplitude.data(), m_samplesPerFrame*sizeof(float));
 
-                if (knownLength) {
-                    RS::ReedSolomon rsData(decodedLength, ::getECCBytesForLength(decodedLength), m_workRSData.data());
-
-                    if (rsData.Decode(m_dataEncoded.data() + m_encodedDataOffset, m_rx.data.data()) == 0) {
-                        if (decodedLength > 0) {
-                            if (m_isDSSEnabled) {
-                                for (int i = 0; i < decodedLength; ++i) {
-                                    m_rx.data[i] = m_rx.data[i] ^ getDSSMagic(i);
-                                }
-                            }
-
-                            ggprintf("Decoded length = %d, protocol = '%s' (%d)\n", decodedLength, protocol.name, protocolId);
-                            ggprintf("Received sound data successfully: '%s'\n", m_rx.data.data());
-
-                            isValid = true;
-                            m_rx.hasNewRxData = true;
-                            m_rx.dataLength = decodedLength;
-                            m_rx.protocol = protocol;
-                            m_rx.protocolId = RxProtocolId(protocolId);
-                        }
-                    }
-                }
+        const float * tr = m_rx.basebandFilter.data();
+        const float * ti = m_rx.basebandFilter.data() + nTaps;
+        simd.firDecimate(input.data(), tr, ti, nTaps, m_decimation, dst, nBins);
 
-                if (isValid) {
-                    break;
-                }
-                --m_rx.framesLeftToAnalyze;
-            }
+        return;
+    }
+
+    // at the native rate, the m-th decimated sample is at a fractional position between the captured samples.
+    // The input holds nTaps samples of the previous frames, followed by the current frame
+    const int frameSize = m_rx.frameSize;
+    memcpy(input.data() + nTaps, m_rx.amplitude.data(), frameSize*sizeof(float));
+
+    const double step  = m_decimation*m_basebandRatio;
+    const double first = nTaps + m_rx.basebandLast - (nBins - 1)*step;
+    for (int m = 0; m < nBins; ++m) {
+        const long q = (long) floor((first + m*step)*m_basebandPhases + 0.5);
+
+        const int sample = q/m_basebandPhases;
+        const int phase  = q%m_basebandPhases;
+
+        const float * tr = m_rx.basebandFilter.data() + 2*phase*nTaps;
+        const float * ti = m_rx.basebandFilter.data() + 2*phase*nTaps + nTaps;
+        simd.firDecimate(input.data() + sample - (nTaps - 1), tr, ti, nTaps, 0, dst + 2*m, 1);
+    }
+
+    memmove(input.data(), input.data() + frameSize, nTaps*sizeof(float));
+}
+
+void GGWave::nextNativeFrame() {
+    // the next frame starts after the current one and ends with the captured sample before its last decimated sample
+    m_rx.basebandLast += m_samplesPerFrame*m_basebandRatio - m_rx.frameSize;
+    m_rx.frameSize = (int) floor(m_rx.basebandLast + 0.5/m_basebandPhases) + 1;
+}
+
+void GGWave::basebandSpectrum(const float * fftOut, float * spectrum) const {
+    // the band is narrower than the decimated spectrum, so each of its bins has a distinct image
+    const int nBins = m_samplesPerFrame/m_decimation;
+    for (int bin = m_basebandBinStart; bin < m_basebandBinEnd; ++bin) {
+        const int k = bin%nBins;
+
+        spectrum[bin] = (fftOut[2*k + 0]*fftOut[2*k + 0] + fftOut[2*k + 1]*fftOut[2*k + 1])*m_rx.basebandGain[bin - m_basebandBinStart];
+    }
+}
+
+void GGWave::realSpectrum(const float * fftOut, float * spectrum) const {
+    const int nBins = m_samplesPerFrame/2;
+
+    // the real parts of bins 0 and nBins share the first complex value
+    ::simdKernels().powerSpectrum(fftOut, spectrum, nBins);
+    spectrum[0]     = fftOut[0]*fftOut[0];
+    spectrum[nBins] = fftOut[1]*fftOut[1];
+}
+
+void GGWave::updateSpectrumFull() {
+    const int nBins = m_samplesPerFrame/2;
+
+    memcpy(m_rx.spectrumFull.data(), m_rx.spectrum.data(), nBins*sizeof(float));
+    memset(m_rx.spectrumFull.data() + nBins, 0, nBins*sizeof(float));
+    m_rx.spectrumFull[0] += m_rx.spectrum[nBins];
+}
+
+void GGWave::frameSpectrum(const float * src, float * fftOut, float * spectrum, const int * wi, const float * wf, float * work) const {
+    if (src != fftOut) {
+        memcpy(fftOut, src, m_samplesPerFrame*sizeof(float));
+    }
+
+    FFT(::fftBackend(m_fftRadix4), fftOut, m_samplesPerFrame, wi, wf, work);
+
+    realSpectrum(fftOut, spectrum);
+}
+
+//
+// Variable payload length
+//
+
+void GGWave::updateProtocolBins() {
+    for (int i = 0; i < m_rx.protocols.size(); ++i) {
+        const auto & protocol = m_rx.protocols[i];
+        auto & bins = m_rx.protocolBins[i];
 
-            if (isValid) break;
+        if (protocol.enabled     == bins.enabled    &&
+            protocol.freqStart   == bins.freqStart  &&
+            protocol.bytesPerTx  == bins.bytesPerTx &&
+            protocol.framesPerTx == bins.framesPerTx) {
+            continue;
         }
 
-        m_rx.framesToRecord = 0;
+        // the recording was sized upon preparation - a transmission that does not fit in it cannot be decoded
+        if (protocol.enabled && m_isFixedPayloadLength == false && protocol.extra == 1 &&
+            GG_MIN((int) kMaxRecordedFrames, durationFrames(protocol, kMaxLengthVariable)) > m_rx.framesRecordedMax) {
+            ggprintf("Warning: disabling Rx protocol '%s' (%d) - its transmissions need more than the %d recorded frames\n",
+                     protocol.name, i, m_rx.framesRecordedMax);
+            m_rx.protocols[i].enabled = false;
+        }
 
-        if (isValid == false) {
-            ggprintf("Failed to capture sound data. Please try again (length = %d)\n", m_rx.data[0]);
-            m_rx.dataLength = -1;
-            m_rx.framesToRecord = -1;
+        bins.enabled     = protocol.enabled;
+        bins.freqStart   = protocol.freqStart;
+        bins.bytesPerTx  = protocol.bytesPerTx;
+        bins.framesPerTx = protocol.framesPerTx;
+
+        // the marker bits alternate between the two tones of each pair of bins, starting with the lower one
+        const int nBits = GG_MIN(m_nBitsInMarker, (int) Rx::ProtocolBins::kMaxBitsInMarker);
+
+        bins.hasMarkers = protocol.freqStart >= 0 && protocol.freqStart + 2*m_nBitsInMarker <= m_samplesPerFrame/2;
+        bins.markerHigh = 0;
+        for (int k = 0; k < nBits; ++k) {
+            bins.markerBins[k] = protocol.freqStart + 2*k*m_freqDelta_bin;
+            if (k%2 == 0) {
+                bins.markerHigh |= 1 << k;
+            }
         }
 
-        m_rx.receiving = false;
-        m_rx.analyzing = false;
+        bins.dataBinStart = protocol.freqStart;
+    }
+}
 
-        m_rx.spectrum.zero();
+int GGWave::countMarkerBits(int protocolId, bool isEnd) const {
+    const auto & bins = m_rx.protocolBins[protocolId];
 
-        m_rx.framesToAnalyze = 0;
-        m_rx.framesLeftToAnalyze = 0;
+    const uint32_t high = isEnd ? ~bins.markerHigh : bins.markerHigh;
+
+    int res = 0;
+    for (int k = 0; k < m_nBitsInMarker; ++k) {
+        const float cur  = m_rx.spectrum[bins.markerBins[k]];
+        const float next = m_soundMarkerThreshold*m_rx.spectrum[bins.markerBins[k] + m_freqDelta_bin];
+
+        res += (high >> k) & 1 ? cur > next : cur < next;
     }
 
-    // check if receiving data
-    if (m_rx.receiving == false) {
-        bool isReceiving = false;
+    return res;
+}
 
-        for (int i = 0; i < m_rx.protocols.size(); ++i) {
-            const auto & protocol = m_rx.protocols[i];
-            if (protocol.enabled == false) {
-                continue;
-            }
+bool GGWave::updateMarkerBands() {
+    const int nBins = 2*m_nBitsInMarker*m_freqDelta_bin;
+    const int d     = m_markerDecimation;
+    const int nTaps = m_markerTaps;
 
-            int nDetectedMarkerBits = m_nBitsInMarker;
+    int nBands = 0;
+    bool isChanged = false;
 
-            for (int i = 0; i < m_nBitsInMarker; ++i) {
-                double freq = bitFreq(protocol, i);
-                int bin = round(freq*m_ihzPerSample);
+    for (int i = 0; i < m_rx.protocols.size(); ++i) {
+        if (m_rx.protocols[i].enabled == false || m_rx.protocolBins[i].hasMarkers == false) {
+            continue;
+        }
 
-                if (i%2 == 0) {
-                    if (m_rx.spectrum[bin] <= m_soundMarkerThreshold*m_rx.spectrum[bin + m_freqDelta_bin]) --nDetectedMarkerBits;
-                } else {
-                    if (m_rx.spectrum[bin] >= m_soundMarkerThreshold*m_rx.spectrum[bin + m_freqDelta_bin]) --nDetectedMarkerBits;
-                }
-            }
+        const int binStart = m_rx.protocolBins[i].freqStart;
 
-            if (nDetectedMarkerBits == m_nBitsInMarker) {
-                m_rx.markerFreqStart = protocol.freqStart;
-                isReceiving = true;
+        bool isNew = true;
+        for (int j = 0; j < nBands; ++j) {
+            if (m_rx.markerBands[j].binStart == binStart) {
+                isNew = false;
                 break;
             }
         }
 
-        if (isReceiving) {
-            if (++m_rx.nMarkersSuccess >= 1) {
-            } else {
-                isReceiving = false;
-            }
-        } else {
-            m_rx.nMarkersSuccess = 0;
+        if (isNew == false) {
+            continue;
         }
 
-        if (isReceiving) {
-            ggprintf("Receiving sound data ...\n");
-
-            m_rx.receiving = true;
-            m_rx.data.zero();
+        auto & band = m_rx.markerBands[nBands];
+        if (nBands >= m_rx.nMarkerBands || band.binStart != binStart) {
+            isChanged = true;
 
-            // max recieve duration
-            m_rx.recvDuration_frames =
-                2*m_nMarkerFrames +
-                maxFramesPerTx(m_rx.protocols, true)*(
-                        (kMaxLengthVariable + ::getECCBytesForLength(kMaxLengthVariable))/minBytesPerTx(m_rx.protocols) + 1
-                        );
+            band.binStart = binStart;
 
-            m_rx.nMarkersSuccess = 0;
-            m_rx.framesToRecord = m_rx.recvDuration_frames;
-            m_rx.framesLeftToRecord = m_rx.recvDuration_frames;
-        }
-    } else {
-        bool isEnded = false;
+            // the triangular filter is a B-spline of order 2 - its zeros at the multiples of the decimated sample
+            // rate suppress the frequencies that alias into the band
+            const double w0 = 2.0*M_PI*(binStart + nBins/2)/m_samplesPerFrame;
+            for (int k = 0; k < nTaps; ++k) {
+                const double h = ::bspline(2, double(k)/d);
 
-        for (int i = 0; i < m_rx.protocols.size(); ++i) {
-            const auto & protocol = m_rx.protocols[i];
-            if (protocol.enabled == false) {
-                continue;
+                band.mixRe[nTaps - 1 - k] = h*cos(w0*k);
+                band.mixIm[nTaps - 1 - k] = h*sin(w0*k);
             }
 
-            int nDetectedMarkerBits = m_nBitsInMarker;
+            // the bins keep their frequency in the decimated samples. The response of the filter, which sums to d,
+            // drops towards the edges of the band
+            float * cs   = m_rx.markerTables[nBands].data();
+            float * sn   = cs + nBins;
+            float * gain = cs + 2*nBins;
+            for (int k = 0; k < nBins; ++k) {
+                const double w = 2.0*M_PI*(binStart + k)/m_samplesPerFrame;
 
-            for (int i = 0; i < m_nBitsInMarker; ++i) {
-                double freq = bitFreq(protocol, i);
-                int bin = round(freq*m_ihzPerSample);
+                cs[k] = cos(w*d);
+                sn[k] = sin(w*d);
 
-                if (i%2 == 0) {
-                    if (m_rx.spectrum[bin] >= m_soundMarkerThreshold*m_rx.spectrum[bin + m_freqDelta_bin]) nDetectedMarkerBits--;
-                } else {
-                    if (m_rx.spectrum[bin] <= m_soundMarkerThreshold*m_rx.spectrum[bin + m_freqDelta_bin]) nDetectedMarkerBits--;
+                double re = 0.0;
+                double im = 0.0;
+                for (int u = 0; u < nTaps; ++u) {
+                    const double h = ::bspline(2, double(u)/d);
+
+                    re += h*cos((w0 - w)*u);
+                    im += h*sin((w0 - w)*u);
                 }
-            }
 
-            if (nDetectedMarkerBits == m_nBitsInMarker) {
-                isEnded = true;
-                break;
+                gain[k] = d*d/(re*re + im*im);
             }
         }
 
-        if (isEnded) {
-            if (++m_rx.nMarkersSuccess >= 1) {
-            } else {
-                isEnded = false;
-            }
-        } else {
-            m_rx.nMarkersSuccess = 0;
-        }
+        ++nBands;
+    }
 
-        if (isEnded && m_rx.framesToRecord > 1) {
-            m_rx.recvDuration_frames -= m_rx.framesLeftToRecord - 1;
-            ggprintf("Received end marker. Frames left = %d, recorded = %d\n", m_rx.framesLeftToRecord, m_rx.recvDuration_frames);
-            m_rx.nMarkersSuccess = 0;
-            m_rx.framesLeftToRecord = 1;
-        }
+    if (nBands != m_rx.nMarkerBands) {
+        isChanged = true;
     }
+
+    m_rx.nMarkerBands = nBands;
+
+    return isChanged;
 }
 
-//
-// Fixed payload length
+void GGWave::addMarkerFrame(const float * src, int historyId) {
+    const int nBins = 2*m_nBitsInMarker*m_freqDelta_bin;
+    const int d     = m_markerDecimation;
+    const int nTaps = m_markerTaps;
+    const int nOut  = m_samplesPerFrame/d;
 
-void GGWave::decode_fixed() {
-    m_rx.hasNewSpectrum = true;
+    auto & input = m_rx.markerInput;
+    memmove(input.data(), input.data() + m_samplesPerFrame, (nTaps - d)*sizeof(float));
+    memcpy(input.data() + nTaps - d, src, m_samplesPerFrame*sizeof(float));
 
-    // calculate spectrum
-    FFT(m_rx.amplitude.data(), m_rx.fftOut.data(), m_samplesPerFrame, m_rx.fftWorkI.data(), m_rx.fftWorkF.data());
+    float * baseband = m_rx.markerWork.data();
+    float * re       = baseband + 2*nOut;
+    float * im       = baseband + 3*nOut;
+    float * dftRe    = baseband + 4*nOut;
+    float * dftIm    = baseband + 4*nOut + 2*nBins;
 
-    float amax = 0.0f;
-    for (int i = 0; i < m_samplesPerFrame; ++i) {
-        m_rx.spectrum[i] = (m_rx.fftOut[2*i + 0]*m_rx.fftOut[2*i + 0] + m_rx.fftOut[2*i + 1]*m_rx.fftOut[2*i + 1]);
-    }
-    for (int i = 1; i < m_samplesPerFrame/2; ++i) {
-        m_rx.spectrum[i] += m_rx.spectrum[m_samplesPerFrame - i];
-        if (i >= m_rx.minFreqStart) {
-            amax = GG_MAX(amax, m_rx.spectrum[i]);
-        }
-    }
+    const auto & simd = ::simdKernels();
 
-    // original, floating-point version
-    //m_rx.spectrumHistoryFixed[m_rx.historyIdFixed].copy(m_rx.spectrum);
+    for (int i = 0; i < m_rx.nMarkerBands; ++i) {
+        const auto & band = m_rx.markerBands[i];
 
-    // float -> uint8_t
-    amax = 255.0f/(amax == 0.0f ? 1.0f : amax);
-    for (int i = 0; i < m_samplesPerFrame; ++i) {
-        m_rx.spectrumHistoryFixed[m_rx.historyIdFixed][i] = GG_MIN(255.0f, GG_MAX(0.0f, (float) round(m_rx.spectrum[i]*amax)));
-    }
+        const float * cs = m_rx.markerTables[i].data();
+        const float * sn = cs + nBins;
 
-    // float -> uint16_t
-    //amax = 65535.0f/(amax == 0.0f ? 1.0f : amax);
-    //for (int i = 0; i < m_samplesPerFrame; ++i) {
-    //    m_rx.spectrumHistoryFixed[m_rx.historyIdFixed][i] = GG_MIN(65535.0f, GG_MAX(0.0f, (float) round(m_rx.spectrum[i]*amax)));
-    //}
+        simd.firDecimate(input.data(), band.mixRe, band.mixIm, nTaps, d, baseband, nOut);
+        simd.deinterleave(baseband, re, im, nOut);
 
-    if (++m_rx.historyIdFixed >= (int) m_rx.spectrumHistoryFixed.size()) {
-        m_rx.historyIdFixed = 0;
-    }
+        simd.goertzel(re, nOut, cs, sn, dftRe, nBins);
+        simd.goertzel(im, nOut, cs, sn, dftIm, nBins);
 
-    bool isValid = false;
-    for (int protocolId = 0; protocolId < (int) m_rx.protocols.size(); ++protocolId) {
-        const auto & protocol = m_rx.protocols[protocolId];
-        if (protocol.enabled == false) {
-            continue;
+        // sum_m (re[m] + i*im[m])*exp(-i*w*m) from the cos and sin sums of the real and imaginary parts
+        float * dst = m_rx.markerDFT[historyId].data() + 2*i*nBins;
+        for (int k = 0; k < nBins; ++k) {
+            dst[2*k + 0] = dftRe[2*k + 0] + dftIm[2*k + 1];
+            dst[2*k + 1] = dftIm[2*k + 0] - dftRe[2*k + 1];
         }
+    }
+}
 
-        const int binStart = protocol.freqStart;
-        const int binDelta = 16;
-        const int binOffset = protocol.extra == 1 ? binDelta : 0;
+void GGWave::updateMarkerSpectrum() {
+    const int nBins = 2*m_nBitsInMarker*m_freqDelta_bin;
 
-        if (binStart > m_samplesPerFrame) {
-            continue;
+    // the row of the current frame in the history. All the rows are recomputed, starting from the oldest, after
+    // the bands change or when frames were added without updating the marker bins
+    const int historyId = (m_rx.historyId + kMaxSpectrumHistory - 1)%kMaxSpectrumHistory;
+    if (updateMarkerBands() || m_rx.markersValid == false) {
+        for (int j = 1; j <= kMaxSpectrumHistory; ++j) {
+            const int id = (historyId + j)%kMaxSpectrumHistory;
+            addMarkerFrame(m_rx.amplitudeHistory[id].data(), id);
         }
 
-        const int totalLength = m_payloadLength + getECCBytesForLength(m_payloadLength);
-        const int totalTxs = protocol.extra*((totalLength + protocol.bytesPerTx - 1)/protocol.bytesPerTx);
+        m_rx.markersValid = true;
+    } else {
+        addMarkerFrame(m_rx.amplitudeHistory[historyId].data(), historyId);
+    }
+
+    // the DFT of the average of the frames is the average of their DFTs
+    const float norm = 1.0f/kMaxSpectrumHistory;
+    for (int i = 0; i < m_rx.nMarkerBands; ++i) {
+        const int binStart = m_rx.markerBands[i].binStart;
+        const float * gain = m_rx.markerTables[i].data() + 2*nBins;
+
+        for (int k = 0; k < nBins; ++k) {
+            float re = 0.0f;
+            float im = 0.0f;
+            for (int j = 0; j < kMaxSpectrumHistory; ++j) {
+                re += m_rx.markerDFT[j][2*(i*nBins + k) + 0];
+                im += m_rx.markerDFT[j][2*(i*nBins + k) + 1];
+            }
+
+            re *= norm;
+            im *= norm;
 
-        int historyStartId = m_rx.historyIdFixed - totalTxs*protocol.framesPerTx;
-        if (historyStartId < 0) {
-            historyStartId += m_rx.spectrumHistoryFixed.size();
+            m_rx.spectrum[binStart + k] = (re*re + im*im)*gain[k];
         }
+    }
+}
 
-        const int nTones = 2*protocol.bytesPerTx;
-        m_rx.detectedBins.zero();
+int GGWave::estimateDataStart() {
+    const int nOffsets = m_nMarkerFrames*kAnalysisStepsPerFrame;
+    const int nBins    = 2*m_nBitsInMarker;
+    const int step     = m_analyzedFrameSize/kAnalysisStepsPerFrame;
+
+    // default order - same as the exhaustive search, from the last offset to the first
+    for (int i = 0; i < nOffsets; ++i) {
+        m_rx.analysisOffsets[i] = nOffsets - 1 - i;
+    }
 
-        int txNeededTotal   = 0;
-        int txDetectedTotal = 0;
-        bool detectedSignal = true;
+    // number of frame-long windows that start within the marker search range
+    const int nWindows = GG_MIN(nOffsets + 1, m_rx.recvDuration_frames*kAnalysisStepsPerFrame - kAnalysisStepsPerFrame + 1);
+    if (nWindows < kAnalysisStepsPerFrame) {
+        return -1;
+    }
 
-        for (int k = 0; k < totalTxs; ++k) {
-            if (k % protocol.extra == 0) {
-                m_rx.detectedTones.zero(16*nTones);
+    const int nSteps = nWindows + kAnalysisStepsPerFrame - 1;
+
+    // DFT of the marker bins over each analysis step
+    for (int k = 0; k < nBins; ++k) {
+        float * twr = m_rx.syncTwiddles.data() + (2*k + 0)*step;
+        float * twi = m_rx.syncTwiddles.data() + (2*k + 1)*step;
+        if (m_decimation > 1) {
+            // complex samples - the real and imaginary parts of the product are dot products with (cos, -sin)
+            // and (sin, cos)
+            for (int i = 0; i < step/2; ++i) {
+                const double w = -2.0*M_PI*(m_rx.markerFreqStart + k)*i*m_decimation*m_isamplesPerFrame;
+                twr[2*i + 0] = cos(w);
+                twr[2*i + 1] = -sin(w);
+                twi[2*i + 0] = sin(w);
+                twi[2*i + 1] = cos(w);
+            }
+        } else {
+            for (int i = 0; i < step; ++i) {
+                const double w = -2.0*M_PI*(m_rx.markerFreqStart + k)*i*m_isamplesPerFrame;
+                twr[i] = cos(w);
+                twi[i] = sin(w);
             }
+        }
+    }
 
-            for (int i = 0; i < protocol.framesPerTx; ++i) {
-                int historyId = historyStartId + k*protocol.framesPerTx + i;
-                if (historyId >= (int) m_rx.spectrumHistoryFixed.size()) {
-                    historyId -= m_rx.spectrumHistoryFixed.size();
-                }
+    const auto dot = ::simdKernels().dot;
+    for (int s = 0; s < nSteps; ++s) {
+        const float * x = m_rx.amplitudeRecorded.data() + s*step;
+        if (m_rxRecordI16) {
+            readRecorded(s*step, step, m_rx.fftOut.data(), false);
+            x = m_rx.fftOut.data();
+        }
+        for (int k = 0; k < nBins; ++k) {
+            m_rx.syncSteps[2*(s*nBins + k) + 0] = dot(x, m_rx.syncTwiddles.data() + (2*k + 0)*step, step);
+            m_rx.syncSteps[2*(s*nBins + k) + 1] = dot(x, m_rx.syncTwiddles.data() + (2*k + 1)*step, step);
+        }
+    }
 
-                for (int j = 0; j < protocol.bytesPerTx; ++j) {
-                    int f0bin = 0;
-                    auto f0max = m_rx.spectrumHistoryFixed[historyId][binStart + 2*j*binDelta];
+    // the DFT of a window is the sum of the DFTs of its steps, each rotated by the phase of the step start:
+    //   X_t = sum_j P_(t+j) w^j, w = exp(-2*pi*i*bin/kAnalysisStepsPerFrame)
+    // and since w^kAnalysisStepsPerFrame = 1, the next window is X_(t+1) = (X_t - P_t + P_(t+kAnalysisStepsPerFrame))/w
+    float wr[kAnalysisStepsPerFrame];
+    float wi[kAnalysisStepsPerFrame];
+    for (int j = 0; j < kAnalysisStepsPerFrame; ++j) {
+        wr[j] = cos(-2.0*M_PI*j/kAnalysisStepsPerFrame);
+        wi[j] = sin(-2.0*M_PI*j/kAnalysisStepsPerFrame);
+    }
 
-                    for (int b = 1; b < 16; ++b) {
-                        {
-                            const auto & v = m_rx.spectrumHistoryFixed[historyId][binStart + 2*j*binDelta + b];
+    auto window = m_rx.syncWindow;
+    for (int k = 0; k < nBins; ++k) {
+        const int bin = m_rx.markerFreqStart + k;
 
-                            if (f0max <= v) {
-                                f0max = v;
-                                f0bin = b;
-                            }
-                        }
-                    }
+        float re = 0.0f;
+        float im = 0.0f;
+        for (int j = 0; j < kAnalysisStepsPerFrame; ++j) {
+            const int it = (bin*j)%kAnalysisStepsPerFrame;
+            const float * v = m_rx.syncSteps.data() + 2*(j*nBins + k);
 
-                    int f1bin = 0;
-                    if (protocol.extra == 1) {
-                        auto f1max = m_rx.spectrumHistoryFixed[historyId][binStart + 2*j*binDelta + binOffset];
-                        for (int b = 1; b < 16; ++b) {
-                            const auto & v = m_rx.spectrumHistoryFixed[historyId][binStart + 2*j*binDelta + binOffset + b];
+            re += v[0]*wr[it] - v[1]*wi[it];
+            im += v[0]*wi[it] + v[1]*wr[it];
+        }
 
-                            if (f1max <= v) {
-                                f1max = v;
-                                f1bin = b;
-                            }
-                        }
-                    } else {
-                        f1bin = f0bin;
-                    }
+        window[2*k + 0] = re;
+        window[2*k + 1] = im;
+    }
 
-                    if ((k + 0)%protocol.extra == 0) m_rx.detectedTones[(2*j + 0)*16 + f0bin]++;
-                    if ((k + 1)%protocol.extra == 0) m_rx.detectedTones[(2*j + 1)*16 + f1bin]++;
-                }
-            }
+    // score of each window - the average over the marker bits of the normalized difference between the marker
+    // tone and the other tone of the bit. +1 inside the start marker, close to 0 for the data and for noise
+    for (int t = 0; t < nWindows; ++t) {
+        float score = 0.0f;
 
-            if (protocol.extra > 1 && (k % protocol.extra == 0)) continue;
+        for (int i = 0; i < m_nBitsInMarker; ++i) {
+            // the start marker emits even bits on the first bin of the pair and odd bits on the second
+            const int kMarker = 2*i + i%2;
+            const int kOther  = 2*i + 1 - i%2;
 
-            int txNeeded = 0;
-            int txDetected = 0;
-            for (int j = 0; j < protocol.bytesPerTx; ++j) {
-                if ((k/protocol.extra)*protocol.bytesPerTx + j >= totalLength) break;
-                txNeeded += 2;
-                for (int b = 0; b < 16; ++b) {
-                    if (m_rx.detectedTones[(2*j + 0)*16 + b] > protocol.framesPerTx/2) {
-                        m_rx.detectedBins[2*((k/protocol.extra)*protocol.bytesPerTx + j) + 0] = b;
-                        txDetected++;
-                    }
-                    if (m_rx.detectedTones[(2*j + 1)*16 + b] > protocol.framesPerTx/2) {
-                        m_rx.detectedBins[2*((k/protocol.extra)*protocol.bytesPerTx + j) + 1] = b;
-                        txDetected++;
-                    }
-                }
-            }
+            const float energyMarker = window[2*kMarker + 0]*window[2*kMarker + 0] + window[2*kMarker + 1]*window[2*kMarker + 1];
+            const float energyOther  = window[2*kOther  + 0]*window[2*kOther  + 0] + window[2*kOther  + 1]*window[2*kOther  + 1];
 
-            txDetectedTotal += txDetected;
-            txNeededTotal += txNeeded;
+            score += (energyMarker - energyOther)/(energyMarker + energyOther + 1e-20f);
         }
 
-        if (txDetectedTotal < 0.75*txNeededTotal) {
-            detectedSignal = false;
-        }
+        m_rx.syncScore[t] = score/m_nBitsInMarker;
 
-        if (detectedSignal) {
-            RS::ReedSolomon rsData(m_payloadLength, getECCBytesForLength(m_payloadLength), m_workRSData.data());
+        if (t + 1 < nWindows) {
+            for (int k = 0; k < nBins; ++k) {
+                // multiply by 1/w = conj(w)
+                const int it = (m_rx.markerFreqStart + k)%kAnalysisStepsPerFrame;
+                const float * v0 = m_rx.syncSteps.data() + 2*(t*nBins + k);
+                const float * v1 = m_rx.syncSteps.data() + 2*((t + kAnalysisStepsPerFrame)*nBins + k);
 
-            for (int j = 0; j < totalLength; ++j) {
-                m_dataEncoded[j] = (m_rx.detectedBins[2*j + 1] << 4) + m_rx.detectedBins[2*j + 0];
-            }
+                const float re = window[2*k + 0] - v0[0] + v1[0];
+                const float im = window[2*k + 1] - v0[1] + v1[1];
 
-            if (rsData.Decode(m_dataEncoded.data(), m_rx.data.data()) == 0) {
-                if (m_isDSSEnabled) {
-                    for (int i = 0; i < m_payloadLength; ++i) {
-                        m_rx.data[i] = m_rx.data[i] ^ getDSSMagic(i);
-                    }
-                }
+                window[2*k + 0] = re*wr[it] + im*wi[it];
+                window[2*k + 1] = im*wr[it] - re*wi[it];
+            }
+        }
+    }
 
-                ggprintf("Decoded length = %d, protocol = '%s' (%d)\n", m_payloadLength, protocol.name, protocolId);
-                ggprintf("Received sound data successfully: '%s'\n", m_rx.data.data());
+    // fit the ideal score - the fraction of the window that overlaps the start marker. The squared error of
+    // offset o is, up to a constant, sum_t r_o(t)*(r_o(t) - 2*s_t) with r_o(t) = 1 for t <= o - kAnalysisStepsPerFrame,
+    // a linear ramp down to 0 at t = o and 0 after that
+    int offsetBest = -1;
+    float errBest = 0.0f;
+    float errFull = 0.0f; // windows that are fully inside the start marker
+    for (int o = 0; o < nOffsets; ++o) {
+        const int tFull = o - kAnalysisStepsPerFrame;
+        if (tFull >= 0 && tFull < nWindows) {
+            errFull += 1.0f - 2.0f*m_rx.syncScore[tFull];
+        }
 
-                isValid = true;
-                m_rx.hasNewRxData = true;
-                m_rx.dataLength = m_payloadLength;
-                m_rx.protocol = protocol;
-                m_rx.protocolId = RxProtocolId(protocolId);
-            }
+        float err = errFull;
+        for (int t = GG_MAX(0, tFull + 1); t < GG_MIN(o, nWindows); ++t) {
+            const float r = float(o - t)/kAnalysisStepsPerFrame;
+            err += r*(r - 2.0f*m_rx.syncScore[t]);
         }
 
-        if (isValid) {
-            break;
+        if (offsetBest < 0 || err < errBest) {
+            offsetBest = o;
+            errBest = err;
         }
     }
+
+    // try the estimated offset first, followed by its neighbours in order of increasing distance
+    int n = 0;
+    m_rx.analysisOffsets[n++] = offsetBest;
+    for (int d = 1; n < nOffsets; ++d) {
+        if (offsetBest + d < nOffsets) m_rx.analysisOffsets[n++] = offsetBest + d;
+        if (offsetBest - d >= 0)       m_rx.analysisOffsets[n++] = offsetBest - d;
+    }
+
+    return offsetBest;
 }
 
-int GGWave::maxFramesPerTx(const Protocols & protocols, bool excludeMT) const {
-    int res = 0;
-    for (int i = 0; i < protocols.size(); ++i) {
-        const auto & protocol = protocols[i];
-        if (protocol.enabled == false) {
-            continue;
+void GGWave::readRecorded(int offset, int n, float * dst, bool add) const {
+    if (m_rxRecordI16) {
+        const int16_t * src = m_rx.amplitudeRecordedI16.data() + offset;
+        if (add) {
+            for (int i = 0; i < n; ++i) {
+                dst[i] += src[i]*(1.0f/32768);
+            }
+        } else {
+            ::simdKernels().toF32[GGWAVE_SAMPLE_FORMAT_I16](src, dst, n);
         }
-        if (excludeMT && protocol.extra > 1) {
-            continue;
+    } else {
+        const float * src = m_rx.amplitudeRecorded.data() + offset;
+        if (add) {
+            for (int i = 0; i < n; ++i) {
+                dst[i] += src[i];
+            }
+        } else {
+            memcpy(dst, src, n*sizeof(float));
         }
-        res = GG_MAX(res, protocol.framesPerTx*protocol.extra);
     }
-    return res;
 }
 
-int GGWave::minBytesPerTx(const Protocols & protocols) const {
-    int res = 1;
-    for (int i = 0; i < protocols.size(); ++i) {
-        const auto & protocol = protocols[i];
-        if (protocol.enabled == false) {
-            continue;
-        }
-        res = GG_MIN(res, (int) protocol.bytesPerTx);
+void GGWave::analyzeTx(int protocolId, int offsetTx, const AnalysisWork & work, uint8_t * dst) {
+    const auto & protocol = m_rx.protocols[protocolId];
+    const int step = m_analyzedFrameSize/kAnalysisStepsPerFrame;
+
+    auto fftOut   = work.fftOut;
+    auto spectrum = work.spectrum;
+
+    readRecorded(offsetTx*step, m_analyzedFrameSize, fftOut.data(), false);
+
+    // note : should we skip the first and last frame here as they are amplitude-smoothed?
+    for (int k = 1; k < protocol.framesPerTx; ++k) {
+        readRecorded((offsetTx + k*kAnalysisStepsPerFrame)*step, m_analyzedFrameSize, fftOut.data(), true);
     }
-    return res;
-}
 
-int GGWave::maxBytesPerTx(const Protocols & protocols) const {
-    int res = 1;
-    for (int i = 0; i < protocols.size(); ++i) {
-        const auto & protocol = protocols[i];
-        if (protocol.enabled == false) {
-            continue;
+    if (m_decimation > 1) {
+        FFTComplex(::fftBackend(m_fftRadix4), fftOut.data(), m_samplesPerFrame/m_decimation, work.fftWorkI.data(), work.fftWorkF.data(), work.fftWork.data());
+        basebandSpectrum(fftOut.data(), spectrum.data());
+    } else {
+        frameSpectrum(fftOut.data(), fftOut.data(), spectrum.data(), work.fftWorkI.data(), work.fftWorkF.data(), work.fftWork.data());
+    }
+
+    uint8_t curByte = 0;
+    for (int i = 0; i < 2*protocol.bytesPerTx; ++i) {
+        const int bin = m_rx.protocolBins[protocolId].dataBinStart + 16*i;
+
+        int kmax = 0;
+        double amax = 0.0;
+        for (int k = 0; k < 16; ++k) {
+            if (spectrum[bin + k] > amax) {
+                kmax = k;
+                amax = spectrum[bin + k];
+            }
+        }
+
+        if (i%2) {
+            curByte += (kmax << 4);
+            dst[i/2] = curByte;
+            curByte = 0;
+        } else {
+            curByte = kmax;
         }
-        res = GG_MAX(res, (int) protocol.bytesPerTx);
     }
-    return res;
+}
+
+int GGWave::analyzeLength(int protocolId, int offsetStart, const AnalysisWork & work) {
+    const auto & protocol = m_rx.protocols[protocolId];
+
+    auto dataEncoded = work.dataEncoded;
+    auto data        = work.data;
+
+    const int nTx = (m_encodedDataOffset + protocol.bytesPerTx - 1)/protocol.bytesPerTx;
+    for (int itx = 0; itx < nTx; ++itx) {
+        analyzeTx(protocolId, offsetStart + itx*protocol.framesPerTx*kAnalysisStepsPerFrame, work, dataEncoded.data() + itx*protocol.bytesPerTx);
+    }
+
+    RS::ReedSolomon rsLength(1, m_encodedDataOffset - 1, work.workRSLength.data());
+    if ((rsLength.Decode(dataEncoded.data(), data.data()) == 0) && (data[0] > 0 && data[0] <= kMaxLengthVariable)) {
+        return data[0];
+    }
+
+    return 0;
+}
+
+int GGWave::analyzeCandidate(int protocolId, int offsetStart, const AnalysisWork & work) {
+    const auto & protocol = m_rx.protocols[protocolId];
+
+    const int stepsPerFrame = kAnalysisStepsPerFrame;
+
+    auto dataEncoded = work.dataEncoded;
+    auto data        = work.data;
+
+    bool knownLength = false;
+
+    int decodedLength = 0;
+    int nBytesDecoded = 0;
+    for (int itx = 0; itx < 1024; ++itx) {
+        int offsetTx = offsetStart + itx*protocol.framesPerTx*stepsPerFrame;
+        if (offsetTx >= m_rx.recvDuration_frames*stepsPerFrame || (itx + 1)*protocol.bytesPerTx >= (int) dataEncoded.size()) {
+            break;
+        }
+
+        analyzeTx(protocolId, offsetTx, work, dataEncoded.data() + itx*protocol.bytesPerTx);
+
+        nBytesDecoded = (itx + 1)*protocol.bytesPerTx;
+
+        if (itx*protocol.bytesPerTx > m_encodedDataOffset && knownLength == false) {
+            RS::ReedSolomon rsLength(1, m_encodedDataOffset - 1, work.workRSLength.data());
+            if ((rsLength.Decode(dataEncoded.data(), data.data()) == 0) && (data[0] > 0 && data[0] <= 140)) {
+                knownLength = true;
+                decodedLength = data[0];
+                //printf("decoded length = %d, recvDuration_frames = %d\n", decodedLength, m_rx.recvDuration_frames);
+
+                const int nTotalBytesExpected = m_encodedDataOffset + decodedLength + ::getECCBytesForLength(decodedLength);
+                const int nTotalFramesExpected = 2*m_nMarkerFrames + ((nTotalBytesExpected + protocol.bytesPerTx - 1)/protocol.bytesPerTx)*protocol.framesPerTx;
+                if (m_rx.recvDuration_frames > nTotalFramesExpected ||
+                    m_rx.recvDuration_frames < nTotalFramesExpected - 2*m_nMarkerFrames) {
+                    //printf("  - invalid number of frames: %d (expected %d)\n", m_rx.recvDuration_frames, nTotalFramesExpected);
+                    knownLength = false;
+                    break;
+                }
+            } else {
+                break;
+            }
+        }
+
+        {
+            const int nTotalBytesExpected = m_encodedDataOffset + decodedLength + ::getECCBytesForLength(decodedLength);
+            if (knownLength && itx*protocol.bytesPerTx > nTotalBytesExpected + 1) {
+                break;
+            }
+        }
+    }
+
+    if (knownLength == false || decodedLength <= 0) {
+        return 0;
+    }
+
+    // do not let bytes left over from previously analyzed candidates take part in the decoding
+    if (nBytesDecoded < m_encodedDataOffset + decodedLength + ::getECCBytesForLength(decodedLength)) {
+        return 0;
+    }
+
+    RS::ReedSolomon rsData(decodedLength, ::getECCBytesForLength(decodedLength), work.workRSData.data());
+
+    if (rsData.Decode(dataEncoded.data() + m_encodedDataOffset, data.data()) != 0) {
+        return 0;
+    }
+
+    if (m_isDSSEnabled) {
+        for (int i = 0; i < decodedLength; ++i) {
+            data[i] = data[i] ^ getDSSMagic(i);
+        }
+    }
+
+    return decodedLength;
+}
+
+void GGWave::analyzeCandidates(int workerId) {
+#ifdef GGWAVE_CONFIG_THREADS
+    auto & workers = *m_workers;
+
+    const AnalysisWork work = workerId == 0 ?
+        AnalysisWork {
+            m_rx.fftOut, m_rx.fftWorkI, m_rx.fftWorkF, m_rx.fftWork, m_rx.spectrum, m_dataEncoded, m_rx.data, m_workRSLength, m_workRSData,
+        } :
+        AnalysisWork {
+            m_rx.analysisFftOut[workerId - 1],
+            m_rx.fftWorkI,
+            m_rx.fftWorkF,
+            m_rx.analysisFftWork[workerId - 1],
+            m_rx.analysisSpectrum[workerId - 1],
+            m_rx.analysisDataEncoded[workerId - 1],
+            m_rx.analysisData[workerId - 1],
+            m_rx.analysisWorkRSLength[workerId - 1],
+            m_rx.analysisWorkRSData[workerId - 1],
+        };
+
+    const int nCandidates = workers.nProtocols*workers.nOffsets;
+
+    int nAnalyzed = 0;
+    while (true) {
+        // candidates are handed out in increasing rank, so once we pass the best valid one there is nothing left to do
+        const int rank = workers.nextRank.fetch_add(1);
+        if (rank >= nCandidates || rank > workers.bestRank.load()) {
+            break;
+        }
+
+        const int protocolId  = workers.protocolIds[rank%workers.nProtocols];
+        const int offsetStart = m_rx.analysisOffsets[rank/workers.nProtocols];
+
+        const int decodedLength = analyzeCandidate(protocolId, offsetStart, work);
+        if (decodedLength > 0) {
+            workers.resultRank[workerId] = rank;
+            workers.resultLength[workerId] = decodedLength;
+
+            int rankBest = workers.bestRank.load();
+            while (rank < rankBest && workers.bestRank.compare_exchange_weak(rankBest, rank) == false) {}
+
+            break;
+        }
+
+        ++nAnalyzed;
+    }
+
+    // same progress as the single-threaded search, which counts the candidates that failed to decode
+    {
+        std::lock_guard<std::mutex> lock(workers.mutex);
+        m_rx.framesLeftToAnalyze -= nAnalyzed;
+    }
+#else
+    (void) workerId;
+#endif
+}
+
+void GGWave::decode_variable() {
+    // the history is kept up to date while the gate is closed, so the average of the frame that opens it is the same
+    const bool isIdle = m_rx.isGateOpen == false && m_rx.receiving == false && m_rx.analyzing == false;
+
+    if (m_decimation == 1) {
+        m_rx.amplitudeHistory[m_rx.historyId].copy(m_rx.amplitude);
+    } else if (isIdle) {
+        // the frames skipped by the gate are not filtered - they drop out of the average within a few frames
+        m_rx.amplitudeHistory[m_rx.historyId].zero();
+    } else {
+        updateBaseband(m_rx.baseband.data());
+        m_rx.amplitudeHistory[m_rx.historyId].copy(m_rx.baseband);
+    }
+
+    if (++m_rx.historyId >= kMaxSpectrumHistory) {
+        m_rx.historyId = 0;
+    }
+
+    if (isIdle) {
+        ++m_rx.framesSkipped;
+        m_rx.markersValid = false;
+        return;
+    }
+
+    // the Rx protocols can change between the calls - the bins are not used by the skipped frames
+    updateProtocolBins();
+
+    // while listening for the start marker, only the marker bins are updated - on every frame
+    const bool isListening = m_rxIncrementalMarkers && m_rx.receiving == false && m_rx.analyzing == false;
+    if (isListening) {
+        updateMarkerSpectrum();
+    } else {
+        m_rx.markersValid = false;
+    }
+
+    if ((m_rx.historyId == 0 && isListening == false) || m_rx.receiving) {
+        m_rx.hasNewSpectrum = true;
+
+        m_rx.amplitudeAverage.zero();
+        for (int j = 0; j < (int) m_rx.amplitudeHistory.size(); ++j) {
+            auto s = m_rx.amplitudeHistory[j];
+            for (int i = 0; i < m_analyzedFrameSize; ++i) {
+                m_rx.amplitudeAverage[i] += s[i];
+            }
+        }
+
+        float norm = 1.0f/kMaxSpectrumHistory;
+        for (int i = 0; i < m_analyzedFrameSize; ++i) {
+            m_rx.amplitudeAverage[i] *= norm;
+        }
+
+        // calculate spectrum
+        if (m_decimation > 1) {
+            memcpy(m_rx.fftOut.data(), m_rx.amplitudeAverage.data(), m_analyzedFrameSize*sizeof(float));
+            FFTComplex(::fftBackend(m_fftRadix4), m_rx.fftOut.data(), m_samplesPerFrame/m_decimation, m_rx.fftWorkI.data(), m_rx.fftWorkF.data(), m_rx.fftWork.data());
+            basebandSpectrum(m_rx.fftOut.data(), m_rx.spectrum.data());
+        } else {
+            frameSpectrum(m_rx.amplitudeAverage.data(), m_rx.fftOut.data(), m_rx.spectrum.data(), m_rx.fftWorkI.data(), m_rx.fftWorkF.data(), m_rx.fftWork.data());
+        }
+
+        updateSpectrumFull();
+    }
+
+    if (m_rx.framesLeftToRecord > 0) {
+        const int offset = (m_rx.framesToRecord - m_rx.framesLeftToRecord)*m_analyzedFrameSize;
+        const float * src = m_decimation > 1 ? m_rx.baseband.data() : m_rx.amplitude.data();
+        if (m_rxRecordI16) {
+            ::simdKernels().fromF32[GGWAVE_SAMPLE_FORMAT_I16](src, m_rx.amplitudeRecordedI16.data() + offset, m_analyzedFrameSize);
+        } else {
+            memcpy(m_rx.amplitudeRecorded.data() + offset, src, m_analyzedFrameSize*sizeof(float));
+        }
+
+        if (--m_rx.framesLeftToRecord <= 0) {
+            m_rx.analyzing = true;
+        }
+    }
+
+    if (m_rx.analyzing) {
+        ggprintf("Analyzing captured data ..\n");
+
+        const int nOffsets = m_nMarkerFrames*kAnalysisStepsPerFrame;
+
+        bool isValid = false;
+        int protocolIdValid = -1;
+        int decodedLength = 0;
+
+        // all protocols are tried at the most likely offsets first, so the analysis usually ends after
+        // a few candidates instead of searching all offsets of each protocol
+        estimateDataStart();
+
+#ifdef GGWAVE_CONFIG_THREADS
+        if (m_workers) {
+            auto & workers = *m_workers;
+
+            workers.nProtocols = 0;
+            workers.nOffsets = nOffsets;
+            for (int protocolId = 0; protocolId < (int) m_rx.protocols.size(); ++protocolId) {
+                const auto & protocol = m_rx.protocols[protocolId];
+
+                // same protocol filter as in the single-threaded search below
+                if (protocol.enabled == false || protocol.extra == 2 || protocol.freqStart != m_rx.markerFreqStart) {
+                    continue;
+                }
+
+                if (m_rx.earlyStop && m_rx.framesEarly[protocolId] != m_rx.framesToRecord) {
+                    continue;
+                }
+
+                workers.protocolIds[workers.nProtocols++] = protocolId;
+            }
+
+            m_rx.framesToAnalyze = workers.nProtocols*nOffsets;
+            m_rx.framesLeftToAnalyze = m_rx.framesToAnalyze;
+
+            workers.run();
+
+            int workerIdValid = -1;
+            for (int i = 0; i < (int) workers.resultRank.size(); ++i) {
+                if (workers.resultRank[i] >= 0 && (workerIdValid < 0 || workers.resultRank[i] < workers.resultRank[workerIdValid])) {
+                    workerIdValid = i;
+                }
+            }
+
+            if (workerIdValid >= 0) {
+                isValid = true;
+                protocolIdValid = workers.protocolIds[workers.resultRank[workerIdValid]%workers.nProtocols];
+                decodedLength = workers.resultLength[workerIdValid];
+
+                if (workerIdValid > 0) {
+                    m_rx.data.copy(m_rx.analysisData[workerIdValid - 1]);
+                }
+            }
+        } else
+#endif
+        {
+            const AnalysisWork work = {
+                m_rx.fftOut, m_rx.fftWorkI, m_rx.fftWorkF, m_rx.fftWork, m_rx.spectrum, m_dataEncoded, m_rx.data, m_workRSLength, m_workRSData,
+            };
+
+            int nProtocols = 0;
+            int protocolIds[GGWAVE_PROTOCOL_COUNT];
+
+            for (int protocolId = 0; protocolId < (int) m_rx.protocols.size(); ++protocolId) {
+                const auto & protocol = m_rx.protocols[protocolId];
+                if (protocol.enabled == false) {
+                    continue;
+                }
+
+                // skip Rx protocol if it is mono-tone
+                if (protocol.extra == 2) {
+                    continue;
+                }
+
+                // skip Rx protocol if start frequency is different from detected one
+                if (protocol.freqStart != m_rx.markerFreqStart) {
+                    continue;
+                }
+
+                // skip Rx protocol if the recording was stopped early at the expected end of another protocol
+                if (m_rx.earlyStop && m_rx.framesEarly[protocolId] != m_rx.framesToRecord) {
+                    continue;
+                }
+
+                protocolIds[nProtocols++] = protocolId;
+            }
+
+            m_rx.framesToAnalyze = nProtocols*nOffsets;
+            m_rx.framesLeftToAnalyze = m_rx.framesToAnalyze;
+
+            for (int ii = 0; ii < nOffsets && isValid == false; ++ii) {
+                for (int i = 0; i < nProtocols; ++i) {
+                    decodedLength = analyzeCandidate(protocolIds[i], m_rx.analysisOffsets[ii], work);
+                    if (decodedLength > 0) {
+                        isValid = true;
+                        protocolIdValid = protocolIds[i];
+                        break;
+                    }
+                    --m_rx.framesLeftToAnalyze;
+                }
+            }
+        }
+
+        if (isValid) {
+            const auto & protocol = m_rx.protocols[protocolIdValid];
+
+            ggprintf("Decoded length = %d, protocol = '%s' (%d)\n", decodedLength, protocol.name, protocolIdValid);
+            ggprintf("Received sound data successfully: '%s'\n", m_rx.data.data());
+
+            m_rx.hasNewRxData = true;
+            m_rx.dataLength = decodedLength;
+            m_rx.protocol = protocol;
+            m_rx.protocolId = RxProtocolId(protocolIdValid);
+        }
+
+        // early stop - continue recording until the expected end of the next protocol with a valid header
+        int framesNext = 0;
+        if (isValid == false && m_rx.earlyStop) {
+            for (int protocolId = 0; protocolId < (int) m_rx.protocols.size(); ++protocolId) {
+                if (m_rx.framesEarly[protocolId] > m_rx.framesToRecord && (framesNext == 0 || m_rx.framesEarly[protocolId] < framesNext)) {
+                    framesNext = m_rx.framesEarly[protocolId];
+                }
+            }
+        }
+
+        if (framesNext > 0) {
+            ggprintf("Continue recording until frame %d\n", framesNext);
+
+            m_rx.framesLeftToRecord = framesNext - m_rx.framesToRecord;
+            m_rx.framesToRecord = framesNext;
+            m_rx.recvDuration_frames = framesNext;
+        } else {
+            m_rx.framesToRecord = 0;
+            m_rx.earlyStop = false;
+
+            m_rx.receiving = false;
+        }
+
+        if (isValid == false && framesNext == 0) {
+            ggprintf("Failed to capture sound data. Please try again (length = %d)\n", m_rx.data[0]);
+            m_rx.dataLength = -1;
+            m_rx.framesToRecord = -1;
+        }
+
+        m_rx.analyzing = false;
+
+        m_rx.spectrum.zero();
+
+        m_rx.framesToAnalyze = 0;
+        m_rx.framesLeftToAnalyze = 0;
+    }
+
+    // check if receiving data
+    if (m_rx.receiving == false) {
+        bool isReceiving = false;
+
+        for (int i = 0; i < m_rx.protocols.size(); ++i) {
+            const auto & protocol = m_rx.protocols[i];
+            if (protocol.enabled == false) {
+                continue;
+            }
+
+            if (m_rx.protocolBins[i].hasMarkers && countMarkerBits(i, false) == m_nBitsInMarker) {
+                m_rx.markerFreqStart = protocol.freqStart;
+                isReceiving = true;
+                break;
+            }
+        }
+
+        if (isReceiving) {
+            if (++m_rx.nMarkersSuccess >= 1) {
+            } else {
+                isReceiving = false;
+            }
+        } else {
+            m_rx.nMarkersSuccess = 0;
+        }
+
+        if (isReceiving) {
+            ggprintf("Receiving sound data ...\n");
+
+            m_rx.receiving = true;
+            m_rx.data.zero();
+
+            // max recieve duration
+            m_rx.recvDuration_frames = GG_MIN(m_rx.framesRecordedMax, maxDurationFrames(m_rx.protocols, kMaxLengthVariable, true));
+
+            m_rx.nMarkersSuccess = 0;
+            m_rx.framesToRecord = m_rx.recvDuration_frames;
+            m_rx.framesLeftToRecord = m_rx.recvDuration_frames;
+
+            // the length header of the slowest candidate protocol must be recorded for all analysis offsets
+            m_rx.earlyStop = false;
+            m_rx.framesToProbe = 0;
+            if (m_rxEarlyStop) {
+                for (int i = 0; i < m_rx.protocols.size(); ++i) {
+                    const auto & protocol = m_rx.protocols[i];
+                    if (protocol.enabled == false || protocol.extra == 2 || protocol.freqStart != m_rx.markerFreqStart) {
+                        continue;
+                    }
+
+                    const int nTx = (m_encodedDataOffset + protocol.bytesPerTx - 1)/protocol.bytesPerTx;
+                    m_rx.framesToProbe = GG_MAX(m_rx.framesToProbe, m_nMarkerFrames + nTx*protocol.framesPerTx);
+                }
+            }
+        }
+    } else {
+        bool isEnded = false;
+
+        for (int i = 0; i < m_rx.protocols.size(); ++i) {
+            const auto & protocol = m_rx.protocols[i];
+            if (protocol.enabled == false) {
+                continue;
+            }
+
+            if (m_rx.protocolBins[i].hasMarkers && countMarkerBits(i, true) == m_nBitsInMarker) {
+                isEnded = true;
+                break;
+            }
+        }
+
+        if (isEnded) {
+            if (++m_rx.nMarkersSuccess >= 1) {
+            } else {
+                isEnded = false;
+            }
+        } else {
+            m_rx.nMarkersSuccess = 0;
+        }
+
+        if (isEnded && m_rx.framesToRecord > 1) {
+            m_rx.recvDuration_frames -= m_rx.framesLeftToRecord - 1;
+            ggprintf("Received end marker. Frames left = %d, recorded = %d\n", m_rx.framesLeftToRecord, m_rx.recvDuration_frames);
+            m_rx.nMarkersSuccess = 0;
+            m_rx.framesLeftToRecord = 1;
+            m_rx.framesToProbe = 0;
+            m_rx.earlyStop = false;
+        }
+
+        // done after the marker detection, because the analysis overwrites the spectrum
+        if (m_rx.framesToProbe > 0 && m_rx.framesLeftToRecord > 1 &&
+            m_rx.framesToRecord - m_rx.framesLeftToRecord == m_rx.framesToProbe) {
+            analyzeLengthEarly();
+        }
+    }
+}
+
+void GGWave::analyzeLengthEarly() {
+    const AnalysisWork work = {
+        m_rx.fftOut, m_rx.fftWorkI, m_rx.fftWorkF, m_rx.fftWork, m_rx.spectrum, m_dataEncoded, m_rx.data, m_workRSLength, m_workRSData,
+    };
+
+    const int nOffsets = m_nMarkerFrames*kAnalysisStepsPerFrame;
+    const int nRecorded = m_rx.framesToRecord - m_rx.framesLeftToRecord;
+
+    int framesFirst = 0;
+    for (int protocolId = 0; protocolId < (int) m_rx.protocols.size(); ++protocolId) {
+        const auto & protocol = m_rx.protocols[protocolId];
+
+        m_rx.framesEarly[protocolId] = 0;
+
+        if (protocol.enabled == false || protocol.extra == 2 || protocol.freqStart != m_rx.markerFreqStart) {
+            continue;
+        }
+
+        // the header decodes at many neighbouring offsets of a real transmission - accept the length only
+        // if enough offsets agree on it, to avoid cutting the recording short because of a false positive
+        int votes[kMaxLengthVariable + 1] = { 0 };
+        int offsetLast[kMaxLengthVariable + 1] = { 0 };
+
+        int length = 0;
+        for (int ii = 0; ii < nOffsets; ++ii) {
+            const int decodedLength = analyzeLength(protocolId, ii, work);
+            if (decodedLength > 0) {
+                offsetLast[decodedLength] = ii;
+                if (++votes[decodedLength] > votes[length]) {
+                    length = decodedLength;
+                }
+            }
+        }
+
+        if (length == 0 || votes[length] < kMinLengthVotes) {
+            continue;
+        }
+
+        const int nTotalBytesExpected = m_encodedDataOffset + length + ::getECCBytesForLength(length);
+        const int nDataFrames = ((nTotalBytesExpected + protocol.bytesPerTx - 1)/protocol.bytesPerTx)*protocol.framesPerTx;
+
+        // the data of the latest offset must be recorded completely
+        int nFrames = (offsetLast[length] + kAnalysisStepsPerFrame - 1)/kAnalysisStepsPerFrame + nDataFrames + 1;
+        nFrames = GG_MAX(nRecorded + 1, GG_MIN(nFrames, m_rx.framesToRecord));
+
+        ggprintf("Decoded length header: length = %d, protocol = '%s', votes = %d, frames = %d\n",
+                 length, protocol.name, votes[length], nFrames);
+
+        m_rx.framesEarly[protocolId] = nFrames;
+        if (framesFirst == 0 || nFrames < framesFirst) {
+            framesFirst = nFrames;
+        }
+    }
+
+    m_rx.framesToProbe = 0;
+
+    if (framesFirst == 0) {
+        return;
+    }
+
+    // the frames are recorded at framesToRecord - framesLeftToRecord, so both must be updated
+    m_rx.earlyStop = true;
+    m_rx.framesLeftToRecord = framesFirst - nRecorded;
+    m_rx.framesToRecord = framesFirst;
+    m_rx.recvDuration_frames = framesFirst;
+}
+
+//
+// Fixed payload length
+
+void GGWave::updateEnergyBands() {
+    // one band for each unique frequency range of the enabled protocols. A variable-length transmission is detected
+    // by its start marker, which occupies only the first 2*m_nBitsInMarker bins of the range
+    int nBands = 0;
+    bool isChanged = false;
+
+    for (int i = 0; i < m_rx.protocols.size(); ++i) {
+        const auto & protocol = m_rx.protocols[i];
+        if (protocol.enabled == false) {
+            continue;
+        }
+
+        const int binStart = protocol.freqStart;
+        const int binEnd   = protocol.freqStart + (m_isFixedPayloadLength ? 32*protocol.bytesPerTx : 2*m_nBitsInMarker);
+        if (binEnd >= m_samplesPerFrame/2 || m_samplesPerFrame < kEnergyGateFraction*Rx::EnergyBand::kMaxBlockSize) {
+            continue;
+        }
+
+        bool isNew = true;
+        for (int j = 0; j < nBands; ++j) {
+            if (m_rx.energyBands[j].binStart == binStart && m_rx.energyBands[j].binEnd == binEnd) {
+                isNew = false;
+                break;
+            }
+        }
+
+        if (isNew == false) {
+            continue;
+        }
+
+        auto & band = m_rx.energyBands[nBands];
+        if (nBands >= m_rx.nEnergyBands || band.binStart != binStart || band.binEnd != binEnd) {
+            isChanged = true;
+
+            // the first null of the block sum is at sampleRate/blockSize from the center of the band. At the native
+            // rate, the frames are measured at the capture sample rate
+            const double sampleRate = m_rxNativeRate ? m_sampleRateInp : m_sampleRate;
+
+            const double f0 = m_hzPerSample*binStart;
+            const double f1 = m_hzPerSample*binEnd;
+            const double w0 = M_PI*(f0 + f1)/sampleRate;
+
+            band.binStart = binStart;
+            band.binEnd   = binEnd;
+
+            band.blockSize = 8;
+            while (band.blockSize < Rx::EnergyBand::kMaxBlockSize && band.blockSize*(f1 - f0) < sampleRate/2) {
+                band.blockSize *= 2;
+            }
+
+            for (int k = 0; k < band.blockSize; ++k) {
+                band.mixRe[k] = cos(w0*k);
+                band.mixIm[k] = sin(w0*k);
+            }
+
+            band.noiseFloor = 0.0f;
+        }
+
+        ++nBands;
+    }
+
+    if (isChanged || nBands != m_rx.nEnergyBands) {
+        m_rx.nEnergyBands = nBands;
+
+        // the noise floor of the new bands is not known yet
+        m_rx.isGateOpen = true;
+        m_rx.gateHangover = kEnergyGateHangover;
+    }
+}
+
+void GGWave::updateEnergyGate() {
+    updateEnergyBands();
+
+    // nothing to measure - keep the gate open
+    if (m_rx.nEnergyBands == 0) {
+        m_rx.isGateOpen = true;
+        return;
+    }
+
+    bool isActive = false;
+
+    for (int i = 0; i < m_rx.nEnergyBands; ++i) {
+        auto & band = m_rx.energyBands[i];
+
+        // only the end of the frame is used - the tones of a transmission last for several frames
+        const int blockSize = band.blockSize;
+        const int nBlocks   = (m_rx.frameSize/kEnergyGateFraction)/blockSize;
+
+        const float * x = m_rx.amplitude.data() + m_rx.frameSize - nBlocks*blockSize;
+
+        const float energy = ::simdKernels().blockEnergy(x, band.mixRe, band.mixIm, blockSize, nBlocks)/nBlocks;
+
+        if (band.noiseFloor == 0.0f) {
+            band.noiseFloor = GG_MAX(kEnergyGateMinFloor, energy);
+        }
+
+        if (energy > kEnergyGateThreshold*band.noiseFloor) {
+            isActive = true;
+        }
+
+        const float rate = m_rx.isGateOpen ? kEnergyGateRateOpen : kEnergyGateRate;
+        band.noiseFloor = GG_MAX(kEnergyGateMinFloor, band.noiseFloor + rate*(energy - band.noiseFloor));
+    }
+
+    if (isActive) {
+        m_rx.gateHangover = kEnergyGateHangover;
+    } else if (m_rx.gateHangover > 0) {
+        --m_rx.gateHangover;
+    }
+
+    m_rx.isGateOpen = isActive || m_rx.gateHangover > 0;
+}
+
+void GGWave::decode_fixed() {
+    m_rx.hasNewSpectrum = true;
+
+    const auto & simd = ::simdKernels();
+
+    const int nBins = m_samplesPerFrame/2;
+
+    // calculate spectrum
+    if (m_decimation > 1) {
+        updateBaseband(m_rx.fftOut.data());
+        FFTComplex(::fftBackend(m_fftRadix4), m_rx.fftOut.data(), m_samplesPerFrame/m_decimation, m_rx.fftWorkI.data(), m_rx.fftWorkF.data(), m_rx.fftWork.data());
+        basebandSpectrum(m_rx.fftOut.data(), m_rx.spectrum.data());
+    } else {
+        frameSpectrum(m_rx.amplitude.data(), m_rx.fftOut.data(), m_rx.spectrum.data(), m_rx.fftWorkI.data(), m_rx.fftWorkF.data(), m_rx.fftWork.data());
+    }
+
+    updateSpectrumFull();
+
+    const int amaxStart = GG_MAX(1, m_rx.minFreqStart);
+    float amax = simd.maxValue(m_rx.spectrum.data() + amaxStart, GG_MAX(0, nBins - amaxStart));
+
+    // original, floating-point version
+    //m_rx.spectrumHistoryFixed[m_rx.historyIdFixed].copy(m_rx.spectrum);
+
+    // float -> uint8_t
+    amax = 255.0f/(amax == 0.0f ? 1.0f : amax);
+    {
+        auto row = m_rx.spectrumHistoryFixed[m_rx.historyIdFixed];
+        simd.quantizeU8(m_rx.spectrum.data(), amax, row.data(), row.size());
+    }
+
+    // float -> uint16_t
+    //amax = 65535.0f/(amax == 0.0f ? 1.0f : amax);
+    //for (int i = 0; i < m_samplesPerFrame; ++i) {
+    //    m_rx.spectrumHistoryFixed[m_rx.historyIdFixed][i] = GG_MIN(65535.0f, GG_MAX(0.0f, (float) round(m_rx.spectrum[i]*amax)));
+    //}
+
+    if (++m_rx.historyIdFixed >= (int) m_rx.spectrumHistoryFixed.size()) {
+        m_rx.historyIdFixed = 0;
+    }
+
+    const int nHistory = m_rx.spectrumHistoryFixed.size();
+    const int historyIdLast = (m_rx.historyIdFixed + nHistory - 1) % nHistory;
+
+    // the votes are rebuilt from the spectrum history when the Rx protocols change
+    for (int protocolId = 0; protocolId < (int) m_rx.protocols.size(); ++protocolId) {
+        const auto & protocol = m_rx.protocols[protocolId];
+        const auto & votes    = m_rx.fixedVotes[protocolId];
+
+        if (protocol.enabled     != votes.enabled     ||
+            protocol.freqStart   != votes.freqStart   ||
+            protocol.framesPerTx != votes.framesPerTx ||
+            protocol.bytesPerTx  != votes.bytesPerTx  ||
+            protocol.extra       != votes.extra) {
+            m_rx.fixedVotesValid = false;
+        }
+    }
+
+    if (m_rx.fixedVotesValid) {
+        for (int protocolId = 0; protocolId < (int) m_rx.protocols.size(); ++protocolId) {
+            const auto & protocol = m_rx.protocols[protocolId];
+            if (protocol.enabled == false || isFixedProtocolSupported(protocol) == false) {
+                continue;
+            }
+
+            updateFixedVotes(protocolId, historyIdLast);
+        }
+    } else {
+        resetFixedVotes();
+    }
+
+    bool isValid = false;
+    for (int protocolId = 0; protocolId < (int) m_rx.protocols.size(); ++protocolId) {
+        const auto & protocol = m_rx.protocols[protocolId];
+        if (protocol.enabled == false) {
+            continue;
+        }
+
+        if (isFixedProtocolSupported(protocol) == false) {
+            continue;
+        }
+
+        const int totalLength = m_payloadLength + getECCBytesForLength(m_payloadLength);
+        if (m_rx.fixedVotes[protocolId].nDetected < 0.75*(2*totalLength)) {
+            continue;
+        }
+
+        // the tones of the Tx groups in the window - the last group ends at the newest frame
+        const int framesPerGroup = protocol.extra*protocol.framesPerTx;
+        const int nGroups = (totalLength + protocol.bytesPerTx - 1)/protocol.bytesPerTx;
+
+        m_rx.detectedBins.zero();
+        for (int g = 0; g < nGroups; ++g) {
+            const int historyId = historyIdLast - (nGroups - 1 - g)*framesPerGroup;
+
+            for (int j = 0; j < protocol.bytesPerTx && g*protocol.bytesPerTx + j < totalLength; ++j) {
+                for (int b = 0; b < 2; ++b) {
+                    const uint8_t tone = fixedTone(protocol, protocolId, historyId, j, b);
+                    if (tone != 0xFF) {
+                        m_rx.detectedBins[2*(g*protocol.bytesPerTx + j) + b] = tone;
+                    }
+                }
+            }
+        }
+
+        RS::ReedSolomon rsData(m_payloadLength, getECCBytesForLength(m_payloadLength), m_workRSData.data());
+
+        for (int j = 0; j < totalLength; ++j) {
+            m_dataEncoded[j] = (m_rx.detectedBins[2*j + 1] << 4) + m_rx.detectedBins[2*j + 0];
+        }
+
+        if (rsData.Decode(m_dataEncoded.data(), m_rx.data.data()) == 0) {
+            if (m_isDSSEnabled) {
+                for (int i = 0; i < m_payloadLength; ++i) {
+                    m_rx.data[i] = m_rx.data[i] ^ getDSSMagic(i);
+                }
+            }
+
+            ggprintf("Decoded length = %d, protocol = '%s' (%d)\n", m_payloadLength, protocol.name, protocolId);
+            ggprintf("Received sound data successfully: '%s'\n", m_rx.data.data());
+
+            isValid = true;
+            m_rx.hasNewRxData = true;
+            m_rx.dataLength = m_payloadLength;
+            m_rx.protocol = protocol;
+            m_rx.protocolId = RxProtocolId(protocolId);
+        }
+
+        if (isValid) {
+            break;
+        }
+    }
+}
+
+uint8_t GGWave::fixedTone(const Protocol & protocol, int protocolId, int historyId, int byteId, int nibbleId) {
+    const int nHistory = m_rx.spectrumHistoryFixed.size();
+
+    // with extra > 1, the low nibble is sent in the first Tx of the group and the high nibble in the last one,
+    // both on the strongest bin of the byte
+    const int slot = protocol.extra == 1 ? 2*byteId + nibbleId : byteId;
+    const int lag  = nibbleId == 0 ? (protocol.extra - 1)*protocol.framesPerTx : 0;
+
+    historyId -= lag;
+    while (historyId < 0) {
+        historyId += nHistory;
+    }
+
+    return m_rx.fixedTones[historyId*GGWAVE_PROTOCOL_COUNT + protocolId][slot];
+}
+
+bool GGWave::isFixedProtocolSupported(const Protocol & protocol) {
+    // protocols enabled after the preparation can be outside of the band of the history rows, or need more slots
+    // or a longer group of Txs than were allocated
+    const int width  = m_rx.spectrumHistoryFixed[0].size();
+    const int nSlots = protocol.extra == 1 ? 2*protocol.bytesPerTx : protocol.bytesPerTx;
+
+    return protocol.freqStart >= 0 &&
+        protocol.freqStart + (protocol.extra > 1 ? 32 : 16)*nSlots <= width &&
+        nSlots <= (int) m_rx.fixedBins[0].size() &&
+        protocol.extra*protocol.framesPerTx <= (int) m_rx.fixedPhaseSum[0].size();
+}
+
+void GGWave::updateFixedVotes(int protocolId, int historyId) {
+    const auto & simd = ::simdKernels();
+    const auto & protocol = m_rx.protocols[protocolId];
+
+    auto & votes = m_rx.fixedVotes[protocolId];
+
+    const int nHistory = m_rx.spectrumHistoryFixed.size();
+    const int nSlotsMax = m_rx.fixedBins[0].size();
+
+    const int totalLength    = m_payloadLength + getECCBytesForLength(m_payloadLength);
+    const int framesPerTx    = protocol.framesPerTx;
+    const int framesPerGroup = protocol.extra*framesPerTx;
+    const int nGroups        = (totalLength + protocol.bytesPerTx - 1)/protocol.bytesPerTx;
+    const int nSlots         = protocol.extra == 1 ? 2*protocol.bytesPerTx : protocol.bytesPerTx;
+
+    auto wrap = [&](int id) {
+        while (id < 0) {
+            id += nHistory;
+        }
+        return id;
+    };
+    auto row = [&](int id) {
+        return wrap(id)*GGWAVE_PROTOCOL_COUNT + protocolId;
+    };
+
+    // the strongest bin of each group of 16 bins - two groups per byte, or one if extra > 1
+    auto bins = m_rx.fixedBins[row(historyId)];
+    if (protocol.extra == 1) {
+        simd.argmax16U8(m_rx.spectrumHistoryFixed[historyId].data() + protocol.freqStart, 16, nSlots, bins.data());
+    } else {
+        simd.argmax16U8(m_rx.spectrumHistoryFixed[historyId].data() + protocol.freqStart, 32, nSlots, bins.data());
+    }
+
+    // add the votes of the new frame and retire the votes of the frame that is no longer part of the Tx
+    auto binsOld = m_rx.fixedBins[row(historyId - framesPerTx)];
+    auto tones   = m_rx.fixedTones[row(historyId)];
+    for (int i = 0; i < nSlots; ++i) {
+        auto counts = m_rx.fixedCounts[protocolId*nSlotsMax + i];
+
+        counts[bins[i]]++;
+        if (votes.nFrames >= framesPerTx) {
+            counts[binsOld[i]]--;
+        }
+
+        tones[i] = 0xFF;
+        for (int b = 0; b < 16; ++b) {
+            if (counts[b] > framesPerTx/2) {
+                tones[i] = b;
+            }
+        }
+    }
+
+    if (votes.nFrames < nHistory) {
+        ++votes.nFrames;
+    }
+
+    // tones detected in the group of Txs that ends with the new frame - all of them and only those that are
+    // part of the payload if this is the last group of the window
+    const int nBytesLast = totalLength - (nGroups - 1)*protocol.bytesPerTx;
+
+    int nDetectedFull = 0;
+    int nDetectedLast = 0;
+    for (int j = 0; j < protocol.bytesPerTx; ++j) {
+        for (int b = 0; b < 2; ++b) {
+            if (fixedTone(protocol, protocolId, historyId, j, b) != 0xFF) {
+                ++nDetectedFull;
+                if (j < nBytesLast) {
+                    ++nDetectedLast;
+                }
+            }
+        }
+    }
+
+    // the previous groups of the window end at the same phase as the new one, so their running sum is updated with
+    // the group that joins the window and the group that leaves it
+    const int idJoin  = wrap(historyId - framesPerGroup);
+    const int idLeave = wrap(historyId - nGroups*framesPerGroup);
+
+    auto & sum = m_rx.fixedPhaseSum[protocolId][votes.phase];
+    sum += m_rx.fixedDetected[idJoin][protocolId] - m_rx.fixedDetected[idLeave][protocolId];
+
+    m_rx.fixedDetected[historyId][protocolId] = nDetectedFull;
+
+    if (++votes.phase >= framesPerGroup) {
+        votes.phase = 0;
+    }
+
+    votes.nDetected = sum + nDetectedLast;
+}
+
+void GGWave::resetFixedVotes() {
+    const int nHistory = m_rx.spectrumHistoryFixed.size();
+
+    m_rx.fixedBins.zero();
+    m_rx.fixedTones.zero();
+    m_rx.fixedDetected.zero();
+    m_rx.fixedCounts.zero();
+    m_rx.fixedPhaseSum.zero();
+
+    for (int protocolId = 0; protocolId < (int) m_rx.protocols.size(); ++protocolId) {
+        const auto & protocol = m_rx.protocols[protocolId];
+        auto & votes = m_rx.fixedVotes[protocolId];
+
+        votes.enabled     = protocol.enabled;
+        votes.freqStart   = protocol.freqStart;
+        votes.framesPerTx = protocol.framesPerTx;
+        votes.bytesPerTx  = protocol.bytesPerTx;
+        votes.extra       = protocol.extra;
+
+        votes.phase     = 0;
+        votes.nFrames   = 0;
+        votes.nDetected = 0;
+
+        if (protocol.enabled == false || isFixedProtocolSupported(protocol) == false) {
+            continue;
+        }
+
+        // replay the whole history, from the oldest frame to the newest one
+        for (int i = 0; i < nHistory; ++i) {
+            updateFixedVotes(protocolId, (m_rx.historyIdFixed + i) % nHistory);
+        }
+    }
+
+    m_rx.fixedVotesValid = true;
+}
+
+int GGWave::maxFramesPerTx(const Protocols & protocols, bool excludeMT) const {
+    int res = 0;
+    for (int i = 0; i < protocols.size(); ++i) {
+        const auto & protocol = protocols[i];
+        if (protocol.enabled == false) {
+            continue;
+        }
+        if (excludeMT && protocol.extra > 1) {
+            continue;
+        }
+        res = GG_MAX(res, protocol.framesPerTx*protocol.extra);
+    }
+    return res;
+}
+
+int GGWave::durationFrames(const Protocol & protocol, int maxLength) const {
+    const int totalBytes = m_encodedDataOffset + maxLength + getECCBytesForLength(maxLength);
+
+    return 2*m_nMarkerFrames + protocol.extra*((totalBytes + protocol.bytesPerTx - 1)/protocol.bytesPerTx)*protocol.framesPerTx;
+}
+
+int GGWave::maxDurationFrames(const Protocols & protocols, int maxLength, bool excludeMT) const {
+    int res = 2*m_nMarkerFrames;
+    for (int i = 0; i < protocols.size(); ++i) {
+        const auto & protocol = protocols[i];
+        if (protocol.enabled == false) {
+            continue;
+        }
+        if (excludeMT && protocol.extra > 1) {
+            continue;
+        }
+        res = GG_MAX(res, durationFrames(protocol, maxLength));
+    }
+    return res;
+}
+
+int GGWave::minBytesPerTx(const Protocols & protocols) const {
+    int res = 1;
+    for (int i = 0; i < protocols.size(); ++i) {
+        const auto & protocol = protocols[i];
+        if (protocol.enabled == false) {
+            continue;
+        }
+        res = GG_MIN(res, (int) protocol.bytesPerTx);
+    }
+    return res;
+}
+
+int GGWave::maxBytesPerTx(const Protocols & protocols) const {
+    int res = 1;
+    for (int i = 0; i < protocols.size(); ++i) {
+        const auto & protocol = protocols[i];
+        if (protocol.enabled == false) {
+            continue;
+        }
+        res = GG_MAX(res, (int) protocol.bytesPerTx);
+    }
+    return res;
 }
 
 int GGWave::maxTonesPerTx(const Protocols & protocols) const {
@@ -2112,3 +4404,428 @@ int GGWave::minFreqStart(const Protocols & protocols) const {
 double GGWave::bitFreq(const Protocol & p, int bit) const {
     return m_hzPerSample*p.freqStart + m_freqDelta_hz*bit;
 }
+
+//
+// GGWave::AsyncDecoder
+//
+
+#ifdef GGWAVE_CONFIG_THREADS
+
+struct GGWave::AsyncDecoder::Impl {
+    struct Result {
+        int dataSize = 0;
+        RxProtocolId protocolId = GGWAVE_PROTOCOL_COUNT;
+        uint8_t data[kMaxDataSize];
+    };
+
+    void loop();
+
+    GGWave instance;
+
+    Callback callback = nullptr;
+    void * userData = nullptr;
+
+    // capture ring buffer - head is advanced by push(), tail by the background thread
+    uint8_t * ring = nullptr;
+    uint32_t ringSize = 0;
+
+    std::atomic<uint64_t> ringHead { 0 };
+    std::atomic<uint64_t> ringTail { 0 };
+    std::atomic<uint64_t> nDroppedBytes { 0 };
+
+    // result queue - head is advanced by the background thread, tail by takeData()
+    Result results[kMaxResults];
+
+    std::atomic<uint32_t> resultHead { 0 };
+    std::atomic<uint32_t> resultTail { 0 };
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cvData;
+    std::condition_variable cvDecoded;
+
+    std::atomic<bool> stop { false };
+};
+
+void GGWave::AsyncDecoder::Impl::loop() {
+    const uint32_t nBytesPerFrame = instance.samplesPerFrame()*instance.sampleSizeInp();
+
+    while (stop == false) {
+        const uint64_t tail = ringTail.load(std::memory_order_relaxed);
+        const uint64_t head = ringHead.load(std::memory_order_acquire);
+
+        if (head == tail) {
+            // push() notifies under the mutex, so the new samples cannot be missed between the check and the wait
+            std::unique_lock<std::mutex> lock(mutex);
+            cvData.wait(lock, [&]() {
+                return stop || ringHead.load(std::memory_order_acquire) != ringTail.load(std::memory_order_relaxed);
+            });
+            continue;
+        }
+
+        // decode at most one frame at a time so that a single decode() call cannot produce more than one payload
+        const uint32_t offset = tail % ringSize;
+        const uint32_t nBytes = GG_MIN(GG_MIN(head - tail, (uint64_t) nBytesPerFrame), (uint64_t) (ringSize - offset));
+
+        instance.decode(ring + offset, nBytes);
+
+        TxRxData data;
+        const int dataSize = instance.rxTakeData(data);
+        if (dataSize > 0) {
+            if (callback) {
+                callback(data.data(), dataSize, instance.rxProtocolId(), userData);
+            }
+
+            const uint32_t rhead = resultHead.load(std::memory_order_relaxed);
+            if (rhead - resultTail.load(std::memory_order_acquire) < (uint32_t) kMaxResults) {
+                auto & result = results[rhead % kMaxResults];
+                result.dataSize = dataSize;
+                result.protocolId = instance.rxProtocolId();
+                memcpy(result.data, data.data(), dataSize);
+
+                resultHead.store(rhead + 1, std::memory_order_release);
+            } else {
+                ggprintf("Async decoder result queue is full - dropping decoded data\n");
+            }
+        }
+
+        ringTail.store(tail + nBytes, std::memory_order_release);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+        }
+        cvDecoded.notify_all();
+    }
+}
+
+GGWave::AsyncDecoder::AsyncDecoder(const Parameters & parameters, int ringSize_frames, Callback callback, void * userData) {
+    m_impl = new Impl();
+
+    if (m_impl->instance.prepare(parameters) == false) {
+        ggprintf("Failed to prepare the async decoder instance\n");
+        return;
+    }
+
+    if (ringSize_frames <= 0) {
+        ggprintf("Invalid async decoder ring size: %d\n", ringSize_frames);
+        return;
+    }
+
+    m_impl->callback = callback;
+    m_impl->userData = userData;
+
+    m_impl->ringSize = ringSize_frames*m_impl->instance.samplesPerFrame()*m_impl->instance.sampleSizeInp();
+    m_impl->ring = (uint8_t *) malloc(m_impl->ringSize);
+    if (m_impl->ring == nullptr) {
+        ggprintf("Failed to allocate the async decoder ring buffer: %d bytes\n", (int) m_impl->ringSize);
+        return;
+    }
+
+    m_impl->thread = std::thread([this]() { m_impl->loop(); });
+}
+
+GGWave::AsyncDecoder::~AsyncDecoder() {
+    if (m_impl->thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_impl->mutex);
+            m_impl->stop = true;
+        }
+        m_impl->cvData.notify_one();
+        m_impl->thread.join();
+    }
+
+    free(m_impl->ring);
+
+    delete m_impl;
+}
+
+bool GGWave::AsyncDecoder::isValid() const {
+    return m_impl->thread.joinable();
+}
+
+uint32_t GGWave::AsyncDecoder::push(const void * data, uint32_t nBytes) {
+    if (isValid() == false) {
+        return 0;
+    }
+
+    const uint32_t sampleSize = m_impl->instance.sampleSizeInp();
+
+    const uint64_t head = m_impl->ringHead.load(std::memory_order_relaxed);
+    const uint64_t tail = m_impl->ringTail.load(std::memory_order_acquire);
+
+    // accept only whole samples
+    uint32_t nAccepted = GG_MIN((uint64_t) nBytes, m_impl->ringSize - (head - tail));
+    nAccepted -= nAccepted % sampleSize;
+
+    const uint32_t offset = head % m_impl->ringSize;
+    const uint32_t n0 = GG_MIN(nAccepted, m_impl->ringSize - offset);
+
+    memcpy(m_impl->ring + offset, data, n0);
+    memcpy(m_impl->ring, (const uint8_t *) data + n0, nAccepted - n0);
+
+    m_impl->ringHead.store(head + nAccepted, std::memory_order_release);
+
+    if (nAccepted < nBytes) {
+        m_impl->nDroppedBytes += nBytes - nAccepted;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_impl->mutex);
+    }
+    m_impl->cvData.notify_one();
+
+    return nAccepted;
+}
+
+int GGWave::AsyncDecoder::takeData(void * dst, int dstSize, RxProtocolId & protocolId) {
+    const uint32_t tail = m_impl->resultTail.load(std::memory_order_relaxed);
+    const uint32_t head = m_impl->resultHead.load(std::memory_order_acquire);
+
+    if (head == tail) {
+        return 0;
+    }
+
+    const auto & result = m_impl->results[tail % kMaxResults];
+    if (result.dataSize > dstSize) {
+        return -1;
+    }
+
+    memcpy(dst, result.data, result.dataSize);
+    protocolId = result.protocolId;
+
+    m_impl->resultTail.store(tail + 1, std::memory_order_release);
+
+    return result.dataSize;
+}
+
+void GGWave::AsyncDecoder::flush() {
+    if (isValid() == false) {
+        return;
+    }
+
+    const uint64_t head = m_impl->ringHead.load(std::memory_order_acquire);
+
+    std::unique_lock<std::mutex> lock(m_impl->mutex);
+    m_impl->cvDecoded.wait(lock, [&]() { return m_impl->ringTail.load(std::memory_order_acquire) >= head; });
+}
+
+uint64_t GGWave::AsyncDecoder::nDroppedBytes() const {
+    return m_impl->nDroppedBytes;
+}
+
+#else
+
+struct GGWave::AsyncDecoder::Impl {
+};
+
+GGWave::AsyncDecoder::AsyncDecoder(const Parameters & , int , Callback , void * ) {
+    ggprintf("Async decoding requires thread support\n");
+}
+
+GGWave::AsyncDecoder::~AsyncDecoder() {
+}
+
+bool GGWave::AsyncDecoder::isValid() const {
+    return false;
+}
+
+uint32_t GGWave::AsyncDecoder::push(const void * , uint32_t ) {
+    return 0;
+}
+
+int GGWave::AsyncDecoder::takeData(void * , int , RxProtocolId & ) {
+    return 0;
+}
+
+void GGWave::AsyncDecoder::flush() {
+}
+
+uint64_t GGWave::AsyncDecoder::nDroppedBytes() const {
+    return 0;
+}
+
+#endif
+
+//
+// GGWave::MultiDecoder
+//
+
+struct GGWave::MultiDecoder::Impl {
+    struct Result {
+        int channel = 0;
+        int dataSize = 0;
+        RxProtocolId protocolId = GGWAVE_PROTOCOL_COUNT;
+        uint8_t data[kMaxDataSize];
+    };
+
+    int nChannels = 0;
+
+    GGWave * instances = nullptr;
+
+    // the captured samples of each channel, one frame at the capture sample rate at a time
+    uint8_t * channelData = nullptr;
+    uint32_t  channelSize = 0;
+
+    // result queue
+    Result   results[kMaxResults];
+    uint32_t resultHead = 0;
+    uint32_t resultTail = 0;
+};
+
+template <typename T>
+inline void deinterleave(const void * src, int nChannels, int n, uint8_t * dst, uint32_t dstStride) {
+    auto s = (const T *) src;
+    for (int c = 0; c < nChannels; ++c) {
+        auto d = (T *) (dst + c*dstStride);
+        for (int i = 0; i < n; ++i) {
+            d[i] = s[i*nChannels + c];
+        }
+    }
+}
+
+GGWave::MultiDecoder::MultiDecoder(const Parameters & parameters, int nChannels) {
+    m_impl = new Impl();
+
+    if (nChannels <= 0 || nChannels > kMaxChannels) {
+        ggprintf("Invalid number of channels: %d, max: %d\n", nChannels, kMaxChannels);
+        return;
+    }
+
+    auto parametersRx = parameters;
+    parametersRx.operatingMode = (parameters.operatingMode & ~GGWAVE_OPERATING_MODE_TX) | GGWAVE_OPERATING_MODE_RX;
+
+    m_impl->instances = new GGWave[nChannels];
+
+    for (int c = 0; c < nChannels; ++c) {
+        if (m_impl->instances[c].prepare(parametersRx) == false) {
+            ggprintf("Failed to prepare the instance of channel %d\n", c);
+            return;
+        }
+    }
+
+    // a frame at the capture sample rate - a longer chunk could complete several frames of a channel
+    const auto & instance = m_impl->instances[0];
+    const int samplesPerFrameInp = GG_MAX(1, int(instance.m_samplesPerFrame*instance.m_sampleRateInp/instance.m_sampleRate));
+
+    m_impl->channelSize = samplesPerFrameInp*instance.sampleSizeInp();
+    m_impl->channelData = (uint8_t *) malloc(nChannels*m_impl->channelSize);
+    if (m_impl->channelData == nullptr) {
+        ggprintf("Failed to allocate the channel buffers: %d bytes\n", (int) (nChannels*m_impl->channelSize));
+        return;
+    }
+
+    m_impl->nChannels = nChannels;
+}
+
+GGWave::MultiDecoder::~MultiDecoder() {
+    free(m_impl->channelData);
+
+    delete [] m_impl->instances;
+
+    delete m_impl;
+}
+
+bool GGWave::MultiDecoder::isValid() const {
+    return m_impl->nChannels > 0;
+}
+
+int GGWave::MultiDecoder::nChannels() const {
+    return m_impl->nChannels;
+}
+
+int GGWave::MultiDecoder::heapSize() const {
+    int heapSize = 0;
+    for (int c = 0; c < m_impl->nChannels; ++c) {
+        heapSize += m_impl->instances[c].heapSize();
+    }
+
+    return heapSize;
+}
+
+const GGWave & GGWave::MultiDecoder::instance(int channel) const {
+    return m_impl->instances[channel];
+}
+
+bool GGWave::MultiDecoder::decode(const void * data, uint32_t nBytes) {
+    if (isValid() == false) {
+        return false;
+    }
+
+    auto & impl = *m_impl;
+
+    const int sampleSize = impl.instances[0].sampleSizeInp();
+    const int nChannels  = impl.nChannels;
+
+    if (nBytes % (nChannels*sampleSize) != 0) {
+        ggprintf("Provided bytes (%d) are not multiple of the size of a multi-channel sample (%d)\n",
+                 nBytes, nChannels*sampleSize);
+        return false;
+    }
+
+    const int nSamples = nBytes/(nChannels*sampleSize);
+    const int nChunk   = impl.channelSize/sampleSize;
+
+    auto src = (const uint8_t *) data;
+
+    // at most one frame at a time, so that a single decode() call of a channel cannot produce more than one payload
+    for (int offset = 0; offset < nSamples; offset += nChunk) {
+        const int n = GG_MIN(nChunk, nSamples - offset);
+
+        switch (sampleSize) {
+            case 1: deinterleave<uint8_t> (src, nChannels, n, impl.channelData, impl.channelSize); break;
+            case 2: deinterleave<uint16_t>(src, nChannels, n, impl.channelData, impl.channelSize); break;
+            case 4: deinterleave<uint32_t>(src, nChannels, n, impl.channelData, impl.channelSize); break;
+            default:
+                ggprintf("Unsupported sample size: %d\n", sampleSize);
+                return false;
+        }
+
+        src += n*nChannels*sampleSize;
+
+        for (int c = 0; c < nChannels; ++c) {
+            auto & instance = impl.instances[c];
+
+            instance.decode(impl.channelData + c*impl.channelSize, n*sampleSize);
+
+            TxRxData result;
+            const int dataSize = instance.rxTakeData(result);
+            if (dataSize <= 0) {
+                continue;
+            }
+
+            if (impl.resultHead - impl.resultTail >= (uint32_t) kMaxResults) {
+                ggprintf("Multi-channel decoder result queue is full - dropping decoded data\n");
+                continue;
+            }
+
+            auto & dst = impl.results[impl.resultHead % kMaxResults];
+            dst.channel    = c;
+            dst.dataSize   = dataSize;
+            dst.protocolId = instance.rxProtocolId();
+            memcpy(dst.data, result.data(), dataSize);
+
+            ++impl.resultHead;
+        }
+    }
+
+    return true;
+}
+
+int GGWave::MultiDecoder::takeData(void * dst, int dstSize, int & channel, RxProtocolId & protocolId) {
+    if (m_impl->resultHead == m_impl->resultTail) {
+        return 0;
+    }
+
+    const auto & result = m_impl->results[m_impl->resultTail % kMaxResults];
+    if (result.dataSize > dstSize) {
+        return -1;
+    }
+
+    memcpy(dst, result.data, result.dataSize);
+    channel    = result.channel;
+    protocolId = result.protocolId;
+
+    ++m_impl->resultTail;
+
+    return result.dataSize;
+}
@@ -0,0 +1,1987 @@
+#pragma once
+
+/*
+
+Vectorised kernels for the hot per-sample loops of ggwave
+
+Each kernel has a portable scalar implementation, which is the reference, and optional SSE2, AVX2 and NEON
+implementations that produce bit-identical results. The implementation is selected at runtime:
+
+    - SSE2 / NEON are used when the compiler targets them (x86-64 and AArch64 always do)
+    - AVX2 is compiled via the GCC/Clang target attribute and used only if the CPU supports it
+
+Conversions from float saturate to the range of the output format and truncate towards zero.
+The power spectrum kernels may differ from the scalar ones in the last bit where the compiler fuses the
+scalar multiply-add, and so may the FFT and Goertzel kernels. The dot product, block energy and FIR kernels sum in a
+different order and agree only up to rounding.
+
+*/
+
+#include "ggwave/ggwave.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && !defined(__EMSCRIPTEN__)
+#define GGWAVE_SIMD_AVX2
+#include <immintrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GGWAVE_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define GGWAVE_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+enum SimdIsa {
+    kSimdScalar = 0,
+    kSimdSSE2,
+    kSimdAVX2,
+    kSimdNEON,
+    kSimdCount,
+};
+
+using ConvertToF32   = void (*)(const void * src, float * dst, int n);
+using ConvertFromF32 = void (*)(const float * src, void * dst, int n);
+
+struct SimdKernels {
+    const char * name;
+
+    // floats per vector register
+    int lanes;
+
+    // indexed by ggwave_SampleFormat
+    ConvertToF32   toF32[GGWAVE_SAMPLE_FORMAT_F32 + 1];
+    ConvertFromF32 fromF32[GGWAVE_SAMPLE_FORMAT_F32 + 1];
+
+    // dst[i] = re^2 + im^2 of the n interleaved complex values in src
+    void (*powerSpectrum)(const float * src, float * dst, int n);
+
+    // maximum of src[0, n), 0 if n == 0
+    float (*maxValue)(const float * src, int n);
+
+    // dst[i] = src[i]*scale rounded half up and saturated to [0, 255]
+    void (*quantizeU8)(const float * src, float scale, uint8_t * dst, int n);
+
+    // dst[k] = index of the last maximum in src[k*stride, k*stride + 16) for k in [0, n)
+    void (*argmax16U8)(const uint8_t * src, int stride, int n, uint8_t * dst);
+
+    // sum of a[i]*b[i] over [0, n)
+    float (*dot)(const float * a, const float * b, int n);
+
+    // sum over the nBlocks consecutive blocks of src of the squared magnitude of the complex dot product of the
+    // block with (re, im) - blockSize must be a multiple of 8
+    float (*blockEnergy)(const float * src, const float * re, const float * im, int blockSize, int nBlocks);
+
+    // decimating FIR filter with complex taps: dst[2*m + 0] and dst[2*m + 1] are the dot products of
+    // src[m*decimation, m*decimation + nTaps) with re and im for m in [0, n) - nTaps must be a multiple of 8
+    void (*firDecimate)(const float * src, const float * re, const float * im, int nTaps, int decimation, float * dst, int n);
+
+    // re[i] = src[2*i + 0] and im[i] = src[2*i + 1] for i in [0, n)
+    void (*deinterleave)(const float * src, float * re, float * im, int n);
+
+    // the stages of the FFT of the n complex values (re, im) - see fftComplex() below
+    void (*fftRadix2)(float * re, float * im, const float * tw, int n);
+    void (*fftRadix4)(float * re, float * im, const float * tw, int L, int n);
+
+    // the FFT of N real values from the FFT (zr, zi) of the N/2 complex values formed by their pairs - see fftReal() below
+    void (*fftRealPost)(const float * zr, const float * zi, const float * tw, float * dst, int N);
+
+    // DFT of src[0, n) at the frequencies w[k] with cos(w[k]) = cs[k] and sin(w[k]) = sn[k] for k in [0, nBins),
+    // by the Goertzel recurrence - see goertzel_scalar() below
+    void (*goertzel)(const float * src, int n, const float * cs, const float * sn, float * dst, int nBins);
+};
+
+//
+// Scalar
+//
+
+template <typename T>
+inline T loadUnaligned(const void * p) {
+    T v;
+    memcpy(&v, p, sizeof(T));
+    return v;
+}
+
+template <typename T>
+inline void storeUnaligned(void * p, T v) {
+    memcpy(p, &v, sizeof(T));
+}
+
+// clamp such that NaN maps to lo, same as max/min in SSE
+inline float clampf(float v, float lo, float hi) {
+    v = v > lo ? v : lo;
+    v = v < hi ? v : hi;
+    return v;
+}
+
+void toF32_U8_scalar(const void * src, float * dst, int n) {
+    constexpr float scale = 1.0f/128;
+    auto p = reinterpret_cast<const uint8_t *>(src);
+    for (int i = 0; i < n; ++i) {
+        dst[i] = float(int16_t(p[i]) - 128)*scale;
+    }
+}
+
+void toF32_I8_scalar(const void * src, float * dst, int n) {
+    constexpr float scale = 1.0f/128;
+    auto p = reinterpret_cast<const int8_t *>(src);
+    for (int i = 0; i < n; ++i) {
+        dst[i] = float(p[i])*scale;
+    }
+}
+
+void toF32_U16_scalar(const void * src, float * dst, int n) {
+    constexpr float scale = 1.0f/32768;
+    auto p = reinterpret_cast<const uint8_t *>(src);
+    for (int i = 0; i < n; ++i) {
+        dst[i] = float(int32_t(loadUnaligned<uint16_t>(p + 2*i)) - 32768)*scale;
+    }
+}
+
+void toF32_I16_scalar(const void * src, float * dst, int n) {
+    constexpr float scale = 1.0f/32768;
+    auto p = reinterpret_cast<const uint8_t *>(src);
+    for (int i = 0; i < n; ++i) {
+        dst[i] = float(loadUnaligned<int16_t>(p + 2*i))*scale;
+    }
+}
+
+void toF32_F32(const void * src, float * dst, int n) {
+    memcpy(dst, src, n*sizeof(float));
+}
+
+void fromF32_U8_scalar(const float * src, void * dst, int n) {
+    auto p = reinterpret_cast<uint8_t *>(dst);
+    for (int i = 0; i < n; ++i) {
+        p[i] = uint8_t(int32_t(clampf(128*(src[i] + 1.0f), 0.0f, 255.0f)));
+    }
+}
+
+void fromF32_I8_scalar(const float * src, void * dst, int n) {
+    auto p = reinterpret_cast<int8_t *>(dst);
+    for (int i = 0; i < n; ++i) {
+        p[i] = int8_t(int32_t(clampf(128*src[i], -128.0f, 127.0f)));
+    }
+}
+
+void fromF32_U16_scalar(const float * src, void * dst, int n) {
+    auto p = reinterpret_cast<uint8_t *>(dst);
+    for (int i = 0; i < n; ++i) {
+        storeUnaligned<uint16_t>(p + 2*i, uint16_t(int32_t(clampf(32768*(src[i] + 1.0f), 0.0f, 65535.0f))));
+    }
+}
+
+void fromF32_I16_scalar(const float * src, void * dst, int n) {
+    auto p = reinterpret_cast<uint8_t *>(dst);
+    for (int i = 0; i < n; ++i) {
+        storeUnaligned<int16_t>(p + 2*i, int16_t(int32_t(clampf(32768*src[i], -32768.0f, 32767.0f))));
+    }
+}
+
+void fromF32_F32(const float * src, void * dst, int n) {
+    memcpy(dst, src, n*sizeof(float));
+}
+
+void powerSpectrum_scalar(const float * src, float * dst, int n) {
+    for (int i = 0; i < n; ++i) {
+        dst[i] = src[2*i + 0]*src[2*i + 0] + src[2*i + 1]*src[2*i + 1];
+    }
+}
+
+float maxValue_scalar(const float * src, int n) {
+    float res = 0.0f;
+    for (int i = 0; i < n; ++i) {
+        res = src[i] > res ? src[i] : res;
+    }
+    return res;
+}
+
+void quantizeU8_scalar(const float * src, float scale, uint8_t * dst, int n) {
+    for (int i = 0; i < n; ++i) {
+        dst[i] = uint8_t(int32_t(clampf(src[i]*scale + 0.5f, 0.0f, 255.0f)));
+    }
+}
+
+void argmax16U8_scalar(const uint8_t * src, int stride, int n, uint8_t * dst) {
+    for (int k = 0; k < n; ++k, src += stride) {
+        int res = 0;
+        for (int i = 1; i < 16; ++i) {
+            if (src[res] <= src[i]) {
+                res = i;
+            }
+        }
+        dst[k] = res;
+    }
+}
+
+float dot_scalar(const float * a, const float * b, int n) {
+    float res = 0.0f;
+    for (int i = 0; i < n; ++i) {
+        res += a[i]*b[i];
+    }
+    return res;
+}
+
+float blockEnergy_scalar(const float * src, const float * re, const float * im, int blockSize, int nBlocks) {
+    float res = 0.0f;
+    for (int b = 0; b < nBlocks; ++b, src += blockSize) {
+        float sumRe = 0.0f;
+        float sumIm = 0.0f;
+        for (int i = 0; i < blockSize; ++i) {
+            sumRe += src[i]*re[i];
+            sumIm += src[i]*im[i];
+        }
+        res += sumRe*sumRe + sumIm*sumIm;
+    }
+    return res;
+}
+
+void firDecimate_scalar(const float * src, const float * re, const float * im, int nTaps, int decimation, float * dst, int n) {
+    for (int m = 0; m < n; ++m, src += decimation) {
+        float sumRe = 0.0f;
+        float sumIm = 0.0f;
+        for (int k = 0; k < nTaps; ++k) {
+            sumRe += src[k]*re[k];
+            sumIm += src[k]*im[k];
+        }
+        dst[2*m + 0] = sumRe;
+        dst[2*m + 1] = sumIm;
+    }
+}
+
+void deinterleave_scalar(const float * src, float * re, float * im, int n) {
+    for (int i = 0; i < n; ++i) {
+        re[i] = src[2*i + 0];
+        im[i] = src[2*i + 1];
+    }
+}
+
+// decimation-in-frequency radix-2 stage of length n: the second half is multiplied by w^j with w = exp(-2*pi*i/n),
+// which tw holds for j in [0, n/2) as the real parts followed by the imaginary parts
+void fftRadix2_scalar(float * re, float * im, const float * tw, int n) {
+    const int h = n/2;
+    for (int j = 0; j < h; ++j) {
+        const float dr = re[j] - re[j + h];
+        const float di = im[j] - im[j + h];
+        re[j] += re[j + h];
+        im[j] += im[j + h];
+        re[j + h] = dr*tw[j] - di*tw[h + j];
+        im[j + h] = dr*tw[h + j] + di*tw[j];
+    }
+}
+
+// decimation-in-frequency radix-4 butterfly of the values j, j + q, j + 2q and j + 3q of a stage of length L = 4q
+//   the outputs are multiplied by w^j, w^2j and w^3j with w = exp(-2*pi*i/L), which tw holds for j in [0, q)
+//   as 6 arrays of q values: the real and imaginary parts of w^j, then of w^2j, then of w^3j
+inline void fftButterfly4_scalar(float * xr, float * xi, const float * tw, int j, int q) {
+    const float t0r = xr[j + 0*q] + xr[j + 2*q], t0i = xi[j + 0*q] + xi[j + 2*q];
+    const float t1r = xr[j + 0*q] - xr[j + 2*q], t1i = xi[j + 0*q] - xi[j + 2*q];
+    const float t2r = xr[j + 1*q] + xr[j + 3*q], t2i = xi[j + 1*q] + xi[j + 3*q];
+    const float t3r = xr[j + 1*q] - xr[j + 3*q], t3i = xi[j + 1*q] - xi[j + 3*q];
+
+    const float y1r = t1r + t3i, y1i = t1i - t3r;
+    const float y2r = t0r - t2r, y2i = t0i - t2i;
+    const float y3r = t1r - t3i, y3i = t1i + t3r;
+
+    xr[j] = t0r + t2r;
+    xi[j] = t0i + t2i;
+
+    xr[j + 1*q] = y1r*tw[0*q + j] - y1i*tw[1*q + j];
+    xi[j + 1*q] = y1r*tw[1*q + j] + y1i*tw[0*q + j];
+    xr[j + 2*q] = y2r*tw[2*q + j] - y2i*tw[3*q + j];
+    xi[j + 2*q] = y2r*tw[3*q + j] + y2i*tw[2*q + j];
+    xr[j + 3*q] = y3r*tw[4*q + j] - y3i*tw[5*q + j];
+    xi[j + 3*q] = y3r*tw[5*q + j] + y3i*tw[4*q + j];
+}
+
+// radix-4 stage of length L applied to each of the n/L blocks of (re, im)
+void fftRadix4_scalar(float * re, float * im, const float * tw, int L, int n) {
+    const int q = L/4;
+    for (int b = 0; b < n; b += L) {
+        for (int j = 0; j < q; ++j) {
+            fftButterfly4_scalar(re + b, im + b, tw, j, q);
+        }
+    }
+}
+
+// bins [k0, k1) and their mirrors of the real FFT - tw holds cos(2*pi*k/N) and sin(2*pi*k/N) for k in [0, N/4):
+//   X[k] = E[k] + w^k*O[k] and X[M - k] = conj(E[k] - w^k*O[k]) with M = N/2, w = exp(-2*pi*i/N) and
+//   E[k], O[k] the spectra of the even and odd values, split from Z[k] and conj(Z[M - k])
+inline void fftRealPostRange_scalar(const float * zr, const float * zi, const float * tw, float * dst, int N, int k0, int k1) {
+    const int M = N/2;
+    for (int k = k0; k < k1; ++k) {
+        const float er = 0.5f*(zr[k] + zr[M - k]);
+        const float ei = 0.5f*(zi[k] - zi[M - k]);
+        const float or_ = 0.5f*(zi[k] + zi[M - k]);
+        const float oi = 0.5f*(zr[M - k] - zr[k]);
+
+        const float tr = tw[k]*or_ + tw[M/2 + k]*oi;
+        const float ti = tw[k]*oi - tw[M/2 + k]*or_;
+
+        dst[2*k + 0] = er + tr;
+        dst[2*k + 1] = -(ei + ti);
+        dst[2*(M - k) + 0] = er - tr;
+        dst[2*(M - k) + 1] = ei - ti;
+    }
+}
+
+// the bins of the real FFT that do not pair with a mirror
+inline void fftRealPostEdges(const float * zr, const float * zi, float * dst, int N) {
+    const int M = N/2;
+
+    dst[0] = zr[0] + zi[0];
+    dst[1] = zr[0] - zi[0];
+    if (M > 1) {
+        dst[M + 0] = zr[M/2];
+        dst[M + 1] = zi[M/2];
+    }
+}
+
+void fftRealPost_scalar(const float * zr, const float * zi, const float * tw, float * dst, int N) {
+    fftRealPostEdges(zr, zi, dst, N);
+    fftRealPostRange_scalar(zr, zi, tw, dst, N, 1, N/4);
+}
+
+// s[i] = src[i] + 2*cos(w)*s[i - 1] - s[i - 2], after which X(w) = exp(i*w)*s[n - 1] - s[n - 2] when w*n is a multiple
+// of 2*pi. The result is in the convention of the real FFT: dst[2*k + 0] = sum_i src[i]*cos(w[k]*i) and
+// dst[2*k + 1] = sum_i src[i]*sin(w[k]*i)
+void goertzel_scalar(const float * src, int n, const float * cs, const float * sn, float * dst, int nBins) {
+    for (int k = 0; k < nBins; ++k) {
+        const float c = cs[k] + cs[k];
+
+        float s1 = 0.0f;
+        float s2 = 0.0f;
+        for (int i = 0; i < n; ++i) {
+            const float s0 = (src[i] - s2) + c*s1;
+            s2 = s1;
+            s1 = s0;
+        }
+
+        dst[2*k + 0] = cs[k]*s1 - s2;
+        dst[2*k + 1] = -(sn[k]*s1);
+    }
+}
+
+const SimdKernels kSimdKernelsScalar = {
+    "scalar",
+    1,
+    { nullptr, toF32_U8_scalar,   toF32_I8_scalar,   toF32_U16_scalar,   toF32_I16_scalar,   toF32_F32   },
+    { nullptr, fromF32_U8_scalar, fromF32_I8_scalar, fromF32_U16_scalar, fromF32_I16_scalar, fromF32_F32 },
+    powerSpectrum_scalar,
+    maxValue_scalar,
+    quantizeU8_scalar,
+    argmax16U8_scalar,
+    dot_scalar,
+    blockEnergy_scalar,
+    firDecimate_scalar,
+    deinterleave_scalar,
+    fftRadix2_scalar,
+    fftRadix4_scalar,
+    fftRealPost_scalar,
+    goertzel_scalar,
+};
+
+//
+// SSE2
+//
+
+#ifdef GGWAVE_SIMD_SSE2
+
+void toF32_U8_sse2(const void * src, float * dst, int n) {
+    auto p = reinterpret_cast<const uint8_t *>(src);
+    const __m128i zero  = _mm_setzero_si128();
+    const __m128i bias  = _mm_set1_epi32(128);
+    const __m128  scale = _mm_set1_ps(1.0f/128);
+
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i v  = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+        const __m128i lo = _mm_unpacklo_epi8(v, zero);
+        const __m128i hi = _mm_unpackhi_epi8(v, zero);
+        _mm_storeu_ps(dst + i +  0, _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(_mm_unpacklo_epi16(lo, zero), bias)), scale));
+        _mm_storeu_ps(dst + i +  4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(_mm_unpackhi_epi16(lo, zero), bias)), scale));
+        _mm_storeu_ps(dst + i +  8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(_mm_unpacklo_epi16(hi, zero), bias)), scale));
+        _mm_storeu_ps(dst + i + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(_mm_unpackhi_epi16(hi, zero), bias)), scale));
+    }
+
+    toF32_U8_scalar(p + i, dst + i, n - i);
+}
+
+void toF32_I8_sse2(const void * src, float * dst, int n) {
+    auto p = reinterpret_cast<const int8_t *>(src);
+    const __m128 scale = _mm_set1_ps(1.0f/128);
+
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i v  = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+        const __m128i lo = _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8);
+        const __m128i hi = _mm_srai_epi16(_mm_unpackhi_epi8(v, v), 8);
+        _mm_storeu_ps(dst + i +  0, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 16)), scale));
+        _mm_storeu_ps(dst + i +  4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 16)), scale));
+        _mm_storeu_ps(dst + i +  8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 16)), scale));
+        _mm_storeu_ps(dst + i + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 16)), scale));
+    }
+
+    toF32_I8_scalar(p + i, dst + i, n - i);
+}
+
+void toF32_U16_sse2(const void * src, float * dst, int n) {
+    auto p = reinterpret_cast<const uint8_t *>(src);
+    const __m128i zero  = _mm_setzero_si128();
+    const __m128i bias  = _mm_set1_epi32(32768);
+    const __m128  scale = _mm_set1_ps(1.0f/32768);
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 2*i));
+        _mm_storeu_ps(dst + i + 0, _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(_mm_unpacklo_epi16(v, zero), bias)), scale));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(_mm_unpackhi_epi16(v, zero), bias)), scale));
+    }
+
+    toF32_U16_scalar(p + 2*i, dst + i, n - i);
+}
+
+void toF32_I16_sse2(const void * src, float * dst, int n) {
+    auto p = reinterpret_cast<const uint8_t *>(src);
+    const __m128 scale = _mm_set1_ps(1.0f/32768);
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 2*i));
+        _mm_storeu_ps(dst + i + 0, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16)), scale));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16)), scale));
+    }
+
+    toF32_I16_scalar(p + 2*i, dst + i, n - i);
+}
+
+// truncate 4 floats to int32 after clamping them to [lo, hi]
+inline __m128i cvttClamp_sse2(__m128 v, __m128 lo, __m128 hi) {
+    return _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(v, lo), hi));
+}
+
+void fromF32_U8_sse2(const float * src, void * dst, int n) {
+    auto p = reinterpret_cast<uint8_t *>(dst);
+    const __m128 one   = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(128.0f);
+    const __m128 lo    = _mm_set1_ps(0.0f);
+    const __m128 hi    = _mm_set1_ps(255.0f);
+
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i a = cvttClamp_sse2(_mm_mul_ps(_mm_add_ps(_mm_loadu_ps(src + i +  0), one), scale), lo, hi);
+        const __m128i b = cvttClamp_sse2(_mm_mul_ps(_mm_add_ps(_mm_loadu_ps(src + i +  4), one), scale), lo, hi);
+        const __m128i c = cvttClamp_sse2(_mm_mul_ps(_mm_add_ps(_mm_loadu_ps(src + i +  8), one), scale), lo, hi);
+        const __m128i d = cvttClamp_sse2(_mm_mul_ps(_mm_add_ps(_mm_loadu_ps(src + i + 12), one), scale), lo, hi);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(p + i), _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+    }
+
+    fromF32_U8_scalar(src + i, p + i, n - i);
+}
+
+void fromF32_I8_sse2(const float * src, void * dst, int n) {
+    auto p = reinterpret_cast<int8_t *>(dst);
+    const __m128 scale = _mm_set1_ps(128.0f);
+    const __m128 lo    = _mm_set1_ps(-128.0f);
+    const __m128 hi    = _mm_set1_ps(127.0f);
+
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i a = cvttClamp_sse2(_mm_mul_ps(_mm_loadu_ps(src + i +  0), scale), lo, hi);
+        const __m128i b = cvttClamp_sse2(_mm_mul_ps(_mm_loadu_ps(src + i +  4), scale), lo, hi);
+        const __m128i c = cvttClamp_sse2(_mm_mul_ps(_mm_loadu_ps(src + i +  8), scale), lo, hi);
+        const __m128i d = cvttClamp_sse2(_mm_mul_ps(_mm_loadu_ps(src + i + 12), scale), lo, hi);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(p + i), _mm_packs_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+    }
+
+    fromF32_I8_scalar(src + i, p + i, n - i);
+}
+
+void fromF32_U16_sse2(const float * src, void * dst, int n) {
+    auto p = reinterpret_cast<uint8_t *>(dst);
+    const __m128  one   = _mm_set1_ps(1.0f);
+    const __m128  scale = _mm_set1_ps(32768.0f);
+    const __m128  lo    = _mm_set1_ps(0.0f);
+    const __m128  hi    = _mm_set1_ps(65535.0f);
+    const __m128i bias  = _mm_set1_epi32(32768);
+    const __m128i sign  = _mm_set1_epi16(-32768);
+
+    // there is no unsigned 32 -> 16 bit pack in SSE2, so shift to the signed range and back
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m128i a = _mm_sub_epi32(cvttClamp_sse2(_mm_mul_ps(_mm_add_ps(_mm_loadu_ps(src + i + 0), one), scale), lo, hi), bias);
+        const __m128i b = _mm_sub_epi32(cvttClamp_sse2(_mm_mul_ps(_mm_add_ps(_mm_loadu_ps(src + i + 4), one), scale), lo, hi), bias);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(p + 2*i), _mm_xor_si128(_mm_packs_epi32(a, b), sign));
+    }
+
+    fromF32_U16_scalar(src + i, p + 2*i, n - i);
+}
+
+void fromF32_I16_sse2(const float * src, void * dst, int n) {
+    auto p = reinterpret_cast<uint8_t *>(dst);
+    const __m128 scale = _mm_set1_ps(32768.0f);
+    const __m128 lo    = _mm_set1_ps(-32768.0f);
+    const __m128 hi    = _mm_set1_ps(32767.0f);
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m128i a = cvttClamp_sse2(_mm_mul_ps(_mm_loadu_ps(src + i + 0), scale), lo, hi);
+        const __m128i b = cvttClamp_sse2(_mm_mul_ps(_mm_loadu_ps(src + i + 4), scale), lo, hi);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(p + 2*i), _mm_packs_epi32(a, b));
+    }
+
+    fromF32_I16_scalar(src + i, p + 2*i, n - i);
+}
+
+void powerSpectrum_sse2(const float * src, float * dst, int n) {
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128 a = _mm_loadu_ps(src + 2*i + 0);
+        const __m128 b = _mm_loadu_ps(src + 2*i + 4);
+        const __m128 re = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m128 im = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_mul_ps(re, re), _mm_mul_ps(im, im)));
+    }
+
+    powerSpectrum_scalar(src + 2*i, dst + i, n - i);
+}
+
+float maxValue_sse2(const float * src, int n) {
+    __m128 m = _mm_setzero_ps();
+
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        m = _mm_max_ps(m, _mm_loadu_ps(src + i));
+    }
+
+    m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+    m = _mm_max_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 1, 1, 1)));
+
+    const float res  = _mm_cvtss_f32(m);
+    const float tail = maxValue_scalar(src + i, n - i);
+
+    return tail > res ? tail : res;
+}
+
+void quantizeU8_sse2(const float * src, float scale, uint8_t * dst, int n) {
+    const __m128 s    = _mm_set1_ps(scale);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 lo   = _mm_set1_ps(0.0f);
+    const __m128 hi   = _mm_set1_ps(255.0f);
+
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i a = cvttClamp_sse2(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src + i +  0), s), half), lo, hi);
+        const __m128i b = cvttClamp_sse2(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src + i +  4), s), half), lo, hi);
+        const __m128i c = cvttClamp_sse2(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src + i +  8), s), half), lo, hi);
+        const __m128i d = cvttClamp_sse2(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src + i + 12), s), half), lo, hi);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+    }
+
+    quantizeU8_scalar(src + i, scale, dst + i, n - i);
+}
+
+inline int highestBit(uint32_t x) {
+#if defined(__GNUC__)
+    return 31 - __builtin_clz(x);
+#else
+    int res = 0;
+    while (x >>= 1) ++res;
+    return res;
+#endif
+}
+
+void argmax16U8_sse2(const uint8_t * src, int stride, int n, uint8_t * dst) {
+    for (int k = 0; k < n; ++k, src += stride) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+
+        // horizontal max, broadcast to all lanes
+        __m128i m = _mm_max_epu8(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+        m = _mm_max_epu8(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+        m = _mm_max_epu8(m, _mm_shufflelo_epi16(_mm_shufflehi_epi16(m, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1)));
+        m = _mm_max_epu8(m, _mm_or_si128(_mm_slli_epi16(m, 8), _mm_srli_epi16(m, 8)));
+
+        dst[k] = highestBit(_mm_movemask_epi8(_mm_cmpeq_epi8(v, m)));
+    }
+}
+
+float dot_sse2(const float * a, const float * b, int n) {
+    __m128 s0 = _mm_setzero_ps();
+    __m128 s1 = _mm_setzero_ps();
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(a + i + 0), _mm_loadu_ps(b + i + 0)));
+        s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+
+    __m128 s = _mm_add_ps(s0, s1);
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, _MM_SHUFFLE(1, 1, 1, 1)));
+
+    return _mm_cvtss_f32(s) + dot_scalar(a + i, b + i, n - i);
+}
+
+// lanes 0 and 1 of the result are the horizontal sums of sr and si
+inline __m128 hsum2_sse2(__m128 sr, __m128 si) {
+    const __m128 s = _mm_add_ps(_mm_unpacklo_ps(sr, si), _mm_unpackhi_ps(sr, si));
+    return _mm_add_ps(s, _mm_movehl_ps(s, s));
+}
+
+float blockEnergy_sse2(const float * src, const float * re, const float * im, int blockSize, int nBlocks) {
+    __m128 res = _mm_setzero_ps();
+
+    for (int b = 0; b < nBlocks; ++b, src += blockSize) {
+        __m128 sr = _mm_setzero_ps();
+        __m128 si = _mm_setzero_ps();
+        for (int i = 0; i < blockSize; i += 4) {
+            const __m128 x = _mm_loadu_ps(src + i);
+            sr = _mm_add_ps(sr, _mm_mul_ps(x, _mm_loadu_ps(re + i)));
+            si = _mm_add_ps(si, _mm_mul_ps(x, _mm_loadu_ps(im + i)));
+        }
+
+        const __m128 s = hsum2_sse2(sr, si);
+        res = _mm_add_ps(res, _mm_mul_ps(s, s));
+    }
+
+    return _mm_cvtss_f32(_mm_add_ss(res, _mm_shuffle_ps(res, res, _MM_SHUFFLE(1, 1, 1, 1))));
+}
+
+void firDecimate_sse2(const float * src, const float * re, const float * im, int nTaps, int decimation, float * dst, int n) {
+    for (int m = 0; m < n; ++m, src += decimation) {
+        __m128 sr = _mm_setzero_ps();
+        __m128 si = _mm_setzero_ps();
+        for (int k = 0; k < nTaps; k += 4) {
+            const __m128 x = _mm_loadu_ps(src + k);
+            sr = _mm_add_ps(sr, _mm_mul_ps(x, _mm_loadu_ps(re + k)));
+            si = _mm_add_ps(si, _mm_mul_ps(x, _mm_loadu_ps(im + k)));
+        }
+
+        _mm_storel_pi(reinterpret_cast<__m64 *>(dst + 2*m), hsum2_sse2(sr, si));
+    }
+}
+
+void deinterleave_sse2(const float * src, float * re, float * im, int n) {
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128 a = _mm_loadu_ps(src + 2*i + 0);
+        const __m128 b = _mm_loadu_ps(src + 2*i + 4);
+        _mm_storeu_ps(re + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(im + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+
+    deinterleave_scalar(src + 2*i, re + i, im + i, n - i);
+}
+
+// (yr + i*yi)*(wr + i*wi) stored in (dr, di)
+inline void cmulStore_sse2(__m128 yr, __m128 yi, const float * wr, const float * wi, float * dr, float * di) {
+    const __m128 cr = _mm_loadu_ps(wr);
+    const __m128 ci = _mm_loadu_ps(wi);
+    _mm_storeu_ps(dr, _mm_sub_ps(_mm_mul_ps(yr, cr), _mm_mul_ps(yi, ci)));
+    _mm_storeu_ps(di, _mm_add_ps(_mm_mul_ps(yr, ci), _mm_mul_ps(yi, cr)));
+}
+
+void fftRadix2_sse2(float * re, float * im, const float * tw, int n) {
+    const int h = n/2;
+    if (h < 4) {
+        fftRadix2_scalar(re, im, tw, n);
+        return;
+    }
+
+    for (int j = 0; j < h; j += 4) {
+        const __m128 ar = _mm_loadu_ps(re + j), ai = _mm_loadu_ps(im + j);
+        const __m128 br = _mm_loadu_ps(re + j + h), bi = _mm_loadu_ps(im + j + h);
+
+        _mm_storeu_ps(re + j, _mm_add_ps(ar, br));
+        _mm_storeu_ps(im + j, _mm_add_ps(ai, bi));
+
+        cmulStore_sse2(_mm_sub_ps(ar, br), _mm_sub_ps(ai, bi), tw + j, tw + h + j, re + j + h, im + j + h);
+    }
+}
+
+void fftRadix4_sse2(float * re, float * im, const float * tw, int L, int n) {
+    const int q = L/4;
+
+    // last stage: the twiddle factors are 1 - transpose groups of 4 blocks to vectorise across the blocks
+    if (q == 1 && n >= 16) {
+        for (int b = 0; b < n; b += 16) {
+            __m128 a0r = _mm_loadu_ps(re + b + 0), a1r = _mm_loadu_ps(re + b + 4), a2r = _mm_loadu_ps(re + b + 8), a3r = _mm_loadu_ps(re + b + 12);
+            __m128 a0i = _mm_loadu_ps(im + b + 0), a1i = _mm_loadu_ps(im + b + 4), a2i = _mm_loadu_ps(im + b + 8), a3i = _mm_loadu_ps(im + b + 12);
+            _MM_TRANSPOSE4_PS(a0r, a1r, a2r, a3r);
+            _MM_TRANSPOSE4_PS(a0i, a1i, a2i, a3i);
+
+            const __m128 t0r = _mm_add_ps(a0r, a2r), t0i = _mm_add_ps(a0i, a2i);
+            const __m128 t1r = _mm_sub_ps(a0r, a2r), t1i = _mm_sub_ps(a0i, a2i);
+            const __m128 t2r = _mm_add_ps(a1r, a3r), t2i = _mm_add_ps(a1i, a3i);
+            const __m128 t3r = _mm_sub_ps(a1r, a3r), t3i = _mm_sub_ps(a1i, a3i);
+
+            __m128 y0r = _mm_add_ps(t0r, t2r), y0i = _mm_add_ps(t0i, t2i);
+            __m128 y1r = _mm_add_ps(t1r, t3i), y1i = _mm_sub_ps(t1i, t3r);
+            __m128 y2r = _mm_sub_ps(t0r, t2r), y2i = _mm_sub_ps(t0i, t2i);
+            __m128 y3r = _mm_sub_ps(t1r, t3i), y3i = _mm_add_ps(t1i, t3r);
+            _MM_TRANSPOSE4_PS(y0r, y1r, y2r, y3r);
+            _MM_TRANSPOSE4_PS(y0i, y1i, y2i, y3i);
+
+            _mm_storeu_ps(re + b + 0, y0r); _mm_storeu_ps(re + b + 4, y1r); _mm_storeu_ps(re + b + 8, y2r); _mm_storeu_ps(re + b + 12, y3r);
+            _mm_storeu_ps(im + b + 0, y0i); _mm_storeu_ps(im + b + 4, y1i); _mm_storeu_ps(im + b + 8, y2i); _mm_storeu_ps(im + b + 12, y3i);
+        }
+        return;
+    }
+
+    if (q < 4) {
+        fftRadix4_scalar(re, im, tw, L, n);
+        return;
+    }
+
+    for (int b = 0; b < n; b += L) {
+        float * xr = re + b;
+        float * xi = im + b;
+        for (int j = 0; j < q; j += 4) {
+            const __m128 a0r = _mm_loadu_ps(xr + j + 0*q), a0i = _mm_loadu_ps(xi + j + 0*q);
+            const __m128 a1r = _mm_loadu_ps(xr + j + 1*q), a1i = _mm_loadu_ps(xi + j + 1*q);
+            const __m128 a2r = _mm_loadu_ps(xr + j + 2*q), a2i = _mm_loadu_ps(xi + j + 2*q);
+            const __m128 a3r = _mm_loadu_ps(xr + j + 3*q), a3i = _mm_loadu_ps(xi + j + 3*q);
+
+            const __m128 t0r = _mm_add_ps(a0r, a2r), t0i = _mm_add_ps(a0i, a2i);
+            const __m128 t1r = _mm_sub_ps(a0r, a2r), t1i = _mm_sub_ps(a0i, a2i);
+            const __m128 t2r = _mm_add_ps(a1r, a3r), t2i = _mm_add_ps(a1i, a3i);
+            const __m128 t3r = _mm_sub_ps(a1r, a3r), t3i = _mm_sub_ps(a1i, a3i);
+
+            _mm_storeu_ps(xr + j, _mm_add_ps(t0r, t2r));
+            _mm_storeu_ps(xi + j, _mm_add_ps(t0i, t2i));
+
+            cmulStore_sse2(_mm_add_ps(t1r, t3i), _mm_sub_ps(t1i, t3r), tw + 0*q + j, tw + 1*q + j, xr + j + 1*q, xi + j + 1*q);
+            cmulStore_sse2(_mm_sub_ps(t0r, t2r), _mm_sub_ps(t0i, t2i), tw + 2*q + j, tw + 3*q + j, xr + j + 2*q, xi + j + 2*q);
+            cmulStore_sse2(_mm_sub_ps(t1r, t3i), _mm_add_ps(t1i, t3r), tw + 4*q + j, tw + 5*q + j, xr + j + 3*q, xi + j + 3*q);
+        }
+    }
+}
+
+inline __m128 reverse_sse2(__m128 v) {
+    return _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 1, 2, 3));
+}
+
+void fftRealPost_sse2(const float * zr, const float * zi, const float * tw, float * dst, int N) {
+    const int M = N/2;
+    const __m128 half = _mm_set1_ps(0.5f);
+
+    fftRealPostEdges(zr, zi, dst, N);
+
+    int k = 1;
+    for (; k + 4 <= M/2; k += 4) {
+        const __m128 ar = _mm_loadu_ps(zr + k), ai = _mm_loadu_ps(zi + k);
+        const __m128 br = reverse_sse2(_mm_loadu_ps(zr + M - k - 3));
+        const __m128 bi = reverse_sse2(_mm_loadu_ps(zi + M - k - 3));
+
+        const __m128 er = _mm_mul_ps(half, _mm_add_ps(ar, br));
+        const __m128 ei = _mm_mul_ps(half, _mm_sub_ps(ai, bi));
+        const __m128 or_ = _mm_mul_ps(half, _mm_add_ps(ai, bi));
+        const __m128 oi = _mm_mul_ps(half, _mm_sub_ps(br, ar));
+
+        const __m128 wr = _mm_loadu_ps(tw + k);
+        const __m128 wi = _mm_loadu_ps(tw + M/2 + k);
+
+        const __m128 tr = _mm_add_ps(_mm_mul_ps(wr, or_), _mm_mul_ps(wi, oi));
+        const __m128 ti = _mm_sub_ps(_mm_mul_ps(wr, oi), _mm_mul_ps(wi, or_));
+
+        const __m128 xr = _mm_add_ps(er, tr);
+        const __m128 xi = _mm_sub_ps(_mm_setzero_ps(), _mm_add_ps(ei, ti));
+        _mm_storeu_ps(dst + 2*k + 0, _mm_unpacklo_ps(xr, xi));
+        _mm_storeu_ps(dst + 2*k + 4, _mm_unpackhi_ps(xr, xi));
+
+        const __m128 yr = reverse_sse2(_mm_sub_ps(er, tr));
+        const __m128 yi = reverse_sse2(_mm_sub_ps(ei, ti));
+        _mm_storeu_ps(dst + 2*(M - k - 3) + 0, _mm_unpacklo_ps(yr, yi));
+        _mm_storeu_ps(dst + 2*(M - k - 3) + 4, _mm_unpackhi_ps(yr, yi));
+    }
+
+    fftRealPostRange_scalar(zr, zi, tw, dst, N, k, M/2);
+}
+
+inline void goertzelStore_sse2(__m128 s1, __m128 s2, const float * cs, const float * sn, float * dst) {
+    const __m128 re = _mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(cs), s1), s2);
+    const __m128 im = _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(_mm_loadu_ps(sn), s1));
+    _mm_storeu_ps(dst + 0, _mm_unpacklo_ps(re, im));
+    _mm_storeu_ps(dst + 4, _mm_unpackhi_ps(re, im));
+}
+
+// four vectors of bins at a time, so that their recurrences hide the latency of each other
+void goertzel_sse2(const float * src, int n, const float * cs, const float * sn, float * dst, int nBins) {
+    int k = 0;
+    for (; k + 16 <= nBins; k += 16) {
+        const __m128 c0 = _mm_mul_ps(_mm_set1_ps(2.0f), _mm_loadu_ps(cs + k +  0));
+        const __m128 c1 = _mm_mul_ps(_mm_set1_ps(2.0f), _mm_loadu_ps(cs + k +  4));
+        const __m128 c2 = _mm_mul_ps(_mm_set1_ps(2.0f), _mm_loadu_ps(cs + k +  8));
+        const __m128 c3 = _mm_mul_ps(_mm_set1_ps(2.0f), _mm_loadu_ps(cs + k + 12));
+
+        __m128 a0 = _mm_setzero_ps(), b0 = _mm_setzero_ps();
+        __m128 a1 = _mm_setzero_ps(), b1 = _mm_setzero_ps();
+        __m128 a2 = _mm_setzero_ps(), b2 = _mm_setzero_ps();
+        __m128 a3 = _mm_setzero_ps(), b3 = _mm_setzero_ps();
+        for (int i = 0; i < n; ++i) {
+            const __m128 x = _mm_set1_ps(src[i]);
+            const __m128 t0 = _mm_add_ps(_mm_sub_ps(x, b0), _mm_mul_ps(c0, a0));
+            const __m128 t1 = _mm_add_ps(_mm_sub_ps(x, b1), _mm_mul_ps(c1, a1));
+            const __m128 t2 = _mm_add_ps(_mm_sub_ps(x, b2), _mm_mul_ps(c2, a2));
+            const __m128 t3 = _mm_add_ps(_mm_sub_ps(x, b3), _mm_mul_ps(c3, a3));
+            b0 = a0; a0 = t0;
+            b1 = a1; a1 = t1;
+            b2 = a2; a2 = t2;
+            b3 = a3; a3 = t3;
+        }
+
+        goertzelStore_sse2(a0, b0, cs + k +  0, sn + k +  0, dst + 2*k +  0);
+        goertzelStore_sse2(a1, b1, cs + k +  4, sn + k +  4, dst + 2*k +  8);
+        goertzelStore_sse2(a2, b2, cs + k +  8, sn + k +  8, dst + 2*k + 16);
+        goertzelStore_sse2(a3, b3, cs + k + 12, sn + k + 12, dst + 2*k + 24);
+    }
+
+    for (; k + 4 <= nBins; k += 4) {
+        const __m128 c0 = _mm_mul_ps(_mm_set1_ps(2.0f), _mm_loadu_ps(cs + k));
+
+        __m128 a0 = _mm_setzero_ps(), b0 = _mm_setzero_ps();
+        for (int i = 0; i < n; ++i) {
+            const __m128 t0 = _mm_add_ps(_mm_sub_ps(_mm_set1_ps(src[i]), b0), _mm_mul_ps(c0, a0));
+            b0 = a0; a0 = t0;
+        }
+
+        goertzelStore_sse2(a0, b0, cs + k, sn + k, dst + 2*k);
+    }
+
+    goertzel_scalar(src, n, cs + k, sn + k, dst + 2*k, nBins - k);
+}
+
+const SimdKernels kSimdKernelsSSE2 = {
+    "sse2",
+    4,
+    { nullptr, toF32_U8_sse2,   toF32_I8_sse2,   toF32_U16_sse2,   toF32_I16_sse2,   toF32_F32   },
+    { nullptr, fromF32_U8_sse2, fromF32_I8_sse2, fromF32_U16_sse2, fromF32_I16_sse2, fromF32_F32 },
+    powerSpectrum_sse2,
+    maxValue_sse2,
+    quantizeU8_sse2,
+    argmax16U8_sse2,
+    dot_sse2,
+    blockEnergy_sse2,
+    firDecimate_sse2,
+    deinterleave_sse2,
+    fftRadix2_sse2,
+    fftRadix4_sse2,
+    fftRealPost_sse2,
+    goertzel_sse2,
+};
+
+#endif
+
+//
+// AVX2
+//
+
+#ifdef GGWAVE_SIMD_AVX2
+
+#define GGWAVE_TARGET_AVX2 __attribute__((target("avx2")))
+
+GGWAVE_TARGET_AVX2 void toF32_U8_avx2(const void * src, float * dst, int n) {
+    auto p = reinterpret_cast<const uint8_t *>(src);
+    const __m256i bias  = _mm256_set1_epi32(128);
+    const __m256  scale = _mm256_set1_ps(1.0f/128);
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i v = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p + i)));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(v, bias)), scale));
+    }
+
+    toF32_U8_scalar(p + i, dst + i, n - i);
+}
+
+GGWAVE_TARGET_AVX2 void toF32_I8_avx2(const void * src, float * dst, int n) {
+    auto p = reinterpret_cast<const int8_t *>(src);
+    const __m256 scale = _mm256_set1_ps(1.0f/128);
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i v = _mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p + i)));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+    }
+
+    toF32_I8_scalar(p + i, dst + i, n - i);
+}
+
+GGWAVE_TARGET_AVX2 void toF32_U16_avx2(const void * src, float * dst, int n) {
+    auto p = reinterpret_cast<const uint8_t *>(src);
+    const __m256i bias  = _mm256_set1_epi32(32768);
+    const __m256  scale = _mm256_set1_ps(1.0f/32768);
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i v = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 2*i)));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(v, bias)), scale));
+    }
+
+    toF32_U16_scalar(p + 2*i, dst + i, n - i);
+}
+
+GGWAVE_TARGET_AVX2 void toF32_I16_avx2(const void * src, float * dst, int n) {
+    auto p = reinterpret_cast<const uint8_t *>(src);
+    const __m256 scale = _mm256_set1_ps(1.0f/32768);
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i v = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 2*i)));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+    }
+
+    toF32_I16_scalar(p + 2*i, dst + i, n - i);
+}
+
+GGWAVE_TARGET_AVX2 inline __m256i cvttClamp_avx2(__m256 v, __m256 lo, __m256 hi) {
+    return _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(v, lo), hi));
+}
+
+// the 256-bit packs work within the 128-bit lanes - restore the sample order with a permute
+GGWAVE_TARGET_AVX2 inline __m256i pack8_avx2(__m256i a, __m256i b, __m256i c, __m256i d, bool isSigned) {
+    const __m256i ab = _mm256_packs_epi32(a, b);
+    const __m256i cd = _mm256_packs_epi32(c, d);
+    const __m256i r  = isSigned ? _mm256_packs_epi16(ab, cd) : _mm256_packus_epi16(ab, cd);
+    return _mm256_permutevar8x32_epi32(r, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+}
+
+GGWAVE_TARGET_AVX2 void fromF32_U8_avx2(const float * src, void * dst, int n) {
+    auto p = reinterpret_cast<uint8_t *>(dst);
+    const __m256 one   = _mm256_set1_ps(1.0f);
+    const __m256 scale = _mm256_set1_ps(128.0f);
+    const __m256 lo    = _mm256_set1_ps(0.0f);
+    const __m256 hi    = _mm256_set1_ps(255.0f);
+
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        const __m256i a = cvttClamp_avx2(_mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(src + i +  0), one), scale), lo, hi);
+        const __m256i b = cvttClamp_avx2(_mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(src + i +  8), one), scale), lo, hi);
+        const __m256i c = cvttClamp_avx2(_mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(src + i + 16), one), scale), lo, hi);
+        const __m256i d = cvttClamp_avx2(_mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(src + i + 24), one), scale), lo, hi);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(p + i), pack8_avx2(a, b, c, d, false));
+    }
+
+    fromF32_U8_scalar(src + i, p + i, n - i);
+}
+
+GGWAVE_TARGET_AVX2 void fromF32_I8_avx2(const float * src, void * dst, int n) {
+    auto p = reinterpret_cast<int8_t *>(dst);
+    const __m256 scale = _mm256_set1_ps(128.0f);
+    const __m256 lo    = _mm256_set1_ps(-128.0f);
+    const __m256 hi    = _mm256_set1_ps(127.0f);
+
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        const __m256i a = cvttClamp_avx2(_mm256_mul_ps(_mm256_loadu_ps(src + i +  0), scale), lo, hi);
+        const __m256i b = cvttClamp_avx2(_mm256_mul_ps(_mm256_loadu_ps(src + i +  8), scale), lo, hi);
+        const __m256i c = cvttClamp_avx2(_mm256_mul_ps(_mm256_loadu_ps(src + i + 16), scale), lo, hi);
+        const __m256i d = cvttClamp_avx2(_mm256_mul_ps(_mm256_loadu_ps(src + i + 24), scale), lo, hi);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(p + i), pack8_avx2(a, b, c, d, true));
+    }
+
+    fromF32_I8_scalar(src + i, p + i, n - i);
+}
+
+GGWAVE_TARGET_AVX2 void fromF32_U16_avx2(const float * src, void * dst, int n) {
+    auto p = reinterpret_cast<uint8_t *>(dst);
+    const __m256 one   = _mm256_set1_ps(1.0f);
+    const __m256 scale = _mm256_set1_ps(32768.0f);
+    const __m256 lo    = _mm256_set1_ps(0.0f);
+    const __m256 hi    = _mm256_set1_ps(65535.0f);
+
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m256i a = cvttClamp_avx2(_mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(src + i + 0), one), scale), lo, hi);
+        const __m256i b = cvttClamp_avx2(_mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(src + i + 8), one), scale), lo, hi);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(p + 2*i), _mm256_permute4x64_epi64(_mm256_packus_epi32(a, b), 0xD8));
+    }
+
+    fromF32_U16_scalar(src + i, p + 2*i, n - i);
+}
+
+GGWAVE_TARGET_AVX2 void fromF32_I16_avx2(const float * src, void * dst, int n) {
+    auto p = reinterpret_cast<uint8_t *>(dst);
+    const __m256 scale = _mm256_set1_ps(32768.0f);
+    const __m256 lo    = _mm256_set1_ps(-32768.0f);
+    const __m256 hi    = _mm256_set1_ps(32767.0f);
+
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m256i a = cvttClamp_avx2(_mm256_mul_ps(_mm256_loadu_ps(src + i + 0), scale), lo, hi);
+        const __m256i b = cvttClamp_avx2(_mm256_mul_ps(_mm256_loadu_ps(src + i + 8), scale), lo, hi);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(p + 2*i), _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8));
+    }
+
+    fromF32_I16_scalar(src + i, p + 2*i, n - i);
+}
+
+GGWAVE_TARGET_AVX2 void powerSpectrum_avx2(const float * src, float * dst, int n) {
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256 a = _mm256_loadu_ps(src + 2*i + 0);
+        const __m256 b = _mm256_loadu_ps(src + 2*i + 8);
+        const __m256 re = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m256 im = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        const __m256 p  = _mm256_add_ps(_mm256_mul_ps(re, re), _mm256_mul_ps(im, im));
+        _mm256_storeu_ps(dst + i, _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(p), 0xD8)));
+    }
+
+    powerSpectrum_scalar(src + 2*i, dst + i, n - i);
+}
+
+GGWAVE_TARGET_AVX2 float maxValue_avx2(const float * src, int n) {
+    __m256 m = _mm256_setzero_ps();
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        m = _mm256_max_ps(m, _mm256_loadu_ps(src + i));
+    }
+
+    __m128 r = _mm_max_ps(_mm256_castps256_ps128(m), _mm256_extractf128_ps(m, 1));
+    r = _mm_max_ps(r, _mm_movehl_ps(r, r));
+    r = _mm_max_ps(r, _mm_shuffle_ps(r, r, _MM_SHUFFLE(1, 1, 1, 1)));
+
+    const float res  = _mm_cvtss_f32(r);
+    const float tail = maxValue_scalar(src + i, n - i);
+
+    return tail > res ? tail : res;
+}
+
+GGWAVE_TARGET_AVX2 void quantizeU8_avx2(const float * src, float scale, uint8_t * dst, int n) {
+    const __m256 s    = _mm256_set1_ps(scale);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 lo   = _mm256_set1_ps(0.0f);
+    const __m256 hi   = _mm256_set1_ps(255.0f);
+
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        const __m256i a = cvttClamp_avx2(_mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(src + i +  0), s), half), lo, hi);
+        const __m256i b = cvttClamp_avx2(_mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(src + i +  8), s), half), lo, hi);
+        const __m256i c = cvttClamp_avx2(_mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(src + i + 16), s), half), lo, hi);
+        const __m256i d = cvttClamp_avx2(_mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(src + i + 24), s), half), lo, hi);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), pack8_avx2(a, b, c, d, false));
+    }
+
+    quantizeU8_scalar(src + i, scale, dst + i, n - i);
+}
+
+GGWAVE_TARGET_AVX2 float dot_avx2(const float * a, const float * b, int n) {
+    __m256 s0 = _mm256_setzero_ps();
+    __m256 s1 = _mm256_setzero_ps();
+
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        s0 = _mm256_add_ps(s0, _mm256_mul_ps(_mm256_loadu_ps(a + i + 0), _mm256_loadu_ps(b + i + 0)));
+        s1 = _mm256_add_ps(s1, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8)));
+    }
+
+    const __m256 t = _mm256_add_ps(s0, s1);
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(t), _mm256_extractf128_ps(t, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, _MM_SHUFFLE(1, 1, 1, 1)));
+
+    return _mm_cvtss_f32(s) + dot_scalar(a + i, b + i, n - i);
+}
+
+// four blocks at a time - their sums are reduced together, which costs less than the reduction of each block
+GGWAVE_TARGET_AVX2 float blockEnergy_avx2(const float * src, const float * re, const float * im, int blockSize, int nBlocks) {
+    __m256 res = _mm256_setzero_ps();
+
+    int b = 0;
+    for (; b + 4 <= nBlocks; b += 4, src += 4*blockSize) {
+        __m256 r0 = _mm256_setzero_ps();
+        __m256 r1 = _mm256_setzero_ps();
+        __m256 r2 = _mm256_setzero_ps();
+        __m256 r3 = _mm256_setzero_ps();
+        __m256 i0 = _mm256_setzero_ps();
+        __m256 i1 = _mm256_setzero_ps();
+        __m256 i2 = _mm256_setzero_ps();
+        __m256 i3 = _mm256_setzero_ps();
+        for (int i = 0; i < blockSize; i += 8) {
+            const __m256 cr = _mm256_loadu_ps(re + i);
+            const __m256 ci = _mm256_loadu_ps(im + i);
+
+            const __m256 x0 = _mm256_loadu_ps(src + i);
+            const __m256 x1 = _mm256_loadu_ps(src + i + 1*blockSize);
+            const __m256 x2 = _mm256_loadu_ps(src + i + 2*blockSize);
+            const __m256 x3 = _mm256_loadu_ps(src + i + 3*blockSize);
+
+            r0 = _mm256_add_ps(r0, _mm256_mul_ps(x0, cr));
+            i0 = _mm256_add_ps(i0, _mm256_mul_ps(x0, ci));
+            r1 = _mm256_add_ps(r1, _mm256_mul_ps(x1, cr));
+            i1 = _mm256_add_ps(i1, _mm256_mul_ps(x1, ci));
+            r2 = _mm256_add_ps(r2, _mm256_mul_ps(x2, cr));
+            i2 = _mm256_add_ps(i2, _mm256_mul_ps(x2, ci));
+            r3 = _mm256_add_ps(r3, _mm256_mul_ps(x3, cr));
+            i3 = _mm256_add_ps(i3, _mm256_mul_ps(x3, ci));
+        }
+
+        // each 128-bit half holds the partial sums of (r0, r1, i0, i1) and of (r2, r3, i2, i3)
+        const __m256 a = _mm256_hadd_ps(_mm256_hadd_ps(r0, r1), _mm256_hadd_ps(i0, i1));
+        const __m256 c = _mm256_hadd_ps(_mm256_hadd_ps(r2, r3), _mm256_hadd_ps(i2, i3));
+
+        const __m256 s = _mm256_add_ps(_mm256_permute2f128_ps(a, c, 0x20), _mm256_permute2f128_ps(a, c, 0x31));
+        res = _mm256_add_ps(res, _mm256_mul_ps(s, s));
+    }
+
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(res), _mm256_extractf128_ps(res, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, _MM_SHUFFLE(1, 1, 1, 1)));
+
+    return _mm_cvtss_f32(s) + blockEnergy_scalar(src, re, im, blockSize, nBlocks - b);
+}
+
+GGWAVE_TARGET_AVX2 void firDecimate_avx2(const float * src, const float * re, const float * im, int nTaps, int decimation, float * dst, int n) {
+    int m = 0;
+    for (; m + 4 <= n; m += 4, src += 4*decimation) {
+        __m256 r0 = _mm256_setzero_ps();
+        __m256 r1 = _mm256_setzero_ps();
+        __m256 r2 = _mm256_setzero_ps();
+        __m256 r3 = _mm256_setzero_ps();
+        __m256 i0 = _mm256_setzero_ps();
+        __m256 i1 = _mm256_setzero_ps();
+        __m256 i2 = _mm256_setzero_ps();
+        __m256 i3 = _mm256_setzero_ps();
+        for (int k = 0; k < nTaps; k += 8) {
+            const __m256 cr = _mm256_loadu_ps(re + k);
+            const __m256 ci = _mm256_loadu_ps(im + k);
+
+            const __m256 x0 = _mm256_loadu_ps(src + k);
+            const __m256 x1 = _mm256_loadu_ps(src + k + 1*decimation);
+            const __m256 x2 = _mm256_loadu_ps(src + k + 2*decimation);
+            const __m256 x3 = _mm256_loadu_ps(src + k + 3*decimation);
+
+            r0 = _mm256_add_ps(r0, _mm256_mul_ps(x0, cr));
+            i0 = _mm256_add_ps(i0, _mm256_mul_ps(x0, ci));
+            r1 = _mm256_add_ps(r1, _mm256_mul_ps(x1, cr));
+            i1 = _mm256_add_ps(i1, _mm256_mul_ps(x1, ci));
+            r2 = _mm256_add_ps(r2, _mm256_mul_ps(x2, cr));
+            i2 = _mm256_add_ps(i2, _mm256_mul_ps(x2, ci));
+            r3 = _mm256_add_ps(r3, _mm256_mul_ps(x3, cr));
+            i3 = _mm256_add_ps(i3, _mm256_mul_ps(x3, ci));
+        }
+
+        // (r0, r1, i0, i1, r2, r3, i2, i3), reordered to the interleaved outputs
+        const __m256 a = _mm256_hadd_ps(_mm256_hadd_ps(r0, r1), _mm256_hadd_ps(i0, i1));
+        const __m256 c = _mm256_hadd_ps(_mm256_hadd_ps(r2, r3), _mm256_hadd_ps(i2, i3));
+
+        const __m256 s = _mm256_add_ps(_mm256_permute2f128_ps(a, c, 0x20), _mm256_permute2f128_ps(a, c, 0x31));
+        _mm256_storeu_ps(dst + 2*m, _mm256_permute_ps(s, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+
+    for (; m < n; ++m, src += decimation) {
+        __m256 sr = _mm256_setzero_ps();
+        __m256 si = _mm256_setzero_ps();
+        for (int k = 0; k < nTaps; k += 8) {
+            const __m256 x = _mm256_loadu_ps(src + k);
+            sr = _mm256_add_ps(sr, _mm256_mul_ps(x, _mm256_loadu_ps(re + k)));
+            si = _mm256_add_ps(si, _mm256_mul_ps(x, _mm256_loadu_ps(im + k)));
+        }
+
+        const __m128 r = _mm_add_ps(_mm256_castps256_ps128(sr), _mm256_extractf128_ps(sr, 1));
+        const __m128 q = _mm_add_ps(_mm256_castps256_ps128(si), _mm256_extractf128_ps(si, 1));
+
+        __m128 s = _mm_add_ps(_mm_unpacklo_ps(r, q), _mm_unpackhi_ps(r, q));
+        s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+        _mm_storel_pi(reinterpret_cast<__m64 *>(dst + 2*m), s);
+    }
+}
+
+GGWAVE_TARGET_AVX2
+inline void cmulStore_avx2(__m256 yr, __m256 yi, const float * wr, const float * wi, float * dr, float * di) {
+    const __m256 cr = _mm256_loadu_ps(wr);
+    const __m256 ci = _mm256_loadu_ps(wi);
+    _mm256_storeu_ps(dr, _mm256_sub_ps(_mm256_mul_ps(yr, cr), _mm256_mul_ps(yi, ci)));
+    _mm256_storeu_ps(di, _mm256_add_ps(_mm256_mul_ps(yr, ci), _mm256_mul_ps(yi, cr)));
+}
+
+GGWAVE_TARGET_AVX2
+void fftRadix2_avx2(float * re, float * im, const float * tw, int n) {
+    const int h = n/2;
+    if (h < 8) {
+        fftRadix2_scalar(re, im, tw, n);
+        return;
+    }
+
+    for (int j = 0; j < h; j += 8) {
+        const __m256 ar = _mm256_loadu_ps(re + j), ai = _mm256_loadu_ps(im + j);
+        const __m256 br = _mm256_loadu_ps(re + j + h), bi = _mm256_loadu_ps(im + j + h);
+
+        _mm256_storeu_ps(re + j, _mm256_add_ps(ar, br));
+        _mm256_storeu_ps(im + j, _mm256_add_ps(ai, bi));
+
+        cmulStore_avx2(_mm256_sub_ps(ar, br), _mm256_sub_ps(ai, bi), tw + j, tw + h + j, re + j + h, im + j + h);
+    }
+}
+
+GGWAVE_TARGET_AVX2
+void fftRadix4_avx2(float * re, float * im, const float * tw, int L, int n) {
+    const int q = L/4;
+    if (q < 8) {
+#ifdef GGWAVE_SIMD_SSE2
+        fftRadix4_sse2(re, im, tw, L, n);
+#else
+        fftRadix4_scalar(re, im, tw, L, n);
+#endif
+        return;
+    }
+
+    for (int b = 0; b < n; b += L) {
+        float * xr = re + b;
+        float * xi = im + b;
+        for (int j = 0; j < q; j += 8) {
+            const __m256 a0r = _mm256_loadu_ps(xr + j + 0*q), a0i = _mm256_loadu_ps(xi + j + 0*q);
+            const __m256 a1r = _mm256_loadu_ps(xr + j + 1*q), a1i = _mm256_loadu_ps(xi + j + 1*q);
+            const __m256 a2r = _mm256_loadu_ps(xr + j + 2*q), a2i = _mm256_loadu_ps(xi + j + 2*q);
+            const __m256 a3r = _mm256_loadu_ps(xr + j + 3*q), a3i = _mm256_loadu_ps(xi + j + 3*q);
+
+            const __m256 t0r = _mm256_add_ps(a0r, a2r), t0i = _mm256_add_ps(a0i, a2i);
+            const __m256 t1r = _mm256_sub_ps(a0r, a2r), t1i = _mm256_sub_ps(a0i, a2i);
+            const __m256 t2r = _mm256_add_ps(a1r, a3r), t2i = _mm256_add_ps(a1i, a3i);
+            const __m256 t3r = _mm256_sub_ps(a1r, a3r), t3i = _mm256_sub_ps(a1i, a3i);
+
+            _mm256_storeu_ps(xr + j, _mm256_add_ps(t0r, t2r));
+            _mm256_storeu_ps(xi + j, _mm256_add_ps(t0i, t2i));
+
+            cmulStore_avx2(_mm256_add_ps(t1r, t3i), _mm256_sub_ps(t1i, t3r), tw + 0*q + j, tw + 1*q + j, xr + j + 1*q, xi + j + 1*q);
+            cmulStore_avx2(_mm256_sub_ps(t0r, t2r), _mm256_sub_ps(t0i, t2i), tw + 2*q + j, tw + 3*q + j, xr + j + 2*q, xi + j + 2*q);
+            cmulStore_avx2(_mm256_sub_ps(t1r, t3i), _mm256_add_ps(t1i, t3r), tw + 4*q + j, tw + 5*q + j, xr + j + 3*q, xi + j + 3*q);
+        }
+    }
+}
+
+GGWAVE_TARGET_AVX2
+inline void goertzelStore_avx2(__m256 s1, __m256 s2, const float * cs, const float * sn, float * dst) {
+    const __m256 re = _mm256_sub_ps(_mm256_mul_ps(_mm256_loadu_ps(cs), s1), s2);
+    const __m256 im = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_mul_ps(_mm256_loadu_ps(sn), s1));
+    const __m256 lo = _mm256_unpacklo_ps(re, im);
+    const __m256 hi = _mm256_unpackhi_ps(re, im);
+    _mm256_storeu_ps(dst + 0, _mm256_permute2f128_ps(lo, hi, 0x20));
+    _mm256_storeu_ps(dst + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+}
+
+GGWAVE_TARGET_AVX2 void goertzel_avx2(const float * src, int n, const float * cs, const float * sn, float * dst, int nBins) {
+    int k = 0;
+    for (; k + 32 <= nBins; k += 32) {
+        const __m256 c0 = _mm256_mul_ps(_mm256_set1_ps(2.0f), _mm256_loadu_ps(cs + k +  0));
+        const __m256 c1 = _mm256_mul_ps(_mm256_set1_ps(2.0f), _mm256_loadu_ps(cs + k +  8));
+        const __m256 c2 = _mm256_mul_ps(_mm256_set1_ps(2.0f), _mm256_loadu_ps(cs + k + 16));
+        const __m256 c3 = _mm256_mul_ps(_mm256_set1_ps(2.0f), _mm256_loadu_ps(cs + k + 24));
+
+        __m256 a0 = _mm256_setzero_ps(), b0 = _mm256_setzero_ps();
+        __m256 a1 = _mm256_setzero_ps(), b1 = _mm256_setzero_ps();
+        __m256 a2 = _mm256_setzero_ps(), b2 = _mm256_setzero_ps();
+        __m256 a3 = _mm256_setzero_ps(), b3 = _mm256_setzero_ps();
+        for (int i = 0; i < n; ++i) {
+            const __m256 x = _mm256_set1_ps(src[i]);
+            const __m256 t0 = _mm256_add_ps(_mm256_sub_ps(x, b0), _mm256_mul_ps(c0, a0));
+            const __m256 t1 = _mm256_add_ps(_mm256_sub_ps(x, b1), _mm256_mul_ps(c1, a1));
+            const __m256 t2 = _mm256_add_ps(_mm256_sub_ps(x, b2), _mm256_mul_ps(c2, a2));
+            const __m256 t3 = _mm256_add_ps(_mm256_sub_ps(x, b3), _mm256_mul_ps(c3, a3));
+            b0 = a0; a0 = t0;
+            b1 = a1; a1 = t1;
+            b2 = a2; a2 = t2;
+            b3 = a3; a3 = t3;
+        }
+
+        goertzelStore_avx2(a0, b0, cs + k +  0, sn + k +  0, dst + 2*k +  0);
+        goertzelStore_avx2(a1, b1, cs + k +  8, sn + k +  8, dst + 2*k + 16);
+        goertzelStore_avx2(a2, b2, cs + k + 16, sn + k + 16, dst + 2*k + 32);
+        goertzelStore_avx2(a3, b3, cs + k + 24, sn + k + 24, dst + 2*k + 48);
+    }
+
+    for (; k + 8 <= nBins; k += 8) {
+        const __m256 c0 = _mm256_mul_ps(_mm256_set1_ps(2.0f), _mm256_loadu_ps(cs + k));
+
+        __m256 a0 = _mm256_setzero_ps(), b0 = _mm256_setzero_ps();
+        for (int i = 0; i < n; ++i) {
+            const __m256 t0 = _mm256_add_ps(_mm256_sub_ps(_mm256_set1_ps(src[i]), b0), _mm256_mul_ps(c0, a0));
+            b0 = a0; a0 = t0;
+        }
+
+        goertzelStore_avx2(a0, b0, cs + k, sn + k, dst + 2*k);
+    }
+
+#ifdef GGWAVE_SIMD_SSE2
+    goertzel_sse2(src, n, cs + k, sn + k, dst + 2*k, nBins - k);
+#else
+    goertzel_scalar(src, n, cs + k, sn + k, dst + 2*k, nBins - k);
+#endif
+}
+
+#undef GGWAVE_TARGET_AVX2
+
+const SimdKernels kSimdKernelsAVX2 = {
+    "avx2",
+    8,
+    { nullptr, toF32_U8_avx2,   toF32_I8_avx2,   toF32_U16_avx2,   toF32_I16_avx2,   toF32_F32   },
+    { nullptr, fromF32_U8_avx2, fromF32_I8_avx2, fromF32_U16_avx2, fromF32_I16_avx2, fromF32_F32 },
+    powerSpectrum_avx2,
+    maxValue_avx2,
+    quantizeU8_avx2,
+#ifdef GGWAVE_SIMD_SSE2
+    argmax16U8_sse2, // a single 128-bit register is enough
+#else
+    argmax16U8_scalar,
+#endif
+    dot_avx2,
+    blockEnergy_avx2,
+    firDecimate_avx2,
+#ifdef GGWAVE_SIMD_SSE2
+    deinterleave_sse2,
+#else
+    deinterleave_scalar,
+#endif
+    fftRadix2_avx2,
+    fftRadix4_avx2,
+#ifdef GGWAVE_SIMD_SSE2
+    fftRealPost_sse2, // the mirrored bins are simpler to reverse in 128-bit registers
+#else
+    fftRealPost_scalar,
+#endif
+    goertzel_avx2,
+};
+
+#endif
+
+//
+// NEON
+//
+
+#ifdef GGWAVE_SIMD_NEON
+
+void toF32_U8_neon(const void * src, float * dst, int n) {
+    auto p = reinterpret_cast<const uint8_t *>(src);
+    const int16x8_t bias = vdupq_n_s16(128);
+
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const uint8x16_t v  = vld1q_u8(p + i);
+        const int16x8_t  lo = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(v))),  bias);
+        const int16x8_t  hi = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(v))), bias);
+        vst1q_f32(dst + i +  0, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(lo))),  1.0f/128));
+        vst1q_f32(dst + i +  4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(lo))), 1.0f/128));
+        vst1q_f32(dst + i +  8, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(hi))),  1.0f/128));
+        vst1q_f32(dst + i + 12, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(hi))), 1.0f/128));
+    }
+
+    toF32_U8_scalar(p + i, dst + i, n - i);
+}
+
+void toF32_I8_neon(const void * src, float * dst, int n) {
+    auto p = reinterpret_cast<const int8_t *>(src);
+
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const int8x16_t v  = vld1q_s8(p + i);
+        const int16x8_t lo = vmovl_s8(vget_low_s8(v));
+        const int16x8_t hi = vmovl_s8(vget_high_s8(v));
+        vst1q_f32(dst + i +  0, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(lo))),  1.0f/128));
+        vst1q_f32(dst + i +  4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(lo))), 1.0f/128));
+        vst1q_f32(dst + i +  8, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(hi))),  1.0f/128));
+        vst1q_f32(dst + i + 12, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(hi))), 1.0f/128));
+    }
+
+    toF32_I8_scalar(p + i, dst + i, n - i);
+}
+
+void toF32_U16_neon(const void * src, float * dst, int n) {
+    auto p = reinterpret_cast<const uint8_t *>(src);
+    const int32x4_t bias = vdupq_n_s32(32768);
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const uint16x8_t v = vreinterpretq_u16_u8(vld1q_u8(p + 2*i));
+        const int32x4_t lo = vsubq_s32(vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(v))),  bias);
+        const int32x4_t hi = vsubq_s32(vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(v))), bias);
+        vst1q_f32(dst + i + 0, vmulq_n_f32(vcvtq_f32_s32(lo), 1.0f/32768));
+        vst1q_f32(dst + i + 4, vmulq_n_f32(vcvtq_f32_s32(hi), 1.0f/32768));
+    }
+
+    toF32_U16_scalar(p + 2*i, dst + i, n - i);
+}
+
+void toF32_I16_neon(const void * src, float * dst, int n) {
+    auto p = reinterpret_cast<const uint8_t *>(src);
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const int16x8_t v = vreinterpretq_s16_u8(vld1q_u8(p + 2*i));
+        vst1q_f32(dst + i + 0, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))),  1.0f/32768));
+        vst1q_f32(dst + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), 1.0f/32768));
+    }
+
+    toF32_I16_scalar(p + 2*i, dst + i, n - i);
+}
+
+inline float32x4_t clamp_neon(float32x4_t v, float lo, float hi) {
+    return vminq_f32(vmaxq_f32(v, vdupq_n_f32(lo)), vdupq_n_f32(hi));
+}
+
+void fromF32_U8_neon(const float * src, void * dst, int n) {
+    auto p = reinterpret_cast<uint8_t *>(dst);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const uint32x4_t a = vcvtq_u32_f32(clamp_neon(vmulq_n_f32(vaddq_f32(vld1q_f32(src + i + 0), one), 128.0f), 0.0f, 255.0f));
+        const uint32x4_t b = vcvtq_u32_f32(clamp_neon(vmulq_n_f32(vaddq_f32(vld1q_f32(src + i + 4), one), 128.0f), 0.0f, 255.0f));
+        vst1_u8(p + i, vmovn_u16(vcombine_u16(vmovn_u32(a), vmovn_u32(b))));
+    }
+
+    fromF32_U8_scalar(src + i, p + i, n - i);
+}
+
+void fromF32_I8_neon(const float * src, void * dst, int n) {
+    auto p = reinterpret_cast<int8_t *>(dst);
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const int32x4_t a = vcvtq_s32_f32(clamp_neon(vmulq_n_f32(vld1q_f32(src + i + 0), 128.0f), -128.0f, 127.0f));
+        const int32x4_t b = vcvtq_s32_f32(clamp_neon(vmulq_n_f32(vld1q_f32(src + i + 4), 128.0f), -128.0f, 127.0f));
+        vst1_s8(p + i, vmovn_s16(vcombine_s16(vmovn_s32(a), vmovn_s32(b))));
+    }
+
+    fromF32_I8_scalar(src + i, p + i, n - i);
+}
+
+void fromF32_U16_neon(const float * src, void * dst, int n) {
+    auto p = reinterpret_cast<uint8_t *>(dst);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const uint32x4_t a = vcvtq_u32_f32(clamp_neon(vmulq_n_f32(vaddq_f32(vld1q_f32(src + i + 0), one), 32768.0f), 0.0f, 65535.0f));
+        const uint32x4_t b = vcvtq_u32_f32(clamp_neon(vmulq_n_f32(vaddq_f32(vld1q_f32(src + i + 4), one), 32768.0f), 0.0f, 65535.0f));
+        vst1q_u8(p + 2*i, vreinterpretq_u8_u16(vcombine_u16(vmovn_u32(a), vmovn_u32(b))));
+    }
+
+    fromF32_U16_scalar(src + i, p + 2*i, n - i);
+}
+
+void fromF32_I16_neon(const float * src, void * dst, int n) {
+    auto p = reinterpret_cast<uint8_t *>(dst);
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const int32x4_t a = vcvtq_s32_f32(clamp_neon(vmulq_n_f32(vld1q_f32(src + i + 0), 32768.0f), -32768.0f, 32767.0f));
+        const int32x4_t b = vcvtq_s32_f32(clamp_neon(vmulq_n_f32(vld1q_f32(src + i + 4), 32768.0f), -32768.0f, 32767.0f));
+        vst1q_u8(p + 2*i, vreinterpretq_u8_s16(vcombine_s16(vmovn_s32(a), vmovn_s32(b))));
+    }
+
+    fromF32_I16_scalar(src + i, p + 2*i, n - i);
+}
+
+void powerSpectrum_neon(const float * src, float * dst, int n) {
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const float32x4x2_t v = vld2q_f32(src + 2*i);
+        vst1q_f32(dst + i, vaddq_f32(vmulq_f32(v.val[0], v.val[0]), vmulq_f32(v.val[1], v.val[1])));
+    }
+
+    powerSpectrum_scalar(src + 2*i, dst + i, n - i);
+}
+
+float maxValue_neon(const float * src, int n) {
+    float32x4_t m = vdupq_n_f32(0.0f);
+
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        m = vmaxq_f32(m, vld1q_f32(src + i));
+    }
+
+    float32x2_t r = vmax_f32(vget_low_f32(m), vget_high_f32(m));
+    r = vpmax_f32(r, r);
+
+    const float res  = vget_lane_f32(r, 0);
+    const float tail = maxValue_scalar(src + i, n - i);
+
+    return tail > res ? tail : res;
+}
+
+void quantizeU8_neon(const float * src, float scale, uint8_t * dst, int n) {
+    const float32x4_t half = vdupq_n_f32(0.5f);
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const uint32x4_t a = vcvtq_u32_f32(clamp_neon(vaddq_f32(vmulq_n_f32(vld1q_f32(src + i + 0), scale), half), 0.0f, 255.0f));
+        const uint32x4_t b = vcvtq_u32_f32(clamp_neon(vaddq_f32(vmulq_n_f32(vld1q_f32(src + i + 4), scale), half), 0.0f, 255.0f));
+        vst1_u8(dst + i, vmovn_u16(vcombine_u16(vmovn_u32(a), vmovn_u32(b))));
+    }
+
+    quantizeU8_scalar(src + i, scale, dst + i, n - i);
+}
+
+#if defined(__aarch64__)
+void argmax16U8_neon(const uint8_t * src, int stride, int n, uint8_t * dst) {
+    static const uint8_t kIndex[16] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 };
+    const uint8x16_t index = vld1q_u8(kIndex);
+
+    for (int k = 0; k < n; ++k, src += stride) {
+        const uint8x16_t v = vld1q_u8(src);
+        const uint8x16_t m = vceqq_u8(v, vdupq_n_u8(vmaxvq_u8(v)));
+
+        dst[k] = vmaxvq_u8(vandq_u8(m, index)) - 1;
+    }
+}
+#endif
+
+float dot_neon(const float * a, const float * b, int n) {
+    float32x4_t s0 = vdupq_n_f32(0.0f);
+    float32x4_t s1 = vdupq_n_f32(0.0f);
+
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        s0 = vmlaq_f32(s0, vld1q_f32(a + i + 0), vld1q_f32(b + i + 0));
+        s1 = vmlaq_f32(s1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+
+    const float32x4_t s = vaddq_f32(s0, s1);
+    float32x2_t r = vadd_f32(vget_low_f32(s), vget_high_f32(s));
+    r = vpadd_f32(r, r);
+
+    return vget_lane_f32(r, 0) + dot_scalar(a + i, b + i, n - i);
+}
+
+float blockEnergy_neon(const float * src, const float * re, const float * im, int blockSize, int nBlocks) {
+    float32x2_t res = vdup_n_f32(0.0f);
+
+    for (int b = 0; b < nBlocks; ++b, src += blockSize) {
+        float32x4_t sr = vdupq_n_f32(0.0f);
+        float32x4_t si = vdupq_n_f32(0.0f);
+        for (int i = 0; i < blockSize; i += 4) {
+            const float32x4_t x = vld1q_f32(src + i);
+            sr = vmlaq_f32(sr, x, vld1q_f32(re + i));
+            si = vmlaq_f32(si, x, vld1q_f32(im + i));
+        }
+
+        const float32x2_t s = vpadd_f32(vadd_f32(vget_low_f32(sr), vget_high_f32(sr)),
+                                        vadd_f32(vget_low_f32(si), vget_high_f32(si)));
+        res = vmla_f32(res, s, s);
+    }
+
+    return vget_lane_f32(res, 0) + vget_lane_f32(res, 1);
+}
+
+void firDecimate_neon(const float * src, const float * re, const float * im, int nTaps, int decimation, float * dst, int n) {
+    for (int m = 0; m < n; ++m, src += decimation) {
+        float32x4_t sr = vdupq_n_f32(0.0f);
+        float32x4_t si = vdupq_n_f32(0.0f);
+        for (int k = 0; k < nTaps; k += 4) {
+            const float32x4_t x = vld1q_f32(src + k);
+            sr = vmlaq_f32(sr, x, vld1q_f32(re + k));
+            si = vmlaq_f32(si, x, vld1q_f32(im + k));
+        }
+
+        vst1_f32(dst + 2*m, vpadd_f32(vadd_f32(vget_low_f32(sr), vget_high_f32(sr)),
+                                      vadd_f32(vget_low_f32(si), vget_high_f32(si))));
+    }
+}
+
+void deinterleave_neon(const float * src, float * re, float * im, int n) {
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const float32x4x2_t v = vld2q_f32(src + 2*i);
+        vst1q_f32(re + i, v.val[0]);
+        vst1q_f32(im + i, v.val[1]);
+    }
+
+    deinterleave_scalar(src + 2*i, re + i, im + i, n - i);
+}
+
+// (yr + i*yi)*(wr + i*wi) stored in (dr, di)
+inline void cmulStore_neon(float32x4_t yr, float32x4_t yi, const float * wr, const float * wi, float * dr, float * di) {
+    const float32x4_t cr = vld1q_f32(wr);
+    const float32x4_t ci = vld1q_f32(wi);
+    vst1q_f32(dr, vsubq_f32(vmulq_f32(yr, cr), vmulq_f32(yi, ci)));
+    vst1q_f32(di, vaddq_f32(vmulq_f32(yr, ci), vmulq_f32(yi, cr)));
+}
+
+void fftRadix2_neon(float * re, float * im, const float * tw, int n) {
+    const int h = n/2;
+    if (h < 4) {
+        fftRadix2_scalar(re, im, tw, n);
+        return;
+    }
+
+    for (int j = 0; j < h; j += 4) {
+        const float32x4_t ar = vld1q_f32(re + j), ai = vld1q_f32(im + j);
+        const float32x4_t br = vld1q_f32(re + j + h), bi = vld1q_f32(im + j + h);
+
+        vst1q_f32(re + j, vaddq_f32(ar, br));
+        vst1q_f32(im + j, vaddq_f32(ai, bi));
+
+        cmulStore_neon(vsubq_f32(ar, br), vsubq_f32(ai, bi), tw + j, tw + h + j, re + j + h, im + j + h);
+    }
+}
+
+inline void transpose4_neon(float32x4_t & a, float32x4_t & b, float32x4_t & c, float32x4_t & d) {
+    const float32x4x2_t ab = vtrnq_f32(a, b);
+    const float32x4x2_t cd = vtrnq_f32(c, d);
+    a = vcombine_f32(vget_low_f32 (ab.val[0]), vget_low_f32 (cd.val[0]));
+    b = vcombine_f32(vget_low_f32 (ab.val[1]), vget_low_f32 (cd.val[1]));
+    c = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+    d = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1]));
+}
+
+void fftRadix4_neon(float * re, float * im, const float * tw, int L, int n) {
+    const int q = L/4;
+
+    // last stage: the twiddle factors are 1 - transpose groups of 4 blocks to vectorise across the blocks
+    if (q == 1 && n >= 16) {
+        for (int b = 0; b < n; b += 16) {
+            float32x4_t a0r = vld1q_f32(re + b + 0), a1r = vld1q_f32(re + b + 4), a2r = vld1q_f32(re + b + 8), a3r = vld1q_f32(re + b + 12);
+            float32x4_t a0i = vld1q_f32(im + b + 0), a1i = vld1q_f32(im + b + 4), a2i = vld1q_f32(im + b + 8), a3i = vld1q_f32(im + b + 12);
+            transpose4_neon(a0r, a1r, a2r, a3r);
+            transpose4_neon(a0i, a1i, a2i, a3i);
+
+            const float32x4_t t0r = vaddq_f32(a0r, a2r), t0i = vaddq_f32(a0i, a2i);
+            const float32x4_t t1r = vsubq_f32(a0r, a2r), t1i = vsubq_f32(a0i, a2i);
+            const float32x4_t t2r = vaddq_f32(a1r, a3r), t2i = vaddq_f32(a1i, a3i);
+            const float32x4_t t3r = vsubq_f32(a1r, a3r), t3i = vsubq_f32(a1i, a3i);
+
+            float32x4_t y0r = vaddq_f32(t0r, t2r), y0i = vaddq_f32(t0i, t2i);
+            float32x4_t y1r = vaddq_f32(t1r, t3i), y1i = vsubq_f32(t1i, t3r);
+            float32x4_t y2r = vsubq_f32(t0r, t2r), y2i = vsubq_f32(t0i, t2i);
+            float32x4_t y3r = vsubq_f32(t1r, t3i), y3i = vaddq_f32(t1i, t3r);
+            transpose4_neon(y0r, y1r, y2r, y3r);
+            transpose4_neon(y0i, y1i, y2i, y3i);
+
+            vst1q_f32(re + b + 0, y0r); vst1q_f32(re + b + 4, y1r); vst1q_f32(re + b + 8, y2r); vst1q_f32(re + b + 12, y3r);
+            vst1q_f32(im + b + 0, y0i); vst1q_f32(im + b + 4, y1i); vst1q_f32(im + b + 8, y2i); vst1q_f32(im + b + 12, y3i);
+        }
+        return;
+    }
+
+    if (q < 4) {
+        fftRadix4_scalar(re, im, tw, L, n);
+        return;
+    }
+
+    for (int b = 0; b < n; b += L) {
+        float * xr = re + b;
+        float * xi = im + b;
+        for (int j = 0; j < q; j += 4) {
+            const float32x4_t a0r = vld1q_f32(xr + j + 0*q), a0i = vld1q_f32(xi + j + 0*q);
+            const float32x4_t a1r = vld1q_f32(xr + j + 1*q), a1i = vld1q_f32(xi + j + 1*q);
+            const float32x4_t a2r = vld1q_f32(xr + j + 2*q), a2i = vld1q_f32(xi + j + 2*q);
+            const float32x4_t a3r = vld1q_f32(xr + j + 3*q), a3i = vld1q_f32(xi + j + 3*q);
+
+            const float32x4_t t0r = vaddq_f32(a0r, a2r), t0i = vaddq_f32(a0i, a2i);
+            const float32x4_t t1r = vsubq_f32(a0r, a2r), t1i = vsubq_f32(a0i, a2i);
+            const float32x4_t t2r = vaddq_f32(a1r, a3r), t2i = vaddq_f32(a1i, a3i);
+            const float32x4_t t3r = vsubq_f32(a1r, a3r), t3i = vsubq_f32(a1i, a3i);
+
+            vst1q_f32(xr + j, vaddq_f32(t0r, t2r));
+            vst1q_f32(xi + j, vaddq_f32(t0i, t2i));
+
+            cmulStore_neon(vaddq_f32(t1r, t3i), vsubq_f32(t1i, t3r), tw + 0*q + j, tw + 1*q + j, xr + j + 1*q, xi + j + 1*q);
+            cmulStore_neon(vsubq_f32(t0r, t2r), vsubq_f32(t0i, t2i), tw + 2*q + j, tw + 3*q + j, xr + j + 2*q, xi + j + 2*q);
+            cmulStore_neon(vsubq_f32(t1r, t3i), vaddq_f32(t1i, t3r), tw + 4*q + j, tw + 5*q + j, xr + j + 3*q, xi + j + 3*q);
+        }
+    }
+}
+
+inline float32x4_t reverse_neon(float32x4_t v) {
+    const float32x4_t r = vrev64q_f32(v);
+    return vcombine_f32(vget_high_f32(r), vget_low_f32(r));
+}
+
+void fftRealPost_neon(const float * zr, const float * zi, const float * tw, float * dst, int N) {
+    const int M = N/2;
+
+    fftRealPostEdges(zr, zi, dst, N);
+
+    int k = 1;
+    for (; k + 4 <= M/2; k += 4) {
+        const float32x4_t ar = vld1q_f32(zr + k), ai = vld1q_f32(zi + k);
+        const float32x4_t br = reverse_neon(vld1q_f32(zr + M - k - 3));
+        const float32x4_t bi = reverse_neon(vld1q_f32(zi + M - k - 3));
+
+        const float32x4_t er = vmulq_n_f32(vaddq_f32(ar, br), 0.5f);
+        const float32x4_t ei = vmulq_n_f32(vsubq_f32(ai, bi), 0.5f);
+        const float32x4_t or_ = vmulq_n_f32(vaddq_f32(ai, bi), 0.5f);
+        const float32x4_t oi = vmulq_n_f32(vsubq_f32(br, ar), 0.5f);
+
+        const float32x4_t wr = vld1q_f32(tw + k);
+        const float32x4_t wi = vld1q_f32(tw + M/2 + k);
+
+        const float32x4_t tr = vaddq_f32(vmulq_f32(wr, or_), vmulq_f32(wi, oi));
+        const float32x4_t ti = vsubq_f32(vmulq_f32(wr, oi), vmulq_f32(wi, or_));
+
+        float32x4x2_t x;
+        x.val[0] = vaddq_f32(er, tr);
+        x.val[1] = vnegq_f32(vaddq_f32(ei, ti));
+        vst2q_f32(dst + 2*k, x);
+
+        float32x4x2_t y;
+        y.val[0] = reverse_neon(vsubq_f32(er, tr));
+        y.val[1] = reverse_neon(vsubq_f32(ei, ti));
+        vst2q_f32(dst + 2*(M - k - 3), y);
+    }
+
+    fftRealPostRange_scalar(zr, zi, tw, dst, N, k, M/2);
+}
+
+inline void goertzelStore_neon(float32x4_t s1, float32x4_t s2, const float * cs, const float * sn, float * dst) {
+    float32x4x2_t y;
+    y.val[0] = vsubq_f32(vmulq_f32(vld1q_f32(cs), s1), s2);
+    y.val[1] = vnegq_f32(vmulq_f32(vld1q_f32(sn), s1));
+    vst2q_f32(dst, y);
+}
+
+// four vectors of bins at a time, so that their recurrences hide the latency of each other
+void goertzel_neon(const float * src, int n, const float * cs, const float * sn, float * dst, int nBins) {
+    int k = 0;
+    for (; k + 16 <= nBins; k += 16) {
+        const float32x4_t c0 = vmulq_n_f32(vld1q_f32(cs + k +  0), 2.0f);
+        const float32x4_t c1 = vmulq_n_f32(vld1q_f32(cs + k +  4), 2.0f);
+        const float32x4_t c2 = vmulq_n_f32(vld1q_f32(cs + k +  8), 2.0f);
+        const float32x4_t c3 = vmulq_n_f32(vld1q_f32(cs + k + 12), 2.0f);
+
+        float32x4_t a0 = vdupq_n_f32(0.0f), b0 = vdupq_n_f32(0.0f);
+        float32x4_t a1 = vdupq_n_f32(0.0f), b1 = vdupq_n_f32(0.0f);
+        float32x4_t a2 = vdupq_n_f32(0.0f), b2 = vdupq_n_f32(0.0f);
+        float32x4_t a3 = vdupq_n_f32(0.0f), b3 = vdupq_n_f32(0.0f);
+        for (int i = 0; i < n; ++i) {
+            const float32x4_t x = vdupq_n_f32(src[i]);
+            const float32x4_t t0 = vaddq_f32(vsubq_f32(x, b0), vmulq_f32(c0, a0));
+            const float32x4_t t1 = vaddq_f32(vsubq_f32(x, b1), vmulq_f32(c1, a1));
+            const float32x4_t t2 = vaddq_f32(vsubq_f32(x, b2), vmulq_f32(c2, a2));
+            const float32x4_t t3 = vaddq_f32(vsubq_f32(x, b3), vmulq_f32(c3, a3));
+            b0 = a0; a0 = t0;
+            b1 = a1; a1 = t1;
+            b2 = a2; a2 = t2;
+            b3 = a3; a3 = t3;
+        }
+
+        goertzelStore_neon(a0, b0, cs + k +  0, sn + k +  0, dst + 2*k +  0);
+        goertzelStore_neon(a1, b1, cs + k +  4, sn + k +  4, dst + 2*k +  8);
+        goertzelStore_neon(a2, b2, cs + k +  8, sn + k +  8, dst + 2*k + 16);
+        goertzelStore_neon(a3, b3, cs + k + 12, sn + k + 12, dst + 2*k + 24);
+    }
+
+    for (; k + 4 <= nBins; k += 4) {
+        const float32x4_t c0 = vmulq_n_f32(vld1q_f32(cs + k), 2.0f);
+
+        float32x4_t a0 = vdupq_n_f32(0.0f), b0 = vdupq_n_f32(0.0f);
+        for (int i = 0; i < n; ++i) {
+            const float32x4_t t0 = vaddq_f32(vsubq_f32(vdupq_n_f32(src[i]), b0), vmulq_f32(c0, a0));
+            b0 = a0; a0 = t0;
+        }
+
+        goertzelStore_neon(a0, b0, cs + k, sn + k, dst + 2*k);
+    }
+
+    goertzel_scalar(src, n, cs + k, sn + k, dst + 2*k, nBins - k);
+}
+
+const SimdKernels kSimdKernelsNEON = {
+    "neon",
+    4,
+    { nullptr, toF32_U8_neon,   toF32_I8_neon,   toF32_U16_neon,   toF32_I16_neon,   toF32_F32   },
+    { nullptr, fromF32_U8_neon, fromF32_I8_neon, fromF32_U16_neon, fromF32_I16_neon, fromF32_F32 },
+    powerSpectrum_neon,
+    maxValue_neon,
+    quantizeU8_neon,
+#if defined(__aarch64__)
+    argmax16U8_neon,
+#else
+    argmax16U8_scalar,
+#endif
+    dot_neon,
+    blockEnergy_neon,
+    firDecimate_neon,
+    deinterleave_neon,
+    fftRadix2_neon,
+    fftRadix4_neon,
+    fftRealPost_neon,
+    goertzel_neon,
+};
+
+#endif
+
+//
+// Dispatch
+//
+
+// the kernels for the given instruction set, or nullptr if it is not available on this build / CPU
+const SimdKernels * simdKernels(SimdIsa isa) {
+    switch (isa) {
+        case kSimdScalar:
+            return &kSimdKernelsScalar;
+        case kSimdSSE2:
+#ifdef GGWAVE_SIMD_SSE2
+            return &kSimdKernelsSSE2;
+#else
+            break;
+#endif
+        case kSimdAVX2:
+#ifdef GGWAVE_SIMD_AVX2
+            if (__builtin_cpu_supports("avx2")) {
+                return &kSimdKernelsAVX2;
+            }
+#endif
+            break;
+        case kSimdNEON:
+#ifdef GGWAVE_SIMD_NEON
+            return &kSimdKernelsNEON;
+#else
+            break;
+#endif
+        case kSimdCount:
+            break;
+    }
+
+    return nullptr;
+}
+
+// the fastest kernels available on this CPU
+const SimdKernels & simdKernels() {
+    static const SimdKernels * best = []() {
+        for (int isa = kSimdCount - 1; isa > kSimdScalar; --isa) {
+            if (auto kernels = simdKernels(SimdIsa(isa))) {
+                return kernels;
+            }
+        }
+        return &kSimdKernelsScalar;
+    }();
+
+    return *best;
+}
+
+//
+// FFT
+//
+// Radix-4 decimation-in-frequency FFT of n complex values, stored as separate arrays of the real and imaginary
+// parts so that the stages vectorise across the butterflies. When log2(n) is odd, a radix-2 stage comes first.
+// The stages leave the spectrum in digit-reversed order, which the permutation tables undo. The FFT of N real
+// values is computed from the FFT of the N/2 complex values formed by the pairs of consecutive values.
+//
+// The tables for transforms of up to N real values, or N/2 complex values, with M = N/2:
+//
+//   perm[n, 2n)         - position of X[k] after the stages of the FFT of n complex values
+//   tw[5L/2, 4L)        - twiddle factors of the radix-4 stage of length L - see fftButterfly4_scalar()
+//   tw[4L, 5L)          - twiddle factors of the radix-2 stage of length L - see fftRadix2_scalar()
+//   tw[5M, 6M)          - cos(2*pi*k/N) and sin(2*pi*k/N) for k in [0, N/4), for the real FFT
+//
+
+inline int fftTableSizeI(int N) { return N; }
+inline int fftTableSizeF(int N) { return 3*N; }
+
+inline bool fftOddLog2(int n) {
+    int res = 0;
+    while (n > 1) {
+        n >>= 1;
+        res ^= 1;
+    }
+    return res;
+}
+
+inline void fftInit(int N, int * perm, float * tw) {
+    const int M = N/2;
+
+    for (int L = 4; L <= M; L *= 2) {
+        const int q = L/4;
+        for (int j = 0; j < q; ++j) {
+            for (int r = 1; r <= 3; ++r) {
+                const double phi = -2.0*M_PI*r*j/L;
+                tw[5*L/2 + (2*r - 2)*q + j] = cos(phi);
+                tw[5*L/2 + (2*r - 1)*q + j] = sin(phi);
+            }
+        }
+    }
+
+    for (int L = 2; L <= M; L *= 2) {
+        for (int j = 0; j < L/2; ++j) {
+            tw[4*L + j]       = cos(-2.0*M_PI*j/L);
+            tw[4*L + L/2 + j] = sin(-2.0*M_PI*j/L);
+        }
+    }
+
+    for (int k = 0; k < M/2; ++k) {
+        tw[5*M + k]       = cos(2.0*M_PI*k/N);
+        tw[5*M + M/2 + k] = sin(2.0*M_PI*k/N);
+    }
+
+    // each stage sorts the values of its blocks by the lowest remaining digit of k
+    for (int n = 1; n <= M; n *= 2) {
+        for (int p = 0; p < n; ++p) {
+            int k    = 0;
+            int base = 1;
+            int rem  = p;
+            for (int L = n; L > 1; ) {
+                const int radix = (L == n && fftOddLog2(n)) ? 2 : 4;
+                L /= radix;
+                k += (rem/L)*base;
+                rem %= L;
+                base *= radix;
+            }
+            perm[n + k] = p;
+        }
+    }
+}
+
+// the stages of the FFT of the n complex values (re, im), which leave X[k] at re[perm[n + k]], im[perm[n + k]]
+inline void fftStages(const SimdKernels & kernels, float * re, float * im, int n, const float * tw) {
+    int L = n;
+    if (fftOddLog2(n)) {
+        kernels.fftRadix2(re, im, tw + 4*L, n);
+        L /= 2;
+    }
+
+    for (; L >= 4; L /= 4) {
+        kernels.fftRadix4(re, im, tw + 5*L/2, L, n);
+    }
+}
+
+// in-place FFT of n interleaved complex values: X[k] = sum_j x[j]*exp(-2*pi*i*j*k/n)
+//   same result as cdft(2*n, -1, ...) in fft.h - work must hold 2*n floats
+inline void fftComplex(const SimdKernels & kernels, float * f, int n, const int * perm, const float * tw, float * work) {
+    float * re = work;
+    float * im = work + n;
+    kernels.deinterleave(f, re, im, n);
+
+    fftStages(kernels, re, im, n, tw);
+
+    perm += n;
+    for (int k = 0; k < n; ++k) {
+        f[2*k + 0] = re[perm[k]];
+        f[2*k + 1] = im[perm[k]];
+    }
+}
+
+// in-place FFT of N real values, in the same layout as rdft(N, 1, ...) in fft.h:
+//   f[2k] = R[k], f[2k + 1] = I[k] for 0 < k < N/2, f[0] = R[0], f[1] = R[N/2]
+//   where R[k] + i*I[k] = sum_j x[j]*exp(2*pi*i*j*k/N) - work must hold 2*N floats
+inline void fftReal(const SimdKernels & kernels, float * f, int N, const int * perm, const float * tw, float * work) {
+    const int M = N/2;
+
+    float * re = work;
+    float * im = work + M;
+    kernels.deinterleave(f, re, im, M);
+
+    fftStages(kernels, re, im, M, tw);
+
+    float * zr = work + 2*M;
+    float * zi = work + 3*M;
+
+    perm += M;
+    for (int k = 0; k < M; ++k) {
+        zr[k] = re[perm[k]];
+        zi[k] = im[perm[k]];
+    }
+
+    kernels.fftRealPost(zr, zi, tw + 5*M, f, N);
+}
+
+}
@@ -0,0 +1,710 @@
+#include "ggwave/ggwave.h"
+
+#include "simd.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+double getTime_s(const std::chrono::high_resolution_clock::time_point & t0) {
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - t0).count();
+}
+
+// payloads/sec of init() + encode() on a fresh instance vs a reused instance vs encodeBatch()
+void benchEncode() {
+    const int nPayloads = 64;
+    const auto protocolId = GGWAVE_PROTOCOL_AUDIBLE_FAST;
+
+    auto parameters = GGWave::getDefaultParameters();
+    parameters.operatingMode = GGWAVE_OPERATING_MODE_TX;
+    parameters.sampleFormatOut = GGWAVE_SAMPLE_FORMAT_I16;
+
+    std::vector<std::string> payloads(nPayloads);
+    for (int i = 0; i < nPayloads; ++i) {
+        payloads[i] = "payload-" + std::to_string(i) + "-0123456789";
+    }
+
+    printf("encode: %d payloads of %d bytes, protocol = %s\n",
+           nPayloads, (int) payloads[0].size(), GGWave::Protocols::kDefault()[protocolId].name);
+
+    {
+        const auto t0 = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < nPayloads; ++i) {
+            GGWave instance(parameters);
+            instance.init(payloads[i].size(), payloads[i].data(), protocolId, 25);
+            instance.encode();
+        }
+        const double dt = getTime_s(t0);
+        printf("  %-24s %10.1f payloads/sec\n", "new instance per payload", nPayloads/dt);
+    }
+
+    {
+        GGWave instance(parameters);
+
+        const auto t0 = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < nPayloads; ++i) {
+            instance.init(payloads[i].size(), payloads[i].data(), protocolId, 25);
+            instance.encode();
+        }
+        const double dt = getTime_s(t0);
+        printf("  %-24s %10.1f payloads/sec\n", "reused instance", nPayloads/dt);
+    }
+
+    std::vector<GGWave::EncodeItem> items(nPayloads);
+    for (int i = 0; i < nPayloads; ++i) {
+        items[i] = { payloads[i].data(), (int) payloads[i].size(), protocolId, 25, nullptr, 0, 0 };
+    }
+    GGWave::encodeBatch(parameters, items.data(), nPayloads, 1);
+
+    std::vector<std::vector<uint8_t>> outputs(nPayloads);
+    for (int i = 0; i < nPayloads; ++i) {
+        outputs[i].resize(items[i].nBytes);
+        items[i].output = outputs[i].data();
+        items[i].outputSize = items[i].nBytes;
+    }
+
+    const int nThreadsMax = std::max(1, (int) std::thread::hardware_concurrency());
+    for (int nThreads = 1; nThreads <= nThreadsMax; nThreads *= 2) {
+        const auto t0 = std::chrono::high_resolution_clock::now();
+        const int n = GGWave::encodeBatch(parameters, items.data(), nPayloads, nThreads);
+        const double dt = getTime_s(t0);
+        printf("  %-24s %10.1f payloads/sec (%d threads, %d ok)\n", "encodeBatch", nPayloads/dt, nThreads, n);
+    }
+}
+
+// time until the first audio buffer is available with encode() vs encodeBegin() + encodeNext()
+void benchEncodeStream() {
+    const int nRuns = 64;
+    const int nBufferSamples = 1024;
+    const auto protocolId = GGWAVE_PROTOCOL_AUDIBLE_FAST;
+    const std::string payload = "payload-0123456789";
+
+    auto parameters = GGWave::getDefaultParameters();
+    parameters.operatingMode = GGWAVE_OPERATING_MODE_TX;
+    parameters.sampleFormatOut = GGWAVE_SAMPLE_FORMAT_I16;
+
+    GGWave instance(parameters);
+
+    parameters.operatingMode |= GGWAVE_OPERATING_MODE_TX_STREAM;
+    GGWave instanceStream(parameters);
+
+    printf("encode-stream: %d bytes, protocol = %s, heap = %d bytes (stream = %d bytes)\n",
+           (int) payload.size(), GGWave::Protocols::kDefault()[protocolId].name, instance.heapSize(), instanceStream.heapSize());
+
+    std::vector<int16_t> buffer(nBufferSamples);
+
+    {
+        const auto t0 = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < nRuns; ++i) {
+            instance.init(payload.size(), payload.data(), protocolId, 25);
+            instance.encode();
+            memcpy(buffer.data(), instance.txWaveform(), nBufferSamples*sizeof(int16_t));
+        }
+        const double dt = getTime_s(t0);
+        printf("  %-24s %10.3f ms to first buffer\n", "encode", 1e3*dt/nRuns);
+    }
+
+    {
+        const auto t0 = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < nRuns; ++i) {
+            instanceStream.init(payload.size(), payload.data(), protocolId, 25);
+            instanceStream.encodeBegin();
+            instanceStream.encodeNext(buffer.data(), nBufferSamples);
+        }
+        const double dt = getTime_s(t0);
+        printf("  %-24s %10.3f ms to first buffer\n", "encodeBegin/encodeNext", 1e3*dt/nRuns);
+    }
+}
+
+// instances/sec of a new instance per session vs preparing the same instance again vs an external heap
+void benchPrepare() {
+    const int nRuns = 256;
+
+    auto parameters = GGWave::getDefaultParameters();
+    parameters.operatingMode = GGWAVE_OPERATING_MODE_RX;
+    parameters.sampleFormatInp = GGWAVE_SAMPLE_FORMAT_I16;
+
+    GGWave instance(parameters);
+
+    printf("prepare: Rx, heap = %d bytes\n", instance.heapSize());
+
+    {
+        const auto t0 = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < nRuns; ++i) {
+            GGWave session(parameters);
+        }
+        const double dt = getTime_s(t0);
+        printf("  %-24s %10.1f instances/sec\n", "new instance", nRuns/dt);
+    }
+
+    {
+        const auto t0 = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < nRuns; ++i) {
+            instance.prepare(parameters);
+        }
+        const double dt = getTime_s(t0);
+        printf("  %-24s %10.1f instances/sec\n", "prepare again", nRuns/dt);
+    }
+
+    {
+        std::vector<uint8_t> heapBlock(instance.heapSize() + GGWave::kHeapAlignment);
+        uint8_t * heap = heapBlock.data() + (-(uintptr_t) heapBlock.data() & (GGWave::kHeapAlignment - 1));
+
+        const auto t0 = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < nRuns; ++i) {
+            GGWave session;
+            session.prepare(parameters, heap, instance.heapSize());
+        }
+        const double dt = getTime_s(t0);
+        printf("  %-24s %10.1f instances/sec\n", "external heap", nRuns/dt);
+    }
+}
+
+// samples/sec of the sample format conversions for each available instruction set
+void benchConvert() {
+    const int n = 4096;
+    const int nRuns = 2000;
+
+    const char * kFormatNames[] = { "undefined", "U8", "I8", "U16", "I16", "F32" };
+
+    std::vector<float> samples(n);
+    for (int i = 0; i < n; ++i) {
+        samples[i] = sin(0.01f*i);
+    }
+    std::vector<uint8_t> raw(4*n);
+
+    printf("convert: %d samples per call, selected isa = %s\n", n, simdKernels().name);
+
+    for (int isa = 0; isa < kSimdCount; ++isa) {
+        const auto kernels = simdKernels(SimdIsa(isa));
+        if (kernels == nullptr) continue;
+
+        for (int format = GGWAVE_SAMPLE_FORMAT_U8; format <= GGWAVE_SAMPLE_FORMAT_F32; ++format) {
+            double dtFrom = 0.0;
+            {
+                const auto t0 = std::chrono::high_resolution_clock::now();
+                for (int i = 0; i < nRuns; ++i) {
+                    kernels->fromF32[format](samples.data(), raw.data(), n);
+                }
+                dtFrom = getTime_s(t0);
+            }
+
+            double dtTo = 0.0;
+            {
+                const auto t0 = std::chrono::high_resolution_clock::now();
+                for (int i = 0; i < nRuns; ++i) {
+                    kernels->toF32[format](raw.data(), samples.data(), n);
+                }
+                dtTo = getTime_s(t0);
+            }
+
+            printf("  %-6s %-4s %10.1f Msamples/sec from F32, %10.1f Msamples/sec to F32\n",
+                   kernels->name, kFormatNames[format], 1e-6*n*nRuns/dtFrom, 1e-6*n*nRuns/dtTo);
+        }
+    }
+}
+
+// transforms/sec of the FFT of N real values: the Ooura FFT and the radix-4 FFT for each available instruction set
+void benchFFT() {
+    const int nValues = 1 << 24;
+
+    printf("fft: real input, selected isa = %s\n", simdKernels().name);
+
+    for (int N = 256; N <= 4096; N *= 2) {
+        const int nRuns = nValues/N;
+
+        std::vector<float> src(N);
+        for (int i = 0; i < N; ++i) {
+            src[i] = sin(0.01f*i*i);
+        }
+        std::vector<float> dst(2*N);
+
+        {
+            std::vector<int>   wi(GGWave::computeFFTR(nullptr, nullptr, N, nullptr, nullptr), 0);
+            std::vector<float> wf(GGWave::computeFFTR(nullptr, nullptr, N, wi.data(), nullptr), 0.0f);
+            GGWave::computeFFTR(src.data(), dst.data(), N, wi.data(), wf.data());
+
+            const auto t0 = std::chrono::high_resolution_clock::now();
+            for (int i = 0; i < nRuns; ++i) {
+                GGWave::computeFFTR(src.data(), dst.data(), N, wi.data(), wf.data());
+            }
+            const double dt = getTime_s(t0);
+            printf("  N = %4d %-8s %10.1f kFFT/sec\n", N, "ooura", 1e-3*nRuns/dt);
+        }
+
+        std::vector<int>   perm(fftTableSizeI(N));
+        std::vector<float> tw(fftTableSizeF(N));
+        std::vector<float> work(2*N);
+        fftInit(N, perm.data(), tw.data());
+
+        for (int isa = 0; isa < kSimdCount; ++isa) {
+            const auto kernels = simdKernels(SimdIsa(isa));
+            if (kernels == nullptr) continue;
+
+            const auto t0 = std::chrono::high_resolution_clock::now();
+            for (int i = 0; i < nRuns; ++i) {
+                memcpy(dst.data(), src.data(), N*sizeof(float));
+                fftReal(*kernels, dst.data(), N, perm.data(), tw.data(), work.data());
+            }
+            const double dt = getTime_s(t0);
+            printf("  N = %4d %-8s %10.1f kFFT/sec\n", N, kernels->name, 1e-3*nRuns/dt);
+        }
+    }
+}
+
+// spectra/sec of the FFT with the power spectrum of all bins, and of the Goertzel bank for a single bin, one block
+// of four vectors and the band of a single audible protocol
+void benchGoertzel() {
+    const int N = GGWave::kDefaultSamplesPerFrame;
+    const int nRuns = (1 << 24)/N;
+
+    printf("goertzel: N = %d, selected isa = %s\n", N, simdKernels().name);
+
+    std::vector<float> src(N);
+    for (int i = 0; i < N; ++i) {
+        src[i] = sin(0.01f*i*i);
+    }
+
+    std::vector<float> cs(N/2), sn(N/2);
+    for (int k = 0; k < N/2; ++k) {
+        cs[k] = cos(2.0*M_PI*(40 + k)/N);
+        sn[k] = sin(2.0*M_PI*(40 + k)/N);
+    }
+
+    std::vector<int>   perm(fftTableSizeI(N));
+    std::vector<float> tw(fftTableSizeF(N));
+    std::vector<float> work(2*N);
+    fftInit(N, perm.data(), tw.data());
+
+    std::vector<float> dst(2*N), spectrum(N/2);
+
+    for (int isa = 0; isa < kSimdCount; ++isa) {
+        const auto kernels = simdKernels(SimdIsa(isa));
+        if (kernels == nullptr) continue;
+
+        {
+            const auto t0 = std::chrono::high_resolution_clock::now();
+            for (int i = 0; i < nRuns; ++i) {
+                memcpy(dst.data(), src.data(), N*sizeof(float));
+                fftReal(*kernels, dst.data(), N, perm.data(), tw.data(), work.data());
+                kernels->powerSpectrum(dst.data(), spectrum.data(), N/2);
+            }
+            const double dt = getTime_s(t0);
+            printf("  %-6s %-12s %10.1f k/sec\n", kernels->name, "fft", 1e-3*nRuns/dt);
+        }
+
+        for (const int nBins : { 1, 4*kernels->lanes, 96 }) {
+            const auto t0 = std::chrono::high_resolution_clock::now();
+            for (int i = 0; i < nRuns; ++i) {
+                kernels->goertzel(src.data(), N, cs.data(), sn.data(), dst.data(), nBins);
+                kernels->powerSpectrum(dst.data(), spectrum.data(), nBins);
+            }
+            const double dt = getTime_s(t0);
+            printf("  %-6s goertzel %3d %10.1f k/sec\n", kernels->name, nBins, 1e-3*nRuns/dt);
+        }
+    }
+}
+
+// frames/sec of decode() with fixed-length payloads, with all Rx protocols enabled
+//   "signal" repeats a transmission back to back, "noise" feeds low-level white noise
+void benchDecodeFixed() {
+    const int nFrames = 16384;
+    const auto protocolId = GGWAVE_PROTOCOL_AUDIBLE_FAST;
+    const std::string payload = "0123456789abcdef";
+
+    auto parameters = GGWave::getDefaultParameters();
+    parameters.payloadLength = payload.size();
+    parameters.sampleFormatInp = GGWAVE_SAMPLE_FORMAT_F32;
+    parameters.sampleFormatOut = GGWAVE_SAMPLE_FORMAT_F32;
+
+    GGWave instance(parameters);
+    instance.init(payload.size(), payload.data(), protocolId, 25);
+    const int nBytes = instance.encode();
+
+    std::vector<float> signal(nBytes/sizeof(float));
+    memcpy(signal.data(), instance.txWaveform(), nBytes);
+
+    std::vector<float> noise(signal.size());
+    for (auto & v : noise) {
+        v = 0.01f*(float(rand())/RAND_MAX - 0.5f);
+    }
+
+    const int samplesPerFrame = instance.samplesPerFrame();
+    const int nFramesWaveform = signal.size()/samplesPerFrame;
+
+    printf("decode-fixed: %d frames, payload length = %d, protocol = %s\n",
+           nFrames, (int) payload.size(), GGWave::Protocols::kDefault()[protocolId].name);
+
+    for (const auto & input : { std::make_pair("signal", &signal), std::make_pair("noise", &noise) }) {
+        int nDecoded = 0;
+        GGWave::TxRxData result;
+
+        const auto t0 = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < nFrames; ++i) {
+            instance.decode(input.second->data() + (i % nFramesWaveform)*samplesPerFrame, samplesPerFrame*sizeof(float));
+            if (instance.rxTakeData(result) > 0) {
+                ++nDecoded;
+            }
+        }
+        const double dt = getTime_s(t0);
+
+        printf("  %-24s %10.1f frames/sec (%d payloads decoded)\n", input.first, nFrames/dt, nDecoded);
+    }
+}
+
+// frames/sec of decode() on background noise with and without the energy gate, next to the cost of converting
+// the input samples alone
+void benchEnergyGate() {
+    const int nFrames = 16384;
+    const int samplesPerFrame = GGWave::kDefaultSamplesPerFrame;
+
+    std::vector<int16_t> noise(nFrames*samplesPerFrame);
+    for (auto & v : noise) {
+        v = 300.0f*(float(rand())/RAND_MAX - 0.5f);
+    }
+
+    // with silence the gate stays closed - the cost of a skipped frame
+    const std::vector<int16_t> silence(nFrames*samplesPerFrame, 0);
+
+    printf("energy-gate: %d frames of noise or silence, I16 input\n", nFrames);
+
+    {
+        std::vector<float> output(samplesPerFrame);
+
+        const auto t0 = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < nFrames; ++i) {
+            ::simdKernels().toF32[GGWAVE_SAMPLE_FORMAT_I16](noise.data() + i*samplesPerFrame, output.data(), samplesPerFrame);
+        }
+        const double dt = getTime_s(t0);
+
+        printf("  %-24s %10.1f frames/sec\n", "convert only", nFrames/dt);
+    }
+
+    for (const int payloadLength : { -1, 16 }) {
+        for (const int mode : { 0, 1, 2 }) {
+            const bool useGate   = mode > 0;
+            const bool isSilence = mode == 2;
+
+            auto parameters = GGWave::getDefaultParameters();
+            parameters.payloadLength = payloadLength;
+            parameters.sampleFormatInp = GGWAVE_SAMPLE_FORMAT_I16;
+            if (useGate) {
+                parameters.operatingMode |= GGWAVE_OPERATING_MODE_RX_ENERGY_GATE;
+            }
+
+            GGWave instance(parameters);
+
+            const auto & input = isSilence ? silence : noise;
+
+            const auto t0 = std::chrono::high_resolution_clock::now();
+            for (int i = 0; i < nFrames; ++i) {
+                instance.decode(input.data() + i*samplesPerFrame, samplesPerFrame*sizeof(int16_t));
+            }
+            const double dt = getTime_s(t0);
+
+            const std::string name = std::string(payloadLength > 0 ? "fixed" : "variable") + (useGate ? ", gate" : "") + (isSilence ? ", silence" : "");
+            printf("  %-24s %10.1f frames/sec (%d frames skipped)\n", name.c_str(), nFrames/dt, instance.rxFramesSkipped());
+        }
+    }
+}
+
+// frames/sec of decode() on background noise while listening for variable-length payloads, with the spectrum of every
+// kMaxSpectrumHistory frames and with the incremental marker bins, for the audible and for all the default protocols
+void benchMarkers() {
+    const int nFrames = 16384;
+    const int samplesPerFrame = GGWave::kDefaultSamplesPerFrame;
+
+    std::vector<int16_t> noise(nFrames*samplesPerFrame);
+    for (auto & v : noise) {
+        v = 300.0f*(float(rand())/RAND_MAX - 0.5f);
+    }
+
+    printf("markers: %d frames of noise, I16 input\n", nFrames);
+
+    for (const bool isAudible : { true, false }) {
+        if (isAudible) {
+            GGWave::Protocols::rx().only(GGWAVE_PROTOCOL_AUDIBLE_NORMAL);
+            GGWave::Protocols::rx().toggle(GGWAVE_PROTOCOL_AUDIBLE_FAST, true);
+            GGWave::Protocols::rx().toggle(GGWAVE_PROTOCOL_AUDIBLE_FASTEST, true);
+        }
+
+        for (const bool useIncremental : { false, true }) {
+            auto parameters = GGWave::getDefaultParameters();
+            parameters.sampleFormatInp = GGWAVE_SAMPLE_FORMAT_I16;
+            if (useIncremental) {
+                parameters.operatingMode |= GGWAVE_OPERATING_MODE_RX_INCREMENTAL_MARKERS;
+            }
+
+            GGWave instance(parameters);
+
+            const auto t0 = std::chrono::high_resolution_clock::now();
+            for (int i = 0; i < nFrames; ++i) {
+                instance.decode(noise.data() + i*samplesPerFrame, samplesPerFrame*sizeof(int16_t));
+            }
+            const double dt = getTime_s(t0);
+
+            const std::string name = std::string(isAudible ? "audible" : "all") + (useIncremental ? ", incremental" : "");
+            printf("  %-28s %10.1f frames/sec\n", name.c_str(), nFrames/dt);
+        }
+
+        GGWave::Protocols::rx() = GGWave::Protocols::kDefault();
+    }
+}
+
+// frames/sec of decode() on background noise and heap size with and without the decimating front end, for the
+// audible and for the DT protocols
+void benchDecimate() {
+    const int nFrames = 16384;
+    const int samplesPerFrame = GGWave::kDefaultSamplesPerFrame;
+
+    std::vector<int16_t> noise(nFrames*samplesPerFrame);
+    for (auto & v : noise) {
+        v = 300.0f*(float(rand())/RAND_MAX - 0.5f);
+    }
+
+    printf("decimate: %d frames of noise, I16 input\n", nFrames);
+
+    for (const bool isDT : { false, true }) {
+        if (isDT) {
+            GGWave::Protocols::rx().only(GGWAVE_PROTOCOL_DT_NORMAL);
+            GGWave::Protocols::rx().toggle(GGWAVE_PROTOCOL_DT_FAST, true);
+            GGWave::Protocols::rx().toggle(GGWAVE_PROTOCOL_DT_FASTEST, true);
+        } else {
+            GGWave::Protocols::rx().only(GGWAVE_PROTOCOL_AUDIBLE_NORMAL);
+            GGWave::Protocols::rx().toggle(GGWAVE_PROTOCOL_AUDIBLE_FAST, true);
+            GGWave::Protocols::rx().toggle(GGWAVE_PROTOCOL_AUDIBLE_FASTEST, true);
+        }
+
+        for (const int payloadLength : { -1, 16 }) {
+            for (const bool useDecimate : { false, true }) {
+                auto parameters = GGWave::getDefaultParameters();
+                parameters.payloadLength = payloadLength;
+                parameters.sampleFormatInp = GGWAVE_SAMPLE_FORMAT_I16;
+                if (useDecimate) {
+                    parameters.operatingMode |= GGWAVE_OPERATING_MODE_RX_DECIMATE;
+                }
+
+                GGWave instance(parameters);
+
+                const auto t0 = std::chrono::high_resolution_clock::now();
+                for (int i = 0; i < nFrames; ++i) {
+                    instance.decode(noise.data() + i*samplesPerFrame, samplesPerFrame*sizeof(int16_t));
+                }
+                const double dt = getTime_s(t0);
+
+                const std::string name = std::string(isDT ? "dt" : "audible") + (payloadLength > 0 ? ", fixed" : ", variable") + (useDecimate ? ", decimate" : "");
+                printf("  %-28s %10.1f frames/sec, heap %d bytes\n", name.c_str(), nFrames/dt, instance.heapSize());
+            }
+        }
+    }
+
+    GGWave::Protocols::rx() = GGWave::Protocols::kDefault();
+}
+
+// frames/sec of decode() on background noise captured at 44.1 and 16 kHz - resampled to the default sample rate with
+// the sinc and the polyphase resamplers, or received at the native rate with only the audible protocols enabled
+void benchNativeRate() {
+    const int nFrames = 2048;
+    const int samplesPerFrame = GGWave::kDefaultSamplesPerFrame;
+
+    std::vector<int16_t> noise(nFrames*samplesPerFrame);
+    for (auto & v : noise) {
+        v = 300.0f*(float(rand())/RAND_MAX - 0.5f);
+    }
+
+    printf("native-rate: %d frames of noise, I16 input\n", nFrames);
+
+    GGWave::Protocols::rx().only(GGWAVE_PROTOCOL_AUDIBLE_NORMAL);
+    GGWave::Protocols::rx().toggle(GGWAVE_PROTOCOL_AUDIBLE_FAST, true);
+    GGWave::Protocols::rx().toggle(GGWAVE_PROTOCOL_AUDIBLE_FASTEST, true);
+
+    for (const float sampleRate : { 44100.0f, 16000.0f }) {
+        for (const int mode : { 0, (int) GGWAVE_OPERATING_MODE_RESAMPLER_POLYPHASE, (int) GGWAVE_OPERATING_MODE_RX_NATIVE_RATE }) {
+            auto parameters = GGWave::getDefaultParameters();
+            parameters.sampleRateInp = sampleRate;
+            parameters.sampleFormatInp = GGWAVE_SAMPLE_FORMAT_I16;
+            parameters.operatingMode |= mode;
+
+            GGWave instance(parameters);
+
+            const int nSamples = (nFrames - 1)*samplesPerFrame*(sampleRate/GGWave::kDefaultSampleRate);
+
+            const auto t0 = std::chrono::high_resolution_clock::now();
+            for (int i = 0; i + samplesPerFrame <= nSamples; i += samplesPerFrame) {
+                instance.decode(noise.data() + i, samplesPerFrame*sizeof(int16_t));
+            }
+            const double dt = getTime_s(t0);
+
+            const char * name = mode == 0 ? "sinc" : mode == GGWAVE_OPERATING_MODE_RESAMPLER_POLYPHASE ? "polyphase" : "native";
+            printf("  %5.0f Hz %-16s %10.1f frames/sec\n", sampleRate, name, (nSamples/(sampleRate/GGWave::kDefaultSampleRate))/samplesPerFrame/dt);
+        }
+    }
+
+    GGWave::Protocols::rx() = GGWave::Protocols::kDefault();
+}
+
+// latency of the analysis of the captured data - the longest decode() call while receiving a variable-length payload
+void benchDecodeVariable() {
+    const std::string payload = "0123456789abcdef";
+
+    auto parameters = GGWave::getDefaultParameters();
+    parameters.sampleFormatInp = GGWAVE_SAMPLE_FORMAT_F32;
+    parameters.sampleFormatOut = GGWAVE_SAMPLE_FORMAT_F32;
+
+    printf("decode-variable: payload length = %d\n", (int) payload.size());
+
+    for (int protocolId = GGWAVE_PROTOCOL_AUDIBLE_NORMAL; protocolId <= GGWAVE_PROTOCOL_ULTRASOUND_FASTEST; ++protocolId) {
+        GGWave instance(parameters);
+        instance.init(payload.size(), payload.data(), GGWave::ProtocolId(protocolId), 25);
+        const int nBytes = instance.encode();
+
+        const int samplesPerFrame = instance.samplesPerFrame();
+
+        // start in the middle of a frame and leave enough silence for the end of the recording
+        std::vector<float> signal(nBytes/sizeof(float) + 64*samplesPerFrame);
+        memcpy(signal.data() + samplesPerFrame/3, instance.txWaveform(), nBytes);
+        for (auto & v : signal) {
+            v += 0.01f*(float(rand())/RAND_MAX - 0.5f);
+        }
+
+        int nDecoded = 0;
+        double dtMax = 0.0;
+        GGWave::TxRxData result;
+
+        for (int i = 0; i + samplesPerFrame <= (int) signal.size(); i += samplesPerFrame) {
+            const auto t0 = std::chrono::high_resolution_clock::now();
+            instance.decode(signal.data() + i, samplesPerFrame*sizeof(float));
+            dtMax = std::max(dtMax, getTime_s(t0));
+
+            if (instance.rxTakeData(result) > 0) {
+                ++nDecoded;
+            }
+        }
+
+        printf("  %-24s %10.2f ms (%d payloads decoded)\n", GGWave::Protocols::kDefault()[protocolId].name, 1e3*dtMax, nDecoded);
+    }
+}
+
+// SNR of a resampled sine tone and Msamples/sec of the output, for both resampler engines
+//   the SNR is measured against the least-squares fit of a sine at the tone frequency
+void benchResample() {
+    const int nChunk = 1024;
+    const int nChunks = 256;
+    const double freq_hz = 4000.0;
+
+    struct Conversion {
+        float rateInp;
+        float rateOut;
+    };
+
+    const Conversion conversions[] = {
+        { 44100.0f, 48000.0f }, // Rx from 44.1 kHz
+        { 16000.0f, 48000.0f }, // Rx from 16 kHz
+        { 48000.0f, 44100.0f }, // Tx to 44.1 kHz
+    };
+
+    const std::pair<const char *, GGWave::Resampler::Engine> engines[] = {
+        { "sinc",      GGWave::Resampler::kEngineSinc },
+        { "polyphase", GGWave::Resampler::kEnginePolyphase },
+    };
+
+    printf("resample: %d chunks of %d samples, tone = %g Hz\n", nChunks, nChunk, freq_hz);
+
+    for (const auto & conversion : conversions) {
+        const float factor = conversion.rateInp/conversion.rateOut;
+
+        std::vector<float> input(nChunk*nChunks);
+        for (int i = 0; i < (int) input.size(); ++i) {
+            input[i] = 0.5*sin(2.0*M_PI*freq_hz*i/conversion.rateInp);
+        }
+
+        for (const auto & engine : engines) {
+            GGWave::Resampler resampler;
+
+            int heapSize = 0;
+            resampler.alloc(nullptr, heapSize, engine.second);
+            std::vector<char> heap(heapSize);
+            heapSize = 0;
+            resampler.alloc(heap.data(), heapSize, engine.second);
+
+            std::vector<float> output(input.size()/factor + 4*nChunks + 1);
+
+            const auto t0 = std::chrono::high_resolution_clock::now();
+            int nOutput = 0;
+            for (int i = 0; i < nChunks; ++i) {
+                nOutput += resampler.resample(factor, nChunk, input.data() + i*nChunk, output.data() + nOutput);
+            }
+            const double dt = getTime_s(t0);
+
+            // skip the filter delay and the edges of the tone
+            const int i0 = 4*GGWave::Resampler::kWidth/factor;
+            const int i1 = nOutput - i0;
+
+            double ss = 0.0, sc = 0.0;
+            for (int i = i0; i < i1; ++i) {
+                ss += output[i]*sin(2.0*M_PI*freq_hz*i/conversion.rateOut);
+                sc += output[i]*cos(2.0*M_PI*freq_hz*i/conversion.rateOut);
+            }
+            ss *= 2.0/(i1 - i0);
+            sc *= 2.0/(i1 - i0);
+
+            double power = 0.0, noise = 0.0;
+            for (int i = i0; i < i1; ++i) {
+                const double fit = ss*sin(2.0*M_PI*freq_hz*i/conversion.rateOut) + sc*cos(2.0*M_PI*freq_hz*i/conversion.rateOut);
+                power += fit*fit;
+                noise += (output[i] - fit)*(output[i] - fit);
+            }
+
+            printf("  %5.0f -> %5.0f Hz %-10s SNR = %6.1f dB, %8.2f Msamples/sec\n",
+                   conversion.rateInp, conversion.rateOut, engine.first, 10.0*log10(power/noise), 1e-6*nOutput/dt);
+        }
+    }
+}
+
+struct Bench {
+    const char * name;
+    void (*run)();
+};
+
+const Bench kBenches[] = {
+    { "encode",          benchEncode },
+    { "encode-stream",   benchEncodeStream },
+    { "convert",         benchConvert },
+    { "fft",             benchFFT },
+    { "goertzel",        benchGoertzel },
+    { "prepare",         benchPrepare },
+    { "decode-fixed",    benchDecodeFixed },
+    { "decode-variable", benchDecodeVariable },
+    { "energy-gate",     benchEnergyGate },
+    { "markers",         benchMarkers },
+    { "decimate",        benchDecimate },
+    { "native-rate",     benchNativeRate },
+    { "resample",        benchResample },
+};
+
+}
+
+int main(int argc, char ** argv) {
+    printf("Usage: %s [name]\n", argv[0]);
+    printf("    name - run only the benchmark with this name\n");
+    printf("\n");
+
+    for (const auto & bench : kBenches) {
+        if (argc > 1 && strcmp(argv[1], bench.name) != 0) {
+            continue;
+        }
+
+        bench.run();
+        printf("\n");
+    }
+
+    return 0;
+}
@@ -71,6 +71,95 @@ int main() {
     decoded[ret] = 0; // null-terminate the received data
     CHECK(strcmp(decoded, payload) == 0);
 
+    // streaming encode in chunks of 1000 samples
+    {
+        char *waveformStream = malloc(n);
+        CHECK(waveformStream != NULL);
+
+        ret = ggwave_encodeBegin(instance, payload, 4, GGWAVE_PROTOCOL_AUDIBLE_FASTEST, 50);
+        CHECK(ret == 0);
+
+        int nStream = 0;
+        while ((ret = ggwave_encodeNext(instance, waveformStream + nStream, 1000)) > 0) {
+            nStream += ret*2;
+        }
+
+        CHECK(nStream == ne);
+        CHECK(memcmp(waveformStream, waveform, ne) == 0);
+
+        free(waveformStream);
+    }
+
+    // more instances than the old limit of 4, ids of freed instances are not reused
+    {
+        ggwave_Parameters parametersTx = parameters;
+        parametersTx.operatingMode = GGWAVE_OPERATING_MODE_TX | GGWAVE_OPERATING_MODE_TX_STREAM;
+
+        ggwave_Instance instances[64];
+        for (int i = 0; i < 64; ++i) {
+            instances[i] = ggwave_init(parametersTx);
+            CHECK(instances[i] >= 0);
+            CHECK(instances[i] != instance);
+            CHECK(ggwave_object(instances[i]) != NULL);
+        }
+
+        const ggwave_Instance stale = instances[10];
+        ggwave_free(stale);
+        CHECK(ggwave_object(stale) == NULL);
+        CHECK(ggwave_encodeBegin(stale, payload, 4, GGWAVE_PROTOCOL_AUDIBLE_FASTEST, 50) == -1);
+        CHECK(ggwave_rxFramesSkipped(stale) == -1);
+
+        instances[10] = ggwave_init(parametersTx);
+        CHECK(instances[10] >= 0);
+        CHECK(instances[10] != stale);
+        CHECK(ggwave_object(stale) == NULL);
+
+        for (int i = 0; i < 64; ++i) {
+            ggwave_free(instances[i]);
+        }
+    }
+
+    // a slot is retired instead of wrapping its generation around, so a stale id never comes back
+    {
+        ggwave_Parameters parametersTx = parameters;
+        parametersTx.operatingMode = GGWAVE_OPERATING_MODE_TX | GGWAVE_OPERATING_MODE_TX_ONLY_TONES;
+
+        const ggwave_Instance first = ggwave_init(parametersTx);
+        CHECK(first >= 0);
+        ggwave_free(first);
+
+        ggwave_Instance last = first;
+        for (int i = 0; i < 32768; ++i) {
+            last = ggwave_init(parametersTx);
+            CHECK(last >= 0);
+            CHECK(last != first);
+            CHECK(ggwave_object(first) == NULL);
+            ggwave_free(last);
+        }
+
+        CHECK((last & (GGWAVE_MAX_INSTANCES - 1)) != (first & (GGWAVE_MAX_INSTANCES - 1)));
+    }
+
+    // opaque pointer interface
+    {
+        ggwave_Object * object = ggwave_objectInit(parameters);
+        CHECK(object != NULL);
+
+        ret = ggwave_objectEncode(object, payload, 4, GGWAVE_PROTOCOL_AUDIBLE_FASTEST, 50, waveform, 0);
+        CHECK(ret == ne);
+
+        ret = ggwave_objectNDecode(object, waveform, ne, decoded, 4);
+        CHECK(ret == 4);
+        CHECK(memcmp(decoded, payload, 4) == 0);
+        CHECK(ggwave_objectRxFramesSkipped(object) == 0);
+
+        ggwave_objectFree(object);
+
+        CHECK(ggwave_object(instance) != NULL);
+        ret = ggwave_objectNDecode(ggwave_object(instance), waveform, ne, decoded, 4);
+        CHECK(ret == 4);
+    }
+
     ggwave_free(instance);
     free(waveform);
 
@@ -1,5 +1,8 @@
 #include "ggwave/ggwave.h"
 
+#include "simd.h"
+
+#include <cmath>
 #include <cstring>
 #include <limits>
 #include <string>
@@ -238,10 +241,1118 @@ int main(int argc, char ** argv) {
                 CHECK(payload[i] == result[i]);
             }
         }
+
+        // decode at the capture sample rate - the band of the Rx protocols is fixed upon preparation
+        {
+            GGWave::Protocols::rx().only(GGWAVE_PROTOCOL_DT_FASTEST);
+
+            parameters.operatingMode |= GGWAVE_OPERATING_MODE_RX_NATIVE_RATE;
+            GGWave instanceInp(parameters);
+            CHECK(instanceInp.rxNativeRate());
+            CHECK(instanceInp.rxDecimation() > 1);
+
+            instanceInp.decode(buffer.data(), buffer.size());
+
+            GGWave::TxRxData result;
+            CHECK(instanceInp.rxTakeData(result) == (int) payload.size());
+            for (int i = 0; i < (int) payload.size(); ++i) {
+                CHECK(payload[i] == result[i]);
+            }
+
+            GGWave::Protocols::rx() = GGWave::Protocols::kDefault();
+            parameters.operatingMode &= ~GGWAVE_OPERATING_MODE_RX_NATIVE_RATE;
+        }
+
+        // audible protocol at the native rate - falls back to the resampler when its band does not fit below
+        // half of the capture sample rate
+        {
+            const auto & protocol = GGWave::Protocols::kDefault()[GGWAVE_PROTOCOL_AUDIBLE_FASTEST];
+            const bool isFit = 2*(protocol.freqStart + 32*protocol.bytesPerTx)*GGWave::kDefaultSampleRate <= GGWave::kDefaultSamplesPerFrame*srInp;
+
+            parameters.sampleRateOut = srInp;
+            GGWave instanceOut(parameters);
+
+            instanceOut.init(payload.c_str(), GGWAVE_PROTOCOL_AUDIBLE_FASTEST, 25);
+            const auto nBytes = instanceOut.encode();
+            { auto p = (const uint8_t *)(instanceOut.txWaveform()); buffer.resize(nBytes); memcpy(buffer.data(), p, nBytes); }
+            convertHelper(parameters.sampleFormatOut, parameters.sampleFormatInp);
+
+            GGWave::Protocols::rx().only(GGWAVE_PROTOCOL_AUDIBLE_FASTEST);
+
+            parameters.sampleRateInp = srInp;
+            parameters.operatingMode |= GGWAVE_OPERATING_MODE_RX_NATIVE_RATE;
+            GGWave instanceInp(parameters);
+            CHECK(instanceInp.rxNativeRate() == isFit);
+
+            if (isFit) {
+                instanceInp.decode(buffer.data(), buffer.size());
+
+                GGWave::TxRxData result;
+                CHECK(instanceInp.rxTakeData(result) == (int) payload.size());
+                for (int i = 0; i < (int) payload.size(); ++i) {
+                    CHECK(payload[i] == result[i]);
+                }
+            }
+
+            GGWave::Protocols::rx() = GGWave::Protocols::kDefault();
+        }
     }
 
     const std::string payload = "a0Z5kR2g";
 
+    // early stop must decode variable-length transmissions without waiting for the end marker
+    for (int protocolId = 0; protocolId < GGWAVE_PROTOCOL_COUNT; ++protocolId) {
+        const auto & protocol = GGWave::Protocols::kDefault()[protocolId];
+        if (protocol.enabled == false || protocol.extra == 2) continue;
+        printf("Testing: early stop, protocol = %s\n", protocol.name);
+
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.sampleFormatInp = GGWAVE_SAMPLE_FORMAT_F32;
+        parameters.sampleFormatOut = GGWAVE_SAMPLE_FORMAT_F32;
+        parameters.operatingMode |= GGWAVE_OPERATING_MODE_RX_EARLY_STOP;
+        GGWave instance(parameters);
+
+        instance.init(payload.size(), payload.data(), GGWave::ProtocolId(protocolId), 25);
+        const int nSamples = instance.encode()/sizeof(float);
+        const int samplesPerFrame = instance.samplesPerFrame();
+
+        // drop the end marker and append silence
+        std::vector<float> waveform(nSamples + 64*samplesPerFrame);
+        memcpy(waveform.data(), instance.txWaveform(), (nSamples - GGWave::kDefaultMarkerFrames*samplesPerFrame)*sizeof(float));
+
+        int nFrames = 0;
+        int nDecoded = 0;
+        GGWave::TxRxData result;
+        for (int i = 0; i + samplesPerFrame <= (int) waveform.size() && nDecoded == 0; i += samplesPerFrame) {
+            instance.decode(waveform.data() + i, samplesPerFrame*sizeof(float));
+            nDecoded = instance.rxTakeData(result);
+            ++nFrames;
+        }
+
+        CHECK(nFrames < nSamples/samplesPerFrame);
+        CHECK(nDecoded == (int) payload.size());
+        for (int i = 0; i < (int) payload.size(); ++i) {
+            CHECK(payload[i] == result[i]);
+        }
+    }
+
+    // incremental markers - the start marker is checked on every frame, so it is detected no later than with the
+    // spectrum of every kMaxSpectrumHistory frames, and the transmission decodes the same
+    {
+        int nSooner = 0;
+        for (int protocolId = 0; protocolId < GGWAVE_PROTOCOL_COUNT; ++protocolId) {
+            const auto & protocol = GGWave::Protocols::kDefault()[protocolId];
+            if (protocol.enabled == false || protocol.extra == 2) continue;
+            printf("Testing: incremental markers, protocol = %s\n", protocol.name);
+
+            auto parameters = GGWave::getDefaultParameters();
+            parameters.sampleFormatInp = GGWAVE_SAMPLE_FORMAT_F32;
+            parameters.sampleFormatOut = GGWAVE_SAMPLE_FORMAT_F32;
+            GGWave reference(parameters);
+
+            parameters.operatingMode |= GGWAVE_OPERATING_MODE_RX_INCREMENTAL_MARKERS;
+            GGWave instance(parameters);
+
+            instance.init(payload.size(), payload.data(), GGWave::ProtocolId(protocolId), 25);
+            const auto nBytes = instance.encode();
+            const int samplesPerFrame = instance.samplesPerFrame();
+            {
+                auto p = (const uint8_t *)(instance.txWaveform());
+                buffer.assign((8*samplesPerFrame + 300)*sizeof(float), 0);
+                buffer.insert(buffer.end(), p, p + nBytes);
+                buffer.insert(buffer.end(), 16*samplesPerFrame*sizeof(float), 0);
+            }
+            addNoiseHelper(0.02, parameters.sampleFormatOut);
+
+            const int frameSize = samplesPerFrame*sizeof(float);
+
+            int frameReference = -1;
+            int frame = -1;
+            int nDecoded = 0;
+            GGWave::TxRxData result;
+            for (int i = 0; (i + 1)*frameSize <= (int) buffer.size() && nDecoded == 0; ++i) {
+                reference.decode(buffer.data() + i*frameSize, frameSize);
+                instance.decode(buffer.data() + i*frameSize, frameSize);
+                if (frameReference < 0 && reference.rxReceiving()) frameReference = i;
+                if (frame < 0 && instance.rxReceiving()) frame = i;
+                nDecoded = instance.rxTakeData(result);
+            }
+
+            CHECK(frame >= 0 && frameReference >= 0 && frame <= frameReference);
+            nSooner += frame < frameReference;
+
+            CHECK(nDecoded == (int) payload.size());
+            CHECK(std::string((const char *) result.data(), payload.size()) == payload);
+        }
+
+        CHECK(nSooner > 0);
+    }
+
+    // the polyphase resampler must match the sinc resampler up to float precision and decode the same
+    for (const float sampleRate : { 11025.0f, 44100.0f, 96000.0f }) {
+        printf("Testing: polyphase resampler, sample rate = %g\n", sampleRate);
+
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.sampleRateInp = sampleRate;
+        parameters.sampleRateOut = sampleRate;
+        parameters.sampleFormatInp = GGWAVE_SAMPLE_FORMAT_F32;
+        parameters.sampleFormatOut = GGWAVE_SAMPLE_FORMAT_F32;
+
+        GGWave instanceSinc(parameters);
+        parameters.operatingMode |= GGWAVE_OPERATING_MODE_RESAMPLER_POLYPHASE;
+        GGWave instance(parameters);
+
+        instanceSinc.init(payload.size(), payload.data(), GGWAVE_PROTOCOL_AUDIBLE_FAST, 25);
+        instance.init(payload.size(), payload.data(), GGWAVE_PROTOCOL_AUDIBLE_FAST, 25);
+
+        const int nBytes = instance.encode();
+        CHECK((int) instanceSinc.encode() == nBytes);
+
+        const auto expected = (const float *) instanceSinc.txWaveform();
+        const auto waveform = (const float *) instance.txWaveform();
+        for (int i = 0; i < nBytes/(int) sizeof(float); ++i) {
+            CHECK(std::fabs(expected[i] - waveform[i]) < 1e-3f);
+        }
+
+        instance.decode(waveform, nBytes);
+
+        GGWave::TxRxData result;
+        CHECK(instance.rxTakeData(result) == (int) payload.size());
+        for (int i = 0; i < (int) payload.size(); ++i) {
+            CHECK(payload[i] == result[i]);
+        }
+    }
+
+    // multi-threaded analysis must give the same result as the single-threaded one
+    for (int protocolId = 0; protocolId < GGWAVE_PROTOCOL_COUNT; ++protocolId) {
+        const auto & protocol = GGWave::Protocols::kDefault()[protocolId];
+        if (protocol.enabled == false || protocol.extra == 2) continue;
+        printf("Testing: analysis threads, protocol = %s\n", protocol.name);
+
+        auto parameters = GGWave::getDefaultParameters();
+
+        {
+            GGWave instance(parameters);
+
+            instance.init(payload.size(), payload.data(), GGWave::ProtocolId(protocolId), 25);
+            const auto nBytes = instance.encode();
+            { auto p = (const uint8_t *)(instance.txWaveform()); buffer.resize(nBytes); memcpy(buffer.data(), p, nBytes); }
+            addNoiseHelper(0.02, parameters.sampleFormatOut);
+        }
+
+        std::string result[2];
+        GGWave::RxProtocolId resultProtocolId[2];
+        for (int k = 0; k < 2; ++k) {
+            parameters.analysisThreads = k == 0 ? 1 : 4;
+            GGWave instance(parameters);
+
+            instance.decode(buffer.data(), buffer.size());
+
+            GGWave::TxRxData data;
+            CHECK(instance.rxTakeData(data) == (int) payload.size());
+            result[k].assign((const char *) data.data(), data.size());
+            resultProtocolId[k] = instance.rxProtocolId();
+        }
+
+        CHECK(result[0] == payload);
+        CHECK(result[1] == result[0]);
+        CHECK(resultProtocolId[0] == protocolId);
+        CHECK(resultProtocolId[1] == resultProtocolId[0]);
+    }
+
+    // the analysis starts from the estimated end of the start marker - a transmission that does not start
+    // on a frame boundary must decode with the protocol that it was sent with
+    for (int protocolId = 0; protocolId < GGWAVE_PROTOCOL_COUNT; ++protocolId) {
+        const auto & protocol = GGWave::Protocols::kDefault()[protocolId];
+        if (protocol.enabled == false || protocol.extra == 2) continue;
+        printf("Testing: timing recovery, protocol = %s\n", protocol.name);
+
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.sampleFormatInp = GGWAVE_SAMPLE_FORMAT_F32;
+        parameters.sampleFormatOut = GGWAVE_SAMPLE_FORMAT_F32;
+
+        GGWave instance(parameters);
+
+        for (int shift : { 37, 300, 555, 1000 }) {
+            instance.init(payload.size(), payload.data(), GGWave::ProtocolId(protocolId), 25);
+            const auto nBytes = instance.encode();
+            {
+                auto p = (const uint8_t *)(instance.txWaveform());
+                buffer.assign(shift*sizeof(float), 0);
+                buffer.insert(buffer.end(), p, p + nBytes);
+            }
+            addNoiseHelper(0.02, parameters.sampleFormatOut);
+
+            instance.decode(buffer.data(), buffer.size());
+
+            GGWave::TxRxData data;
+            CHECK(instance.rxTakeData(data) == (int) payload.size());
+            CHECK(std::string((const char *) data.data(), payload.size()) == payload);
+            CHECK(instance.rxProtocolId() == protocolId);
+        }
+    }
+
+    // fixed-length decoding keeps running tone votes for each protocol - they must follow changes of the Rx protocols
+    {
+        printf("Testing: fixed-length decoding after changing the Rx protocols\n");
+
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.payloadLength = payload.size();
+
+        {
+            GGWave instance(parameters);
+
+            instance.init(payload.size(), payload.data(), GGWAVE_PROTOCOL_AUDIBLE_FAST, 25);
+            const auto nBytes = instance.encode();
+            { auto p = (const uint8_t *)(instance.txWaveform()); buffer.resize(nBytes); memcpy(buffer.data(), p, nBytes); }
+            addNoiseHelper(0.02, parameters.sampleFormatOut);
+        }
+
+        GGWave instance(parameters);
+        GGWave::TxRxData data;
+
+        instance.rxProtocols().only(GGWAVE_PROTOCOL_AUDIBLE_NORMAL);
+        instance.decode(buffer.data(), buffer.size());
+        CHECK(instance.rxTakeData(data) == 0);
+
+        instance.rxProtocols().only(GGWAVE_PROTOCOL_AUDIBLE_FAST);
+        instance.decode(buffer.data(), buffer.size());
+        CHECK(instance.rxTakeData(data) == (int) payload.size());
+        CHECK(std::string((const char *) data.data(), payload.size()) == payload);
+        CHECK(instance.rxProtocolId() == GGWAVE_PROTOCOL_AUDIBLE_FAST);
+    }
+
+    // the marker and data bins of the Rx protocols are resolved again when the protocols change
+    {
+        printf("Testing: variable-length decoding after moving an Rx protocol\n");
+
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.sampleFormatInp = GGWAVE_SAMPLE_FORMAT_F32;
+        parameters.sampleFormatOut = GGWAVE_SAMPLE_FORMAT_F32;
+
+        {
+            GGWave::Protocols::tx()[GGWAVE_PROTOCOL_AUDIBLE_FAST].freqStart = 64;
+            GGWave instance(parameters);
+            GGWave::Protocols::tx() = GGWave::Protocols::kDefault();
+
+            instance.init(payload.size(), payload.data(), GGWAVE_PROTOCOL_AUDIBLE_FAST, 25);
+            const auto nBytes = instance.encode();
+            {
+                auto p = (const uint8_t *)(instance.txWaveform());
+                buffer.assign(p, p + nBytes);
+                buffer.insert(buffer.end(), 16*instance.samplesPerFrame()*sizeof(float), 0);
+            }
+            addNoiseHelper(0.02, parameters.sampleFormatOut);
+        }
+
+        GGWave instance(parameters);
+        GGWave::TxRxData data;
+
+        instance.rxProtocols().only(GGWAVE_PROTOCOL_AUDIBLE_FAST);
+        instance.decode(buffer.data(), buffer.size());
+        CHECK(instance.rxTakeData(data) == 0);
+
+        instance.rxProtocols()[GGWAVE_PROTOCOL_AUDIBLE_FAST].freqStart = 64;
+        instance.decode(buffer.data(), buffer.size());
+        CHECK(instance.rxTakeData(data) == (int) payload.size());
+        CHECK(std::string((const char *) data.data(), payload.size()) == payload);
+    }
+
+    // the recording is sized for the Rx protocols enabled upon preparation - slower protocols enabled later are rejected
+    {
+        printf("Testing: enabling a slower Rx protocol after preparation\n");
+
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.sampleFormatInp = GGWAVE_SAMPLE_FORMAT_F32;
+        parameters.sampleFormatOut = GGWAVE_SAMPLE_FORMAT_F32;
+
+        auto encodeHelper = [&](GGWave::TxProtocolId protocolId) {
+            GGWave instance(parameters);
+
+            instance.init(payload.size(), payload.data(), protocolId, 25);
+            const auto nBytes = instance.encode();
+            auto p = (const uint8_t *)(instance.txWaveform());
+            buffer.assign(p, p + nBytes);
+            buffer.insert(buffer.end(), 16*instance.samplesPerFrame()*sizeof(float), 0);
+        };
+
+        GGWave::Protocols::rx().only(GGWAVE_PROTOCOL_AUDIBLE_FAST);
+        GGWave instance(parameters);
+        GGWave::Protocols::rx() = GGWave::Protocols::kDefault();
+
+        GGWave::TxRxData data;
+
+        // faster protocol - fits in the recording
+        encodeHelper(GGWAVE_PROTOCOL_AUDIBLE_FASTEST);
+        instance.rxProtocols()[GGWAVE_PROTOCOL_AUDIBLE_FASTEST].enabled = true;
+        instance.decode(buffer.data(), buffer.size());
+        CHECK(instance.rxProtocols()[GGWAVE_PROTOCOL_AUDIBLE_FASTEST].enabled);
+        CHECK(instance.rxTakeData(data) == (int) payload.size());
+        CHECK(instance.rxProtocolId() == GGWAVE_PROTOCOL_AUDIBLE_FASTEST);
+
+        // slower protocol - disabled instead of decoding a truncated recording
+        encodeHelper(GGWAVE_PROTOCOL_AUDIBLE_NORMAL);
+        instance.rxProtocols()[GGWAVE_PROTOCOL_AUDIBLE_NORMAL].enabled = true;
+        instance.decode(buffer.data(), buffer.size());
+        CHECK_F(instance.rxProtocols()[GGWAVE_PROTOCOL_AUDIBLE_NORMAL].enabled);
+        CHECK(instance.rxProtocols()[GGWAVE_PROTOCOL_AUDIBLE_FAST].enabled);
+        CHECK(instance.rxTakeData(data) <= 0);
+    }
+
+    // the energy gate skips the frames before the transmission, but must open in time to receive it
+    for (const int payloadLength : { -1, (int) payload.size() }) {
+        printf("Testing: energy gate, payload length = %d\n", payloadLength);
+
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.payloadLength = payloadLength;
+        parameters.sampleFormatInp = GGWAVE_SAMPLE_FORMAT_F32;
+        parameters.sampleFormatOut = GGWAVE_SAMPLE_FORMAT_F32;
+        parameters.operatingMode |= GGWAVE_OPERATING_MODE_RX_ENERGY_GATE;
+
+        GGWave instance(parameters);
+
+        instance.init(payload.size(), payload.data(), GGWAVE_PROTOCOL_AUDIBLE_FAST, 25);
+        const auto nBytes = instance.encode();
+        {
+            auto p = (const uint8_t *)(instance.txWaveform());
+            buffer.assign((64*instance.samplesPerFrame() + 300)*sizeof(float), 0);
+            buffer.insert(buffer.end(), p, p + nBytes);
+            buffer.insert(buffer.end(), 16*instance.samplesPerFrame()*sizeof(float), 0);
+        }
+        addNoiseHelper(0.02, parameters.sampleFormatOut);
+
+        instance.decode(buffer.data(), buffer.size());
+
+        GGWave::TxRxData data;
+        CHECK(instance.rxTakeData(data) == (int) payload.size());
+        CHECK(std::string((const char *) data.data(), payload.size()) == payload);
+        CHECK(instance.rxFramesSkipped() > 32);
+    }
+
+    // decimating front end - only the audible protocols are enabled, so the analysis runs on a narrow baseband
+    for (const int payloadLength : { -1, (int) payload.size() }) {
+        printf("Testing: decimating front end, payload length = %d\n", payloadLength);
+
+        GGWave::Protocols::rx().only(GGWAVE_PROTOCOL_AUDIBLE_NORMAL);
+        GGWave::Protocols::rx().toggle(GGWAVE_PROTOCOL_AUDIBLE_FAST, true);
+        GGWave::Protocols::rx().toggle(GGWAVE_PROTOCOL_AUDIBLE_FASTEST, true);
+
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.payloadLength = payloadLength;
+        parameters.sampleFormatInp = GGWAVE_SAMPLE_FORMAT_F32;
+        parameters.sampleFormatOut = GGWAVE_SAMPLE_FORMAT_F32;
+
+        GGWave reference(parameters);
+
+        parameters.operatingMode |= GGWAVE_OPERATING_MODE_RX_DECIMATE;
+
+        GGWave instance(parameters);
+        CHECK(instance.heapSize() < reference.heapSize());
+
+        instance.init(payload.size(), payload.data(), GGWAVE_PROTOCOL_AUDIBLE_FAST, 25);
+        const auto nBytes = instance.encode();
+        {
+            auto p = (const uint8_t *)(instance.txWaveform());
+            buffer.assign(300*sizeof(float), 0);
+            buffer.insert(buffer.end(), p, p + nBytes);
+            buffer.insert(buffer.end(), 16*instance.samplesPerFrame()*sizeof(float), 0);
+        }
+        addNoiseHelper(0.02, parameters.sampleFormatOut);
+
+        instance.decode(buffer.data(), buffer.size());
+
+        GGWave::TxRxData data;
+        CHECK(instance.rxTakeData(data) == (int) payload.size());
+        CHECK(std::string((const char *) data.data(), payload.size()) == payload);
+
+        GGWave::Protocols::rx() = GGWave::Protocols::kDefault();
+    }
+
+    // the spectrum history of the decimating front end ends at the band of the Rx protocols enabled upon preparation -
+    // protocols enabled later above it are ignored instead of being read past the end of the history rows
+    {
+        printf("Testing: decimating front end, out-of-band Rx protocol\n");
+
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.payloadLength = payload.size();
+        parameters.sampleFormatInp = GGWAVE_SAMPLE_FORMAT_F32;
+        parameters.sampleFormatOut = GGWAVE_SAMPLE_FORMAT_F32;
+        parameters.operatingMode |= GGWAVE_OPERATING_MODE_RX_DECIMATE;
+
+        GGWave::Protocols::rx().only(GGWAVE_PROTOCOL_AUDIBLE_FAST);
+        GGWave instance(parameters);
+        GGWave::Protocols::rx() = GGWave::Protocols::kDefault();
+
+        CHECK(instance.rxDecimation() > 1);
+
+        instance.init(payload.size(), payload.data(), GGWAVE_PROTOCOL_AUDIBLE_FAST, 25);
+        const auto nBytes = instance.encode();
+        {
+            auto p = (const uint8_t *)(instance.txWaveform());
+            buffer.assign(300*sizeof(float), 0);
+            buffer.insert(buffer.end(), p, p + nBytes);
+            buffer.insert(buffer.end(), 16*instance.samplesPerFrame()*sizeof(float), 0);
+        }
+        addNoiseHelper(0.02, parameters.sampleFormatOut);
+
+        instance.rxProtocols()[GGWAVE_PROTOCOL_ULTRASOUND_FASTEST].enabled = true;
+        instance.decode(buffer.data(), buffer.size());
+
+        GGWave::TxRxData data;
+        CHECK(instance.rxTakeData(data) == (int) payload.size());
+        CHECK(std::string((const char *) data.data(), payload.size()) == payload);
+        CHECK(instance.rxProtocolId() == GGWAVE_PROTOCOL_AUDIBLE_FAST);
+    }
+
+    // 16-bit recording - the recording capacity also follows the longest transmission of the enabled Rx protocols
+    for (const int operatingMode : { 0, (int) GGWAVE_OPERATING_MODE_RX_DECIMATE }) {
+        printf("Testing: 16-bit recording, operating mode = %d\n", operatingMode);
+
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.sampleFormatInp = GGWAVE_SAMPLE_FORMAT_I16;
+        parameters.sampleFormatOut = GGWAVE_SAMPLE_FORMAT_I16;
+        parameters.operatingMode |= operatingMode;
+
+        GGWave reference(parameters);
+
+        GGWave::Protocols::rx().only(GGWAVE_PROTOCOL_AUDIBLE_FAST);
+
+        GGWave shorter(parameters);
+        CHECK(shorter.heapSize() < reference.heapSize());
+
+        parameters.operatingMode |= GGWAVE_OPERATING_MODE_RX_RECORD_I16;
+
+        GGWave instance(parameters);
+        CHECK(instance.heapSize() < shorter.heapSize());
+
+        instance.init(payload.size(), payload.data(), GGWAVE_PROTOCOL_AUDIBLE_FAST, 25);
+        const auto nBytes = instance.encode();
+        {
+            auto p = (const uint8_t *)(instance.txWaveform());
+            buffer.assign(300*sizeof(int16_t), 0);
+            buffer.insert(buffer.end(), p, p + nBytes);
+            buffer.insert(buffer.end(), 16*instance.samplesPerFrame()*sizeof(int16_t), 0);
+        }
+        addNoiseHelper(0.02, parameters.sampleFormatOut);
+
+        instance.decode(buffer.data(), buffer.size());
+
+        GGWave::TxRxData data;
+        CHECK(instance.rxTakeData(data) == (int) payload.size());
+        CHECK(std::string((const char *) data.data(), payload.size()) == payload);
+
+        GGWave::Protocols::rx() = GGWave::Protocols::kDefault();
+    }
+
+    // asynchronous decoding
+    {
+        printf("Testing: async decoder\n");
+
+        auto parameters = GGWave::getDefaultParameters();
+
+        std::vector<uint8_t> waveform;
+        for (auto protocolId : { GGWAVE_PROTOCOL_AUDIBLE_NORMAL, GGWAVE_PROTOCOL_DT_FASTEST }) {
+            GGWave instance(parameters);
+
+            instance.init(payload.size(), payload.data(), protocolId, 25);
+            const auto nBytes = instance.encode();
+            { auto p = (const uint8_t *)(instance.txWaveform()); buffer.resize(nBytes); memcpy(buffer.data(), p, nBytes); }
+            addNoiseHelper(0.02, parameters.sampleFormatOut);
+            waveform.insert(waveform.end(), buffer.begin(), buffer.end());
+        }
+
+        int nCallbacks = 0;
+        auto callback = [](const uint8_t * , int , GGWave::RxProtocolId , void * userData) { ++*(int *) userData; };
+
+        GGWave::AsyncDecoder decoder(parameters, 8, callback, &nCallbacks);
+        CHECK(decoder.isValid());
+
+        // push in odd-sized chunks and retry whatever does not fit in the ring buffer
+        const uint32_t nChunk = 4*12345;
+        for (uint32_t offset = 0; offset < waveform.size(); ) {
+            offset += decoder.push(waveform.data() + offset, std::min(nChunk, (uint32_t) waveform.size() - offset));
+            decoder.flush();
+        }
+        CHECK(decoder.nDroppedBytes() > 0);
+
+        const GGWave::RxProtocolId expected[2] = { GGWAVE_PROTOCOL_AUDIBLE_NORMAL, GGWAVE_PROTOCOL_DT_FASTEST };
+        for (int k = 0; k < 2; ++k) {
+            uint8_t data[GGWave::kMaxDataSize];
+            GGWave::RxProtocolId protocolId;
+            CHECK(decoder.takeData(data, sizeof(data), protocolId) == (int) payload.size());
+            CHECK(protocolId == expected[k]);
+            CHECK(std::string((const char *) data, payload.size()) == payload);
+        }
+
+        uint8_t data[GGWave::kMaxDataSize];
+        GGWave::RxProtocolId protocolId;
+        CHECK(decoder.takeData(data, sizeof(data), protocolId) == 0);
+        CHECK(nCallbacks == 2);
+    }
+
+    // multi-channel decoding - a different transmission in two of the three channels, with a 44.1 kHz capture
+    // rate to exercise the resampler of each channel
+    {
+        printf("Testing: multi-channel decoder\n");
+
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.sampleRateInp = 44100;
+        parameters.sampleRateOut = 44100;
+        parameters.sampleFormatInp = GGWAVE_SAMPLE_FORMAT_I16;
+        parameters.sampleFormatOut = GGWAVE_SAMPLE_FORMAT_I16;
+        parameters.operatingMode |= GGWAVE_OPERATING_MODE_RESAMPLER_POLYPHASE;
+
+        const int nChannels = 3;
+        const GGWave::TxProtocolId protocolIds[nChannels] = { GGWAVE_PROTOCOL_COUNT, GGWAVE_PROTOCOL_AUDIBLE_FAST, GGWAVE_PROTOCOL_DT_FASTEST };
+
+        std::vector<std::vector<int16_t>> waveforms(nChannels);
+        for (int c = 1; c < nChannels; ++c) {
+            GGWave instance(parameters);
+
+            instance.init(payload.size(), payload.data(), protocolIds[c], 25);
+            const auto nBytes = instance.encode();
+            auto p = (const int16_t *) instance.txWaveform();
+            waveforms[c].assign(p, p + nBytes/sizeof(int16_t));
+        }
+
+        const int nSamples = std::max(waveforms[1].size(), waveforms[2].size()) + 8192;
+
+        std::vector<int16_t> interleaved(nChannels*nSamples, 0);
+        for (int c = 0; c < nChannels; ++c) {
+            for (int i = 0; i < (int) waveforms[c].size(); ++i) {
+                interleaved[i*nChannels + c] = waveforms[c][i];
+            }
+        }
+
+        GGWave::MultiDecoder decoder(parameters, nChannels);
+        CHECK(decoder.isValid());
+        CHECK(decoder.nChannels() == nChannels);
+
+        CHECK(decoder.heapSize() == nChannels*decoder.instance(0).heapSize());
+
+        // odd-sized chunks of whole multi-channel samples
+        const int nChunk = 777;
+        for (int offset = 0; offset < nSamples; offset += nChunk) {
+            const int n = std::min(nChunk, nSamples - offset);
+            CHECK(decoder.decode(interleaved.data() + offset*nChannels, n*nChannels*sizeof(int16_t)));
+        }
+        CHECK_F(decoder.decode(interleaved.data(), sizeof(int16_t)));
+
+        bool isDecoded[nChannels] = { false };
+
+        uint8_t data[GGWave::kMaxDataSize];
+        int channel = -1;
+        GGWave::RxProtocolId protocolId;
+        while (int n = decoder.takeData(data, sizeof(data), channel, protocolId)) {
+            CHECK(n == (int) payload.size());
+            CHECK(channel > 0 && channel < nChannels);
+            CHECK(protocolId == protocolIds[channel]);
+            CHECK(std::string((const char *) data, payload.size()) == payload);
+
+            isDecoded[channel] = true;
+        }
+
+        CHECK(isDecoded[0] == false && isDecoded[1] && isDecoded[2]);
+    }
+
+    // custom heap - from an allocator that is reused when preparing again, and from an external block
+    {
+        printf("Testing: custom heap\n");
+
+        // hands out the same aligned block of an arena
+        struct ArenaAllocator : public GGWave::Allocator {
+            std::vector<uint8_t> arena;
+
+            int nAllocated = 0;
+            int nLive      = 0;
+
+            void * allocate(int size, int alignment) override {
+                CHECK(alignment == GGWave::kHeapAlignment);
+                CHECK(nLive == 0);
+                ++nAllocated;
+                ++nLive;
+                arena.resize(size + alignment);
+                return arena.data() + (-(uintptr_t) arena.data() & (alignment - 1));
+            }
+
+            void deallocate(void * , int ) override {
+                --nLive;
+            }
+        } allocator;
+
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.sampleFormatInp = GGWAVE_SAMPLE_FORMAT_I16;
+        parameters.sampleFormatOut = GGWAVE_SAMPLE_FORMAT_I16;
+
+        GGWave sizer;
+        CHECK(sizer.prepare(parameters, false));
+        const int heapSize = sizer.heapSize();
+
+        std::vector<uint8_t> heapBlock(heapSize + GGWave::kHeapAlignment);
+        uint8_t * heap = heapBlock.data() + (-(uintptr_t) heapBlock.data() & (GGWave::kHeapAlignment - 1));
+
+        auto roundtrip = [&](GGWave & instance) {
+            instance.init(payload.size(), payload.data(), GGWAVE_PROTOCOL_AUDIBLE_FASTEST, 25);
+            const auto nBytes = instance.encode();
+            CHECK((uintptr_t) instance.txWaveform() % GGWave::kHeapAlignment == 0);
+            { auto p = (const uint8_t *)(instance.txWaveform()); buffer.resize(nBytes); memcpy(buffer.data(), p, nBytes); }
+            addNoiseHelper(0.02, parameters.sampleFormatOut);
+            instance.decode(buffer.data(), buffer.size());
+
+            GGWave::TxRxData data;
+            CHECK(instance.rxTakeData(data) == (int) payload.size());
+            CHECK(std::string((const char *) data.data(), payload.size()) == payload);
+        };
+
+        {
+            GGWave instance;
+            CHECK(instance.prepare(parameters, allocator));
+            CHECK(instance.heapSize() == heapSize);
+            roundtrip(instance);
+
+            // same size - the heap is reused
+            CHECK(instance.prepare(parameters, allocator));
+            CHECK(allocator.nAllocated == 1);
+            roundtrip(instance);
+
+            CHECK_F(instance.prepare(parameters, heap, heapSize - 1));
+            CHECK_F(instance.prepare(parameters, heap + GGWave::kHeapAlignment/2, heapSize));
+            CHECK(instance.prepare(parameters, heap, heapSize));
+            CHECK(allocator.nLive == 0);
+            roundtrip(instance);
+        }
+
+        CHECK(allocator.nLive == 0);
+    }
+
+    // shared FFT tables - same result as the tables owned by the caller
+    {
+        printf("Testing: shared FFT tables\n");
+
+        for (const int N : { 64, 256, 1024 }) {
+            std::vector<float> src(N);
+            for (int i = 0; i < N; ++i) {
+                src[i] = std::sin(0.1f*i) + 0.5f*std::cos(0.37f*i);
+            }
+
+            std::vector<int>   wi(GGWave::computeFFTR(nullptr, nullptr, N, nullptr, nullptr), 0);
+            std::vector<float> wf(GGWave::computeFFTR(nullptr, nullptr, N, wi.data(), nullptr), 0.0f);
+
+            std::vector<float> dst0(2*N);
+            std::vector<float> dst1(2*N);
+            CHECK(GGWave::computeFFTR(src.data(), dst0.data(), N, wi.data(), wf.data()) == 1);
+            CHECK(GGWave::computeFFTRShared(src.data(), dst1.data(), N));
+
+            for (int i = 0; i < N; ++i) {
+                CHECK(std::fabs(dst0[i] - dst1[i]) < 1e-3f);
+            }
+        }
+
+        CHECK_F(GGWave::computeFFTRShared(nullptr, nullptr, 1000));
+        CHECK(GGWave::sharedHeapSize() > 0);
+    }
+
+    // shared tone tables - shared by the instances with the same parameters and freed with the last of them
+    if (GGWave::sharedHeapSize() > 0) {
+        printf("Testing: shared tone tables\n");
+
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.operatingMode = GGWAVE_OPERATING_MODE_TX;
+        parameters.sampleRate = 44100.0f;
+
+        const int sharedHeapSize0 = GGWave::sharedHeapSize();
+
+        {
+            GGWave instance0(parameters);
+            CHECK(instance0.init(payload.size(), payload.data(), GGWAVE_PROTOCOL_AUDIBLE_FAST, 25));
+            CHECK(instance0.encode() > 0);
+
+            const int sharedHeapSize1 = GGWave::sharedHeapSize();
+            CHECK(sharedHeapSize1 > sharedHeapSize0);
+
+            {
+                GGWave instance1(parameters);
+                CHECK(instance1.init(payload.size(), payload.data(), GGWAVE_PROTOCOL_AUDIBLE_FAST, 25));
+                CHECK(instance1.encode() > 0);
+                CHECK(GGWave::sharedHeapSize() == sharedHeapSize1);
+            }
+
+            CHECK(GGWave::sharedHeapSize() == sharedHeapSize1);
+
+            // another tone layout replaces the tables of the instance
+            CHECK(instance0.init(payload.size(), payload.data(), GGWAVE_PROTOCOL_ULTRASOUND_FAST, 25));
+            CHECK(instance0.encode() > 0);
+            CHECK(GGWave::sharedHeapSize() > sharedHeapSize0);
+        }
+
+        CHECK(GGWave::sharedHeapSize() == sharedHeapSize0);
+    }
+
+    // FFT backends - the spectra of the radix-4 and the Ooura FFT agree up to rounding and both decode
+    {
+        printf("Testing: FFT backends\n");
+
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.sampleFormatInp = GGWAVE_SAMPLE_FORMAT_F32;
+        parameters.sampleFormatOut = GGWAVE_SAMPLE_FORMAT_F32;
+
+        GGWave ooura(parameters);
+
+        parameters.operatingMode |= GGWAVE_OPERATING_MODE_FFT_RADIX4;
+
+        GGWave radix4(parameters);
+
+        ooura.init(payload.size(), payload.data(), GGWAVE_PROTOCOL_AUDIBLE_FAST, 25);
+        const auto nBytes = ooura.encode();
+        {
+            auto p = (const uint8_t *)(ooura.txWaveform());
+            buffer.assign(p, p + nBytes);
+            buffer.insert(buffer.end(), 16*ooura.samplesPerFrame()*sizeof(float), 0);
+        }
+        addNoiseHelper(0.02, parameters.sampleFormatOut);
+
+        for (auto instance : { &radix4, &ooura }) {
+            instance->decode(buffer.data(), buffer.size());
+
+            GGWave::TxRxData data;
+            CHECK(instance->rxTakeData(data) == (int) payload.size());
+            CHECK(std::string((const char *) data.data(), payload.size()) == payload);
+        }
+
+        const auto & spectrum0 = radix4.rxSpectrum();
+        const auto & spectrum1 = ooura.rxSpectrum();
+
+        float maxValue = 0.0f;
+        for (int i = 0; i < (int) spectrum0.size(); ++i) {
+            maxValue = std::max(maxValue, spectrum1[i]);
+        }
+        CHECK(maxValue > 0.0f);
+        for (int i = 0; i < (int) spectrum0.size(); ++i) {
+            CHECK(std::fabs(spectrum0[i] - spectrum1[i]) <= 1e-4f*maxValue);
+        }
+    }
+
+    // half spectrum - the bins up to the Nyquist frequency, and the layout of previous versions
+    {
+        printf("Testing: half spectrum\n");
+
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.payloadLength = payload.size();
+        parameters.sampleFormatInp = GGWAVE_SAMPLE_FORMAT_F32;
+        parameters.sampleFormatOut = GGWAVE_SAMPLE_FORMAT_F32;
+
+        GGWave instance(parameters);
+
+        instance.init(payload.size(), payload.data(), GGWAVE_PROTOCOL_AUDIBLE_FAST, 25);
+        const auto nBytes = instance.encode();
+        {
+            auto p = (const uint8_t *)(instance.txWaveform());
+            buffer.assign(p, p + nBytes/2);
+        }
+
+        instance.decode(buffer.data(), buffer.size());
+
+        const int N = instance.samplesPerFrame();
+        const auto & spectrum = instance.rxSpectrumHalf();
+        CHECK((int) spectrum.size() == N/2 + 1);
+
+        std::vector<float> fftOut(2*N);
+        CHECK(instance.computeFFTR(instance.rxAmplitude().data(), fftOut.data(), N));
+
+        std::vector<float> expected(N/2 + 1);
+        expected[0]   = fftOut[0]*fftOut[0];
+        expected[N/2] = fftOut[1]*fftOut[1];
+        for (int i = 1; i < N/2; ++i) {
+            expected[i] = fftOut[2*i + 0]*fftOut[2*i + 0] + fftOut[2*i + 1]*fftOut[2*i + 1];
+        }
+
+        float maxValue = 0.0f;
+        for (int i = 0; i <= N/2; ++i) {
+            maxValue = std::max(maxValue, expected[i]);
+        }
+        CHECK(maxValue > 0.0f);
+        for (int i = 0; i <= N/2; ++i) {
+            CHECK(std::fabs(spectrum[i] - expected[i]) <= 1e-5f*maxValue);
+        }
+
+        GGWave::Spectrum full;
+        CHECK(instance.rxTakeSpectrum(full));
+        CHECK(full.data() == instance.rxSpectrum().data());
+        CHECK(full.size() == N);
+        CHECK(full[0] == spectrum[0] + spectrum[N/2]);
+        for (int i = 1; i < N; ++i) {
+            CHECK(full[i] == (i < N/2 ? spectrum[i] : 0.0f));
+        }
+    }
+
+    // batch encoding must produce the same waveforms as encoding one payload at a time
+    for (int nThreads : { 1, 3 }) {
+        printf("Testing: batch encoding, threads = %d\n", nThreads);
+
+        auto parameters = GGWave::getDefaultParameters();
+        parameters.sampleFormatOut = GGWAVE_SAMPLE_FORMAT_I16;
+
+        const GGWave::TxProtocolId protocolIds[] = {
+            GGWAVE_PROTOCOL_AUDIBLE_NORMAL, GGWAVE_PROTOCOL_AUDIBLE_NORMAL, GGWAVE_PROTOCOL_ULTRASOUND_FAST,
+            GGWAVE_PROTOCOL_DT_FASTEST, GGWAVE_PROTOCOL_AUDIBLE_NORMAL,
+        };
+        const int nItems = sizeof(protocolIds)/sizeof(protocolIds[0]);
+
+        std::vector<std::vector<uint8_t>> expected(nItems);
+        for (int i = 0; i < nItems; ++i) {
+            GGWave instance(parameters);
+            instance.init(i + 1, payload.data(), protocolIds[i], 10 + i);
+            const auto nBytes = instance.encode();
+            expected[i].resize(nBytes);
+            memcpy(expected[i].data(), instance.txWaveform(), nBytes);
+        }
+
+        std::vector<GGWave::EncodeItem> items(nItems);
+        for (int i = 0; i < nItems; ++i) {
+            items[i] = { payload.data(), i + 1, protocolIds[i], 10 + i, nullptr, 0, 0 };
+        }
+
+        CHECK(GGWave::encodeBatch(parameters, items.data(), nItems, nThreads) == nItems);
+
+        std::vector<std::vector<uint8_t>> outputs(nItems);
+        for (int i = 0; i < nItems; ++i) {
+            CHECK(items[i].nBytes >= expected[i].size());
+            outputs[i].resize(items[i].nBytes);
+            items[i].output = outputs[i].data();
+            items[i].outputSize = outputs[i].size();
+        }
+
+        CHECK(GGWave::encodeBatch(parameters, items.data(), nItems, nThreads) == nItems);
+
+        for (int i = 0; i < nItems; ++i) {
+            CHECK(items[i].nBytes == expected[i].size());
+            CHECK(memcmp(outputs[i].data(), expected[i].data(), items[i].nBytes) == 0);
+        }
+
+        // output buffer too small - nothing is written
+        memset(outputs[0].data(), 0xAB, outputs[0].size());
+        items[0].outputSize = expected[0].size() - 1;
+        CHECK(GGWave::encodeBatch(parameters, items.data(), 1, nThreads) == 0);
+        CHECK(items[0].nBytes == 0);
+        for (const auto & x : outputs[0]) {
+            CHECK(x == 0xAB);
+        }
+    }
+
+    // streaming encoding must produce the same waveform as encode(), regardless of the chunk size
+    for (const auto & formatOut : kFormats) {
+        for (float sampleRateOut : { (float) GGWave::kDefaultSampleRate, 44100.0f }) {
+            printf("Testing: streaming encoding, out = %d, sample rate = %g\n", formatOut, sampleRateOut);
+
+            auto parameters = GGWave::getDefaultParameters();
+            parameters.operatingMode = GGWAVE_OPERATING_MODE_TX;
+            parameters.sampleFormatOut = formatOut;
+            parameters.sampleRateOut = sampleRateOut;
+
+            GGWave instance(parameters);
+            instance.init(payload.size(), payload.data(), GGWAVE_PROTOCOL_AUDIBLE_FAST, 25);
+            const auto nBytes = instance.encode();
+            std::vector<uint8_t> expected(nBytes);
+            memcpy(expected.data(), instance.txWaveform(), nBytes);
+
+            parameters.operatingMode |= GGWAVE_OPERATING_MODE_TX_STREAM;
+            GGWave instanceStream(parameters);
+            CHECK(instanceStream.heapSize() < instance.heapSize());
+
+            instanceStream.init(payload.size(), payload.data(), GGWAVE_PROTOCOL_AUDIBLE_FAST, 25);
+            CHECK(instanceStream.encode() == 0);
+            CHECK(instanceStream.encodeNext(nullptr, 0) == -1);
+            CHECK(instanceStream.encodeBegin());
+
+            const int sampleSize = instanceStream.sampleSizeOut();
+            std::vector<uint8_t> result(nBytes + 1024*sampleSize);
+
+            // an empty buffer is an error, not the end of the waveform
+            CHECK(instanceStream.encodeNext(result.data(), 0) == -1);
+            CHECK(instanceStream.encodeNext(nullptr, 1) == -1);
+
+            // note : do not use rand() here in order to keep the noise of the tests below unchanged
+            int nSamples = 0;
+            for (int i = 0; ; ++i) {
+                const int n = instanceStream.encodeNext(result.data() + nSamples*sampleSize, 1 + (7919*i)%1000);
+                if (n == 0) break;
+                nSamples += n;
+            }
+
+            CHECK(nSamples*sampleSize == (int) nBytes);
+            CHECK(memcmp(result.data(), expected.data(), nBytes) == 0);
+
+            // the end of the waveform is reported once
+            CHECK(instanceStream.encodeNext(result.data(), 1) == -1);
+        }
+    }
+
+    // the vectorised sample conversions must match the scalar ones exactly
+    {
+        const int n = 1003;
+
+        // note : do not use rand() here in order to keep the noise of the tests below unchanged
+        uint32_t seed = 12345;
+        auto next = [&]() { seed = seed*1664525 + 1013904223; return seed >> 8; };
+
+        std::vector<float> src(n);
+        for (int i = 0; i < n; ++i) {
+            src[i] = 3.0f*(float(next() % 65536)/65536.0f - 0.5f);
+        }
+        src[0] = 1.0f; src[1] = -1.0f; src[2] = 0.0f; src[3] = 0.99999f; src[4] = -1.00001f;
+
+        std::vector<uint8_t> raw(4*n);
+        for (auto & v : raw) {
+            v = next() & 255;
+        }
+
+        const auto & scalar = *simdKernels(kSimdScalar);
+        printf("Testing: sample conversion, selected isa = %s\n", simdKernels().name);
+        for (int isa = 0; isa < kSimdCount; ++isa) {
+            const auto kernels = simdKernels(SimdIsa(isa));
+            if (kernels == nullptr) continue;
+            printf("Testing: sample conversion, isa = %s\n", kernels->name);
+
+            for (const auto & format : kFormats) {
+                std::vector<uint8_t> expected(4*n), result(4*n);
+                scalar.fromF32[format](src.data(), expected.data(), n);
+                kernels->fromF32[format](src.data(), result.data(), n);
+                CHECK(expected == result);
+
+                std::vector<float> expectedF32(n), resultF32(n);
+                scalar.toF32[format](raw.data(), expectedF32.data(), n);
+                kernels->toF32[format](raw.data(), resultF32.data(), n);
+                CHECK(memcmp(expectedF32.data(), resultF32.data(), n*sizeof(float)) == 0);
+            }
+
+            {
+                std::vector<float> expectedF32(n/2), resultF32(n/2);
+                scalar.powerSpectrum(src.data(), expectedF32.data(), n/2);
+                kernels->powerSpectrum(src.data(), resultF32.data(), n/2);
+                for (int i = 0; i < n/2; ++i) {
+                    CHECK(std::fabs(expectedF32[i] - resultF32[i]) <= 1e-6f*expectedF32[i]);
+                }
+
+                CHECK(scalar.maxValue(expectedF32.data(), n/2) == kernels->maxValue(expectedF32.data(), n/2));
+                CHECK(scalar.maxValue(expectedF32.data(), 3) == kernels->maxValue(expectedF32.data(), 3));
+
+                std::vector<uint8_t> expectedU8(n/2), resultU8(n/2);
+                scalar.quantizeU8(expectedF32.data(), 100.0f, expectedU8.data(), n/2);
+                kernels->quantizeU8(expectedF32.data(), 100.0f, resultU8.data(), n/2);
+                CHECK(expectedU8 == resultU8);
+
+                double dot = 0.0;
+                for (int i = 0; i < n/2; ++i) {
+                    dot += double(src[i])*src[n/2 + i];
+                }
+                CHECK(std::fabs(kernels->dot(src.data(), src.data() + n/2, n/2) - dot) < 1e-4);
+
+                double energy = 0.0;
+                for (int b = 0; b < n/48; ++b) {
+                    double re = 0.0, im = 0.0;
+                    for (int i = 0; i < 16; ++i) {
+                        re += double(src[16*b + i])*src[n/2 + i];
+                        im += double(src[16*b + i])*src[n/2 + 16 + i];
+                    }
+                    energy += re*re + im*im;
+                }
+                CHECK(std::fabs(kernels->blockEnergy(src.data(), src.data() + n/2, src.data() + n/2 + 16, 16, n/48) - energy) < 1e-3*energy);
+
+                const int nOut = (n/2 - 24)/3;
+                std::vector<float> fir(2*nOut);
+                kernels->firDecimate(src.data(), src.data() + n/2, src.data() + n/2 + 24, 24, 3, fir.data(), nOut);
+                for (int m = 0; m < nOut; ++m) {
+                    double re = 0.0, im = 0.0;
+                    for (int k = 0; k < 24; ++k) {
+                        re += double(src[3*m + k])*src[n/2 + k];
+                        im += double(src[3*m + k])*src[n/2 + 24 + k];
+                    }
+                    CHECK(std::fabs(fir[2*m + 0] - re) < 1e-4 && std::fabs(fir[2*m + 1] - im) < 1e-4);
+                }
+            }
+
+            // the radix-4 FFT against the DFT - with an odd and an even log2 of the number of complex values
+            for (const int N : { 32, 512 }) {
+                std::vector<int>   perm(fftTableSizeI(N));
+                std::vector<float> tw(fftTableSizeF(N));
+                std::vector<float> work(2*N);
+                fftInit(N, perm.data(), tw.data());
+
+                std::vector<float> f(src.begin(), src.begin() + N);
+                fftReal(*kernels, f.data(), N, perm.data(), tw.data(), work.data());
+                for (int k = 0; k <= N/2; ++k) {
+                    double re = 0.0, im = 0.0;
+                    for (int j = 0; j < N; ++j) {
+                        re += src[j]*std::cos(2.0*M_PI*j*k/N);
+                        im += src[j]*std::sin(2.0*M_PI*j*k/N);
+                    }
+                    if (k == 0 || k == N/2) {
+                        CHECK(std::fabs(f[k == 0 ? 0 : 1] - re) < 1e-5*N);
+                    } else {
+                        CHECK(std::fabs(f[2*k + 0] - re) < 1e-5*N && std::fabs(f[2*k + 1] - im) < 1e-5*N);
+                    }
+                }
+
+                f.assign(src.begin(), src.begin() + N);
+                fftComplex(*kernels, f.data(), N/2, perm.data(), tw.data(), work.data());
+                for (int k = 0; k < N/2; ++k) {
+                    double re = 0.0, im = 0.0;
+                    for (int j = 0; j < N/2; ++j) {
+                        const double phi = 2.0*M_PI*j*k/(N/2);
+                        re += src[2*j + 0]*std::cos(phi) + src[2*j + 1]*std::sin(phi);
+                        im += src[2*j + 1]*std::cos(phi) - src[2*j + 0]*std::sin(phi);
+                    }
+                    CHECK(std::fabs(f[2*k + 0] - re) < 1e-5*N && std::fabs(f[2*k + 1] - im) < 1e-5*N);
+                }
+            }
+
+            // the Goertzel bank against the DFT - full blocks of vectors, single vectors and scalar bins
+            {
+                const int N = 512;
+                const int nBins = 37;
+
+                std::vector<float> cs(nBins), sn(nBins), out(2*nBins);
+                for (int k = 0; k < nBins; ++k) {
+                    cs[k] = std::cos(2.0*M_PI*(20 + k)/N);
+                    sn[k] = std::sin(2.0*M_PI*(20 + k)/N);
+                }
+
+                kernels->goertzel(src.data(), N, cs.data(), sn.data(), out.data(), nBins);
+                for (int k = 0; k < nBins; ++k) {
+                    double re = 0.0, im = 0.0;
+                    for (int j = 0; j < N; ++j) {
+                        re += src[j]*std::cos(2.0*M_PI*j*(20 + k)/N);
+                        im += src[j]*std::sin(2.0*M_PI*j*(20 + k)/N);
+                    }
+                    CHECK(std::fabs(out[2*k + 0] - re) < 1e-5*N && std::fabs(out[2*k + 1] - im) < 1e-5*N);
+                }
+            }
+
+            // small values to get many ties - the last maximum wins
+            {
+                std::vector<uint8_t> bins(n);
+                for (auto & v : bins) {
+                    v = next() % 4;
+                }
+
+                const int nGroups = (n - 16)/7;
+                std::vector<uint8_t> expectedBins(nGroups), resultBins(nGroups);
+                scalar.argmax16U8(bins.data(), 7, nGroups, expectedBins.data());
+                kernels->argmax16U8(bins.data(), 7, nGroups, resultBins.data());
+                CHECK(expectedBins == resultBins);
+            }
+
+            // saturation at full scale
+            int16_t i16[2];
+            kernels->fromF32[GGWAVE_SAMPLE_FORMAT_I16](src.data(), i16, 2);
+            CHECK(i16[0] == 32767 && i16[1] == -32768);
+
+            uint8_t u8[2];
+            kernels->fromF32[GGWAVE_SAMPLE_FORMAT_U8](src.data(), u8, 2);
+            CHECK(u8[0] == 255 && u8[1] == 0);
+        }
+    }
+
     // encode / decode using different sample formats and Tx protocols
     for (const auto & formatOut : kFormats) {
         for (const auto & formatInp : kFormats) {